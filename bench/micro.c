@@ -0,0 +1,506 @@
+/*
+ * micro.c - Microbenchmarks for core kernels
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Each benchmark runs one kernel in a loop until BENCH_TIME seconds have
+ * passed and then reports the time and the number of heap allocations per
+ * operation. Allocations are counted by interposing malloc, calloc, and
+ * realloc, which glibc explicitly supports.
+ *
+ * Usage: micro [name ...]
+ *
+ * Without arguments, all benchmarks are run.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "util.h"
+#include "error.h"
+#include "coord.h"
+#include "expr.h"
+#include "obj.h"
+#include "inst.h"
+#include "meas.h"
+#include "bitset.h"
+#include "tsort.h"
+#include "overlap.h"
+#include "cpp.h"
+#include "fpd.h"
+#include "fped.h"
+
+
+#define	BENCH_TIME	0.2	/* seconds per benchmark */
+
+
+/* ----- Things fped.c would provide --------------------------------------- */
+
+
+char *save_file_name = NULL;
+int no_save = 1;
+
+
+/* ----- Allocation counting ----------------------------------------------- */
+
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+
+static unsigned long allocs = 0;
+
+
+void *malloc(size_t size)
+{
+	allocs++;
+	return __libc_malloc(size);
+}
+
+
+void *calloc(size_t nmemb, size_t size)
+{
+	allocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+
+void *realloc(void *ptr, size_t size)
+{
+	allocs++;
+	return __libc_realloc(ptr, size);
+}
+
+
+/* ----- Test model -------------------------------------------------------- */
+
+
+static const char *model =
+    "frame pad {\n"
+    "	set Px = 0.5mm\n"
+    "	__0: vec @(col*e-Px/2, row*-e-Px/2)\n"
+    "	__1: vec .(Px, Px)\n"
+    "	pad \"${rname}$col\" __0 __1\n"
+    "}\n"
+    "package \"bench\"\n"
+    "table { row, rname } { 0, \"A\" } { 1, \"B\" } { 2, \"C\" } { 3, \"D\" }\n"
+    "set e = 1mm\n"
+    "loop col = 0, 7\n"
+    "frame pad @\n";
+
+static struct frame *pad_frame;
+static struct inst *pad_a, *pad_b;
+
+
+static void load_model(void)
+{
+	const struct pkg *pkg;
+
+	reporter = report_to_stderr;
+	run_cpp_on_string(model);
+	scan_file();
+	if (yyparse())
+		exit(1);
+	if (!instantiate())
+		exit(1);
+	for (pad_frame = frames; pad_frame; pad_frame = pad_frame->next)
+		if (pad_frame->name && !strcmp(pad_frame->name, "pad"))
+			break;
+	for (pkg = pkgs; pkg; pkg = pkg->next)
+		if (pkg->name)
+			break;
+	if (!pad_frame || !pkg)
+		abort();
+	pad_a = pkg->insts[ip_pad_copper];
+	pad_b = pad_a ? pad_a->next : NULL;
+	if (!pad_b)
+		abort();
+}
+
+
+static struct expr *parse(const char *s)
+{
+	struct expr *expr;
+
+	expr = parse_expr(s);
+	if (!expr) {
+		fprintf(stderr, "cannot parse \"%s\"\n", s);
+		exit(1);
+	}
+	return expr;
+}
+
+
+/* ----- eval_num ---------------------------------------------------------- */
+
+
+#define	N_EXPRS	4
+
+static struct expr *exprs[N_EXPRS];
+
+
+static void setup_eval(void)
+{
+	exprs[0] = parse("col*e-Px/2");
+	exprs[1] = parse("row*-e-Px/2+0.1mm");
+	exprs[2] = parse("sqrt(Px*Px+e*e)");
+	exprs[3] = parse("2.54mm+100mil-(3+4)*Px/5");
+}
+
+
+static void run_eval(unsigned long n)
+{
+	unsigned long i;
+
+	for (i = 0; i != n; i++)
+		if (is_undef(eval_num(exprs[i % N_EXPRS], pad_frame)))
+			abort();
+}
+
+
+/* ----- unique ------------------------------------------------------------ */
+
+
+#define	N_NAMES	256
+
+static char *names[N_NAMES];
+
+
+static void setup_unique(void)
+{
+	int i;
+
+	for (i = 0; i != N_NAMES; i++) {
+		names[i] = stralloc_printf("name_%d", i);
+		unique(names[i]);
+	}
+}
+
+
+static void run_unique(unsigned long n)
+{
+	unsigned long i;
+
+	for (i = 0; i != n; i++)
+		unique(names[i % N_NAMES]);
+}
+
+
+/* ----- expand ------------------------------------------------------------ */
+
+
+static void run_expand(unsigned long n)
+{
+	unsigned long i;
+	char *s;
+
+	for (i = 0; i != n; i++) {
+		s = expand("${rname}$col", pad_frame);
+		if (!s)
+			abort();
+		free(s);
+	}
+}
+
+
+/* ----- overlap and inside ------------------------------------------------ */
+
+
+static void run_overlap(unsigned long n)
+{
+	unsigned long i;
+
+	for (i = 0; i != n; i++)
+		if (overlap(pad_a, pad_b, ao_none))
+			abort();
+}
+
+
+static void run_inside(unsigned long n)
+{
+	unsigned long i;
+
+	for (i = 0; i != n; i++)
+		if (!inside(pad_a, pad_a))
+			abort();
+}
+
+
+/* ----- dist_rect and dist_rects ----------------------------------------- */
+
+
+#define	N_RECTS		1024
+
+static unit_type rect_ax[N_RECTS], rect_ay[N_RECTS];
+static unit_type rect_bx[N_RECTS], rect_by[N_RECTS];
+static unit_type rect_d[N_RECTS];
+static const struct coord rect_pos = { 12345, -6789 };
+
+
+static void setup_rects(void)
+{
+	int i;
+
+	for (i = 0; i != N_RECTS; i++) {
+		rect_ax[i] = (i % 32)*10000;
+		rect_ay[i] = (i / 32)*10000;
+		rect_bx[i] = rect_ax[i]+6000;
+		rect_by[i] = rect_ay[i]+4000;
+	}
+}
+
+
+static void run_dist_rect(unsigned long n)
+{
+	struct coord a, b;
+	unsigned long i;
+	int j;
+
+	for (i = 0; i != n; i++)
+		for (j = 0; j != N_RECTS; j++) {
+			a.x = rect_ax[j];
+			a.y = rect_ay[j];
+			b.x = rect_bx[j];
+			b.y = rect_by[j];
+			rect_d[j] = dist_rect(rect_pos, a, b);
+		}
+}
+
+
+static void run_dist_rects(unsigned long n)
+{
+	unsigned long i;
+
+	for (i = 0; i != n; i++)
+		dist_rects(rect_pos, rect_ax, rect_ay, rect_bx, rect_by,
+		    N_RECTS, rect_d);
+}
+
+
+/* ----- meas_post and meas_find_next -------------------------------------- */
+
+
+#define	N_POS		64
+#define	N_FRAMES	8
+
+static struct sample *samples[1];
+static struct pkg meas_pkg = {
+	.name = "meas",
+	.samples = samples,
+	.n_samples = 1,
+};
+static struct vec meas_vec;
+static struct bitset *meas_set;
+static struct coord meas_pos[N_POS];
+
+
+static void setup_meas(void)
+{
+	int i;
+
+	if (meas_set)
+		return;
+	meas_set = bitset_new(N_FRAMES);
+	bitset_set(meas_set, 0);
+	bitset_set(meas_set, 3);
+	for (i = 0; i != N_POS; i++) {
+		meas_pos[i].x = mm_to_units((i*37) % N_POS);
+		meas_pos[i].y = mm_to_units((i*11) % 5);
+	}
+	meas_vec.n = 0;
+	curr_pkg = &meas_pkg;
+}
+
+
+static void run_meas_post(unsigned long n)
+{
+	unsigned long i;
+
+	for (i = 0; i != n; i++) {
+		if (!(i % N_POS))
+			reset_samples(samples, 1);
+		meas_post(&meas_vec, meas_pos[i % N_POS], meas_set);
+	}
+	reset_samples(samples, 1);
+}
+
+
+static void setup_meas_find(void)
+{
+	int i;
+
+	setup_meas();
+	for (i = 0; i != N_POS; i++)
+		meas_post(&meas_vec, meas_pos[i], meas_set);
+}
+
+
+static void run_meas_find_next(unsigned long n)
+{
+	unsigned long i;
+
+	for (i = 0; i != n; i++)
+		(void) meas_find_next(lt_xy, samples[0], meas_pos[i % N_POS],
+		    meas_set);
+}
+
+
+/* ----- bitset ------------------------------------------------------------ */
+
+
+static struct bitset *set_a, *set_b;
+
+
+static void setup_bitset(void)
+{
+	set_a = bitset_new(N_FRAMES);
+	set_b = bitset_new(N_FRAMES);
+	bitset_set(set_a, 1);
+	bitset_set(set_a, 5);
+	bitset_set(set_b, 5);
+}
+
+
+static void run_bitset_clone(unsigned long n)
+{
+	unsigned long i;
+
+	for (i = 0; i != n; i++)
+		bitset_free(bitset_clone(set_a));
+}
+
+
+static void run_bitset_ops(unsigned long n)
+{
+	unsigned long i;
+
+	for (i = 0; i != n; i++) {
+		bitset_or(set_a, set_b);
+		bitset_and(set_a, set_a);
+		if (!bitset_ge(set_a, set_b) || bitset_is_empty(set_a))
+			abort();
+	}
+}
+
+
+/* ----- end_tsort --------------------------------------------------------- */
+
+
+#define	N_NODES	200
+
+static int node_user[N_NODES];
+
+
+static void run_tsort(unsigned long n)
+{
+	struct tsort *tsort;
+	struct node *nodes[N_NODES];
+	void **res;
+	unsigned long i;
+	int j;
+
+	for (i = 0; i != n; i++) {
+		tsort = begin_tsort();
+		for (j = 0; j != N_NODES; j++)
+			nodes[j] = add_node(tsort, node_user+j, !(j % 10));
+		for (j = 1; j != N_NODES; j++) {
+			add_edge(nodes[j/2], nodes[j], 0);
+			if (j % 3 == 0)
+				add_edge(nodes[j-1], nodes[j], 1);
+		}
+		res = end_tsort(tsort);
+		free(res);
+	}
+}
+
+
+/* ----- Benchmark driver -------------------------------------------------- */
+
+
+static const struct bench {
+	const char *name;
+	void (*setup)(void);
+	void (*run)(unsigned long n);
+	const char *unit;	/* what an operation is */
+} benches[] = {
+	{ "eval_num",		setup_eval,	run_eval,	"expr" },
+	{ "unique",		setup_unique,	run_unique,	"lookup" },
+	{ "expand",		NULL,		run_expand,	"name" },
+	{ "overlap",		NULL,		run_overlap,	"pair" },
+	{ "inside",		NULL,		run_inside,	"pair" },
+	{ "dist_rect",		setup_rects,	run_dist_rect,	"1k rects" },
+	{ "dist_rects",		setup_rects,	run_dist_rects,	"1k rects" },
+	{ "meas_post",		setup_meas,	run_meas_post,	"sample" },
+	{ "meas_find_next",	setup_meas_find, run_meas_find_next, "search" },
+	{ "bitset_clone",	setup_bitset,	run_bitset_clone, "clone" },
+	{ "bitset_ops",		setup_bitset,	run_bitset_ops,	"and+or+ge" },
+	{ "end_tsort",		NULL,		run_tsort,	"sort" },
+	{ NULL }
+};
+
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+
+static void run_bench(const struct bench *b)
+{
+	unsigned long n = 1;
+	double t;
+
+	if (b->setup)
+		b->setup();
+	while (1) {
+		allocs = 0;
+		t = now();
+		b->run(n);
+		t = now()-t;
+		if (t >= BENCH_TIME)
+			break;
+		n *= t < BENCH_TIME/10 ? 10 : 2;
+	}
+	printf("%-16s %12.1f ns/%-10s %8.2f allocs/op  (%lu ops)\n",
+	    b->name, t*1e9/n, b->unit, (double) allocs/n, n);
+}
+
+
+static int selected(const struct bench *b, int argc, char **argv)
+{
+	int i;
+
+	if (argc == 1)
+		return 1;
+	for (i = 1; i != argc; i++)
+		if (!strcmp(argv[i], b->name))
+			return 1;
+	return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+	const struct bench *b;
+
+	load_model();
+	for (b = benches; b->name; b++)
+		if (selected(b, argc, argv))
+			run_bench(b);
+	return 0;
+}
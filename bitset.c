@@ -20,12 +20,48 @@
 #include "bitset.h"
 
 
-struct bitset {
-	int v_n;
-	unsigned *v;
-};
+#define BITS	(sizeof(unsigned long)*8)
 
-#define BITS	(sizeof(unsigned)*8)
+
+static inline unsigned long *words(struct bitset *set)
+{
+	return set->v_n <= BITSET_INLINE ? set->v.w : set->v.p;
+}
+
+
+static inline const unsigned long *const_words(const struct bitset *set)
+{
+	return set->v_n <= BITSET_INLINE ? set->v.w : set->v.p;
+}
+
+
+void bitset_init(struct bitset *set, int n)
+{
+	set->v_n = (n+BITS-1)/BITS;
+	if (set->v_n <= BITSET_INLINE)
+		memset(set->v.w, 0, sizeof(set->v.w));
+	else
+		set->v.p = zalloc_size(sizeof(unsigned long)*set->v_n);
+}
+
+
+void bitset_init_clone(struct bitset *set, const struct bitset *old)
+{
+	set->v_n = old->v_n;
+	if (set->v_n <= BITSET_INLINE) {
+		set->v = old->v;
+	} else {
+		set->v.p = alloc_size(sizeof(unsigned long)*set->v_n);
+		memcpy(set->v.p, old->v.p, sizeof(unsigned long)*set->v_n);
+	}
+}
+
+
+void bitset_release(struct bitset *set)
+{
+	if (set->v_n > BITSET_INLINE)
+		free(set->v.p);
+}
 
 
 struct bitset *bitset_new(int n)
@@ -33,8 +69,7 @@ struct bitset *bitset_new(int n)
 	struct bitset *new;
 
 	new = alloc_type(struct bitset);
-	new->v_n = (n+BITS-1) & ~(BITS-1);
-	new->v = zalloc_size(sizeof(unsigned)*new->v_n);
+	bitset_init(new, n);
 	return new;
 }
 
@@ -42,51 +77,55 @@ struct bitset *bitset_new(int n)
 struct bitset *bitset_clone(const struct bitset *old)
 {
 	struct bitset *new;
-	size_t bytes;
 
 	new = alloc_type(struct bitset);
-	bytes = sizeof(unsigned)*old->v_n;
-	new->v_n = old->v_n;
-	new->v = alloc_size(bytes);
-	memcpy(new->v, old->v, bytes);
+	bitset_init_clone(new, old);
 	return new;
 }
 
 
 void bitset_free(struct bitset *set)
 {
-	free(set->v);
+	bitset_release(set);
 	free(set);
 }
 
 
+void bitset_copy(struct bitset *a, const struct bitset *b)
+{
+	assert(a->v_n == b->v_n);
+	memcpy(words(a), const_words(b), sizeof(unsigned long)*a->v_n);
+}
+
+
 void bitset_set(struct bitset *set, int n)
 {
 	assert(n < set->v_n*BITS);
-	set->v[n/BITS] |= 1U << (n % BITS);
+	words(set)[n/BITS] |= 1UL << (n % BITS);
 }
 
 
 void bitset_clear(struct bitset *set, int n)
 {
 	assert(n < set->v_n*BITS);
-	set->v[n/BITS] &= ~(1U << (n % BITS));
+	words(set)[n/BITS] &= ~(1UL << (n % BITS));
 }
 
 
 int bitset_pick(const struct bitset *set, int n)
 {
 	assert(n < set->v_n*BITS);
-	return !!(set->v[n/BITS] & (1U << (n % BITS)));
+	return !!(const_words(set)[n/BITS] & (1UL << (n % BITS)));
 }
 
 
 int bitset_is_empty(const struct bitset *set)
 {
+	const unsigned long *v = const_words(set);
 	int i;
 
 	for (i = 0; i != set->v_n; i++)
-		if (set->v[i])
+		if (v[i])
 			return 0;
 	return 1;
 }
@@ -94,40 +133,43 @@ int bitset_is_empty(const struct bitset *set)
 
 void bitset_zero(struct bitset *a)
 {
-	int i;
-
-	for (i = 0; i != a->v_n; i++)
-		a->v[i] = 0;
+	memset(words(a), 0, sizeof(unsigned long)*a->v_n);
 }
 
 
 void bitset_and(struct bitset *a, const struct bitset *b)
 {
+	unsigned long *va = words(a);
+	const unsigned long *vb = const_words(b);
 	int i;
 
 	assert(a->v_n == b->v_n);
 	for (i = 0; i != a->v_n; i++)
-		a->v[i] &= b->v[i];
+		va[i] &= vb[i];
 }
 
 
 void bitset_or(struct bitset *a, const struct bitset *b)
 {
+	unsigned long *va = words(a);
+	const unsigned long *vb = const_words(b);
 	int i;
 
 	assert(a->v_n == b->v_n);
 	for (i = 0; i != a->v_n; i++)
-		a->v[i] |= b->v[i];
+		va[i] |= vb[i];
 }
 
 
 int bitset_ge(const struct bitset *a, const struct bitset *b)
 {
+	const unsigned long *va = const_words(a);
+	const unsigned long *vb = const_words(b);
 	int i;
 
 	assert(a->v_n == b->v_n);
 	for (i = 0; i != a->v_n; i++)
-		if (~a->v[i] & b->v[i])
+		if (~va[i] & vb[i])
 			return 0;
 	return 1;
 }
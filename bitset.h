@@ -13,12 +13,31 @@
 #ifndef BITSET_H
 #define BITSET_H
 
-struct bitset;
+/*
+ * Sets of up to BITSET_INLINE words are kept in the structure itself, so that
+ * they can be embedded in other structures or put on the stack without
+ * allocating anything. Use bitset_init and bitset_release for these.
+ */
+
+#define	BITSET_INLINE	2
+
+struct bitset {
+	int v_n;		/* words */
+	union {
+		unsigned long w[BITSET_INLINE];
+		unsigned long *p;
+	} v;
+};
 
 struct bitset *bitset_new(int n);
 struct bitset *bitset_clone(const struct bitset *old);
 void bitset_free(struct bitset *set);
 
+void bitset_init(struct bitset *set, int n);
+void bitset_init_clone(struct bitset *set, const struct bitset *old);
+void bitset_release(struct bitset *set);
+void bitset_copy(struct bitset *a, const struct bitset *b);
+
 void bitset_set(struct bitset *set, int n);
 void bitset_clear(struct bitset *set, int n);
 int bitset_pick(const struct bitset *set, int n);
@@ -13,6 +13,11 @@
 
 #include <math.h>
 
+#if defined(__SSE2__) && !defined(__FMA__) && defined(__OPTIMIZE__)
+#define	USE_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "util.h"
 #include "coord.h"
 
@@ -173,31 +178,39 @@ unit_type dist_point(struct coord a, struct coord b)
 }
 
 
-static unit_type dist_line_xy(unit_type px, unit_type py,
-    unit_type ax, unit_type ay, unit_type bx, unit_type by)
+/*
+ * dist_line and dist_rect share their arithmetic with dist_lines and
+ * dist_rects, so that a hit test gets the same distance whichever way it is
+ * computed. We keep intermediate results in double and only round the final
+ * distance.
+ */
+
+static inline double len_xy(double x, double y)
 {
-	unit_type d_min, d;
-	double a, f;
+	return sqrt(x*x+y*y);
+}
 
-	d_min = hypot(ax-px, ay-py);
-	d = hypot(bx-px, by-py);
+
+static double seg_dist(double px, double py, double ax, double ay,
+    double bx, double by)
+{
+	double vx = ax-bx, vy = ay-by;
+	double wx = px-bx, wy = py-by;
+	double d_min, d, l, f;
+
+	d_min = len_xy(ax-px, ay-py);
+	d = len_xy(wx, wy);
 	if (d < d_min)
 		d_min = d;
-	if (ax != bx || ay != by) {
+	l = vx*vx+vy*vy;
+	if (l) {
 		/*
-		 * We make a the line vector from point B and b the vector from
-		 * B to point P. Then we calculate the projection of b on a.
+		 * "v" is the line vector from point B and "w" the vector from
+		 * B to point P. "f" is the projection of w on v.
 		 */
-		ax -= bx;
-		ay -= by;
-		bx = px-bx;
-		by = py-by;
-		a = hypot(ax, ay);
-		f = ((double) ax*bx+(double) ay*by)/a/a;
+		f = (vx*wx+vy*wy)/l;
 		if (f >= 0 && f <= 1) {
-			bx -= f*ax;
-			by -= f*ay;
-			d = hypot(bx, by);
+			d = len_xy(wx-f*vx, wy-f*vy);
 			if (d < d_min)
 				d_min = d;
 		}
@@ -206,30 +219,46 @@ static unit_type dist_line_xy(unit_type px, unit_type py,
 }
 
 
-unit_type dist_line(struct coord p, struct coord a, struct coord b)
-{
-	return dist_line_xy(p.x, p.y, a.x, a.y, b.x, b.y);
-}
-
+/*
+ * We sort the corners, so that the result doesn't depend on which two
+ * opposite corners define the rectangle.
+ */
 
-unit_type dist_rect(struct coord p, struct coord a, struct coord b)
+static double rect_dist(double px, double py, double ax, double ay,
+    double bx, double by)
 {
-	unit_type d_min, d;
-
-	d_min = dist_line_xy(p.x, p.y, a.x, a.y, b.x, a.y);
-	d = dist_line_xy(p.x, p.y, a.x, a.y, a.x, b.y);
+	double d_min, d;
+
+	if (ax > bx)
+		SWAP(ax, bx);
+	if (ay > by)
+		SWAP(ay, by);
+	d_min = seg_dist(px, py, ax, ay, bx, ay);
+	d = seg_dist(px, py, ax, ay, ax, by);
 	if (d < d_min)
 		d_min = d;
-	d = dist_line_xy(p.x, p.y, a.x, b.y, b.x, b.y);
+	d = seg_dist(px, py, ax, by, bx, by);
 	if (d < d_min)
 		d_min = d;
-	d = dist_line_xy(p.x, p.y, b.x, a.y, b.x, b.y);
+	d = seg_dist(px, py, bx, ay, bx, by);
 	if (d < d_min)
 		d_min = d;
 	return d_min;
 }
 
 
+unit_type dist_line(struct coord p, struct coord a, struct coord b)
+{
+	return seg_dist(p.x, p.y, a.x, a.y, b.x, b.y);
+}
+
+
+unit_type dist_rect(struct coord p, struct coord a, struct coord b)
+{
+	return rect_dist(p.x, p.y, a.x, a.y, b.x, b.y);
+}
+
+
 int inside_rect(struct coord p, struct coord a, struct coord b)
 {
 	sort_coord(&a, &b);
@@ -248,3 +277,120 @@ unit_type dist_circle(struct coord p, struct coord c, unit_type r)
 	d = hypot(p.x-c.x, p.y-c.y);
 	return fabs(d-r);
 }
+
+
+/* ----- batched distances ------------------------------------------------- */
+
+
+/*
+ * The batched versions give exactly the same results as the single ones. With
+ * SSE2, dist_lines and dist_rects handle two items per step, with the same
+ * operations in the same order, and do the rest one by one. If the compiler
+ * may fuse multiplications and additions, the scalar code would round
+ * differently, so we don't use SSE2 then. Without optimization, the vector
+ * code is slower than the scalar loop, so we only use it when optimizing.
+ * dist_points uses hypot, like dist_point, and has no vector version.
+ */
+
+
+#ifdef USE_SSE2
+
+static inline __m128d load2(const unit_type *u)
+{
+	return _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *) u));
+}
+
+
+static inline void store2(unit_type *u, __m128d v)
+{
+	_mm_storel_epi64((__m128i *) u, _mm_cvttpd_epi32(v));
+}
+
+
+static inline __m128d len2(__m128d x, __m128d y)
+{
+	return _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(x, x), _mm_mul_pd(y, y)));
+}
+
+
+/*
+ * For a segment of zero length, "f" is NaN and fails both comparisons.
+ */
+
+static inline __m128d seg_dist2(__m128d px, __m128d py,
+    __m128d ax, __m128d ay, __m128d bx, __m128d by)
+{
+	__m128d vx = _mm_sub_pd(ax, bx), vy = _mm_sub_pd(ay, by);
+	__m128d wx = _mm_sub_pd(px, bx), wy = _mm_sub_pd(py, by);
+	__m128d d_min, d, l, f, on;
+
+	d_min = _mm_min_pd(len2(_mm_sub_pd(ax, px), _mm_sub_pd(ay, py)),
+	    len2(wx, wy));
+	l = _mm_add_pd(_mm_mul_pd(vx, vx), _mm_mul_pd(vy, vy));
+	f = _mm_div_pd(_mm_add_pd(_mm_mul_pd(vx, wx), _mm_mul_pd(vy, wy)), l);
+	on = _mm_and_pd(_mm_cmpge_pd(f, _mm_setzero_pd()),
+	    _mm_cmple_pd(f, _mm_set1_pd(1)));
+	d = len2(_mm_sub_pd(wx, _mm_mul_pd(f, vx)),
+	    _mm_sub_pd(wy, _mm_mul_pd(f, vy)));
+	d = _mm_or_pd(_mm_and_pd(on, d), _mm_andnot_pd(on, d_min));
+	return _mm_min_pd(d_min, d);
+}
+
+#endif /* USE_SSE2 */
+
+
+void dist_points(struct coord p, const unit_type *x, const unit_type *y,
+    int n, unit_type *d)
+{
+	int i;
+
+	for (i = 0; i != n; i++)
+		d[i] = hypot(p.x-x[i], p.y-y[i]);
+}
+
+
+void dist_lines(struct coord p, const unit_type *ax, const unit_type *ay,
+    const unit_type *bx, const unit_type *by, int n, unit_type *d)
+{
+	int i = 0;
+
+#ifdef USE_SSE2
+	__m128d px = _mm_set1_pd(p.x), py = _mm_set1_pd(p.y);
+
+	for (; i+2 <= n; i += 2)
+		store2(d+i, seg_dist2(px, py,
+		    load2(ax+i), load2(ay+i), load2(bx+i), load2(by+i)));
+#endif
+	for (; i != n; i++)
+		d[i] = seg_dist(p.x, p.y, ax[i], ay[i], bx[i], by[i]);
+}
+
+
+void dist_rects(struct coord p, const unit_type *ax, const unit_type *ay,
+    const unit_type *bx, const unit_type *by, int n, unit_type *d)
+{
+	int i = 0;
+
+#ifdef USE_SSE2
+	__m128d px = _mm_set1_pd(p.x), py = _mm_set1_pd(p.y);
+	__m128d xa, ya, xb, yb, u, v, d_min;
+
+	for (; i+2 <= n; i += 2) {
+		u = load2(ax+i);
+		v = load2(bx+i);
+		xa = _mm_min_pd(u, v);
+		xb = _mm_max_pd(u, v);
+		u = load2(ay+i);
+		v = load2(by+i);
+		ya = _mm_min_pd(u, v);
+		yb = _mm_max_pd(u, v);
+		d_min = seg_dist2(px, py, xa, ya, xb, ya);
+		d_min = _mm_min_pd(d_min, seg_dist2(px, py, xa, ya, xa, yb));
+		d_min = _mm_min_pd(d_min, seg_dist2(px, py, xa, yb, xb, yb));
+		d_min = _mm_min_pd(d_min, seg_dist2(px, py, xb, ya, xb, yb));
+		store2(d+i, d_min);
+	}
+#endif
+	for (; i != n; i++)
+		d[i] = rect_dist(p.x, p.y, ax[i], ay[i], bx[i], by[i]);
+}
@@ -102,4 +102,16 @@ unit_type dist_rect(struct coord p, struct coord a, struct coord b);
 int inside_rect(struct coord p, struct coord a, struct coord b);
 unit_type dist_circle(struct coord p, struct coord c, unit_type r);
 
+/*
+ * The batched versions store in "d" the distances of "p" from "n" points,
+ * lines, or rectangles, given as arrays of coordinates.
+ */
+
+void dist_points(struct coord p, const unit_type *x, const unit_type *y,
+    int n, unit_type *d);
+void dist_lines(struct coord p, const unit_type *ax, const unit_type *ay,
+    const unit_type *bx, const unit_type *by, int n, unit_type *d);
+void dist_rects(struct coord p, const unit_type *ax, const unit_type *ay,
+    const unit_type *bx, const unit_type *by, int n, unit_type *d);
+
 #endif /* !COORD_H */
@@ -17,7 +17,9 @@
 #include "util.h"
 #include "error.h"
 #include "expr.h"
+#include "hash.h"
 #include "obj.h"
+#include "journal.h"
 #include "delete.h"
 
 
@@ -70,128 +72,362 @@ static struct deletion {
 static int groups = 0;
 
 
+/*
+ * While deleting, we keep an index of who refers to what, so that cascading
+ * deletions don't have to search the lists over and over again.
+ */
+
+struct ref_entry {
+	const void *item;	/* vector, object, or frame */
+	void *prev;		/* item before it in its list */
+	int deleted;
+	int indexed;		/* frame: its items are in the index */
+	struct vec **vecs;	/* vector: vectors based on it */
+	int n_vecs;
+	struct obj **objs;	/* vector: objects using it; frame: references */
+	int n_objs;
+};
+
+
+static struct hash *refs = NULL;
+static int refs_complete;	/* all frame references are in the index */
+
+
 static void do_delete_vec(struct vec *vec);
 static void do_delete_obj(struct obj *obj);
 
 
-/* ----- helper functions -------------------------------------------------- */
+/* ----- reverse references ------------------------------------------------ */
 
 
-static struct deletion *new_deletion(enum del_type type)
+static unsigned hash_ref(const void *item)
 {
-	struct deletion *del;
+	const struct ref_entry *e = item;
 
-	del = alloc_type(struct deletion);
-	del->type = type;
-	del->group = groups;
-	del->next = deletions;
-	deletions = del;
-	return del;
+	return hash_bytes(HASH_INIT, &e->item, sizeof(e->item));
 }
 
 
-static void reset_active_ref(struct frame *ref)
+static int eq_ref(const void *a, const void *b)
 {
-	const struct frame *frame;
-	struct obj *obj = NULL;
+	const struct ref_entry *ea = a, *eb = b;
 
-	for (frame = frames; frame; frame = frame->next)
-		for (obj = frame->objs; obj; obj = obj->next)
-			if (obj->type == ot_frame && obj->u.frame.ref == ref)
-				break;
-	ref->active_ref = obj;
+	return ea->item == eb->item;
 }
 
 
-/* ----- vectors ----------------------------------------------------------- */
+static void free_ref(void *item)
+{
+	struct ref_entry *e = item;
 
+	free(e->vecs);
+	free(e->objs);
+	free(e);
+}
 
-static void destroy_vec(struct vec *vec)
+
+static struct ref_entry *ref_entry(const void *item)
 {
-	free_expr(vec->x);
-	free_expr(vec->y);
-	free(vec);
+	struct ref_entry key, *e;
+
+	key.item = item;
+	e = hash_lookup(refs, &key);
+	if (!e) {
+		e = zalloc_type(struct ref_entry);
+		e->item = item;
+		hash_add(refs, e);
+	}
+	return e;
 }
 
 
-static void delete_vecs_by_ref(struct vec *vecs, const struct vec *ref)
+static void add_vec_ref(const struct vec *ref, struct vec *vec)
 {
-	while (vecs) {
-		if (vecs->base == ref)
-			do_delete_vec(vecs);
-		vecs = vecs->next;
-	}
+	struct ref_entry *e = ref_entry(ref);
+
+	e->vecs = realloc(e->vecs, sizeof(struct vec *)*(e->n_vecs+1));
+	if (!e->vecs)
+		abort();
+	e->vecs[e->n_vecs++] = vec;
 }
 
 
-static int obj_has_ref(const struct obj *obj, const struct vec *ref)
+static void add_obj_ref(const void *ref, struct obj *obj)
 {
-	if (obj->base == ref)
-		return 1;
+	struct ref_entry *e;
+
+	if (!ref)
+		return;
+	e = ref_entry(ref);
+	if (e->n_objs && e->objs[e->n_objs-1] == obj)
+		return;
+	e->objs = realloc(e->objs, sizeof(struct obj *)*(e->n_objs+1));
+	if (!e->objs)
+		abort();
+	e->objs[e->n_objs++] = obj;
+}
+
+
+static void index_obj(struct obj *obj)
+{
+	add_obj_ref(obj->base, obj);
 	switch (obj->type) {
 	case ot_frame:
-		return 0;
+	case ot_iprint:
+		break;
 	case ot_line:
-		return obj->u.line.other == ref;
+		add_obj_ref(obj->u.line.other, obj);
+		break;
 	case ot_rect:
-		return obj->u.rect.other == ref;
+		add_obj_ref(obj->u.rect.other, obj);
+		break;
 	case ot_pad:
-		return obj->u.pad.other == ref;
+		add_obj_ref(obj->u.pad.other, obj);
+		break;
 	case ot_hole:
-		return obj->u.hole.other == ref;
+		add_obj_ref(obj->u.hole.other, obj);
+		break;
 	case ot_arc:
-		return obj->u.arc.start == ref || obj->u.arc.end == ref;
+		add_obj_ref(obj->u.arc.start, obj);
+		add_obj_ref(obj->u.arc.end, obj);
+		break;
 	case ot_meas:
-		return obj->u.meas.high == ref;
-	case ot_iprint:
-		return 0;
+		add_obj_ref(obj->u.meas.high, obj);
+		break;
 	default:
 		abort();
 	}
 }
 
 
-static void delete_objs_by_ref(struct obj **objs, const struct vec *ref)
+static void index_frame(const struct frame *frame)
 {
+	struct ref_entry *e = ref_entry(frame);
+	struct vec *vec, *prev_vec = NULL;
+	struct obj *obj, *prev_obj = NULL;
+
+	if (e->indexed)
+		return;
+	e->indexed = 1;
+	for (vec = frame->vecs; vec; vec = vec->next) {
+		ref_entry(vec)->prev = prev_vec;
+		if (vec->base)
+			add_vec_ref(vec->base, vec);
+		prev_vec = vec;
+	}
+	for (obj = frame->objs; obj; obj = obj->next) {
+		ref_entry(obj)->prev = prev_obj;
+		index_obj(obj);
+		prev_obj = obj;
+	}
+}
+
+
+/*
+ * The references to a frame must be in the order of the frames and their
+ * objects, since reset_active_ref picks the first one. We therefore collect
+ * them separately, in one pass.
+ */
+
+static void index_frame_refs(void)
+{
+	const struct frame *frame;
 	struct obj *obj;
 
-	for (obj = *objs; obj; obj = obj->next)
-		if (obj_has_ref(obj, ref))
-			do_delete_obj(obj);
+	if (refs_complete)
+		return;
+	refs_complete = 1;
+	for (frame = frames; frame; frame = frame->next)
+		for (obj = frame->objs; obj; obj = obj->next)
+			if (obj->type == ot_frame)
+				add_obj_ref(obj->u.frame.ref, obj);
+}
+
+
+static void begin_refs(void)
+{
+	refs = hash_new(hash_ref, eq_ref);
+	refs_complete = 0;
+}
+
+
+static void end_refs(void)
+{
+	hash_free(refs, free_ref);
+	refs = NULL;
 }
 
 
+/* ----- helper functions -------------------------------------------------- */
+
+
+static struct deletion *new_deletion(enum del_type type)
+{
+	struct deletion *del;
+
+	del = alloc_type(struct deletion);
+	del->type = type;
+	del->group = groups;
+	del->next = deletions;
+	deletions = del;
+	return del;
+}
+
+
+/*
+ * Undoing a deletion undeletes the most recent group, which is the one the
+ * deletion has created, since the journal undoes changes in reverse order.
+ * Redoing it simply deletes the item again.
+ */
+
+struct redo_deletion {
+	enum del_type type;
+	void *item;
+	int n;			/* column number */
+};
+
+
+static void undo_deletion(void *user)
+{
+	undelete();
+}
+
+
+static void redo_deletion(void *user)
+{
+	const struct redo_deletion *r = user;
+
+	switch (r->type) {
+	case dt_vec:
+		delete_vec(r->item);
+		break;
+	case dt_obj:
+		delete_obj(r->item);
+		break;
+	case dt_frame:
+		delete_frame(r->item);
+		break;
+	case dt_loop:
+		delete_loop(r->item);
+		break;
+	case dt_table:
+		delete_table(r->item);
+		break;
+	case dt_row:
+		delete_row(r->item);
+		break;
+	case dt_column:
+		delete_column(r->item, r->n);
+		break;
+	default:
+		abort();
+	}
+}
+
+
+static void record_deletion(enum del_type type, void *item, int n)
+{
+	struct redo_deletion *r;
+
+	r = alloc_type(struct redo_deletion);
+	r->type = type;
+	r->item = item;
+	r->n = n;
+	journal_call(undo_deletion, redo_deletion, r);
+}
+
+
+static void set_active_ref(struct frame *ref, struct obj *obj)
+{
+	journal_store(&ref->active_ref, sizeof(ref->active_ref));
+	ref->active_ref = obj;
+}
+
+
+static void reset_active_ref(struct frame *ref)
+{
+	const struct frame *frame;
+	const struct ref_entry *e;
+	struct obj *obj = NULL;
+	int i;
+
+	if (refs) {
+		index_frame_refs();
+		e = ref_entry(ref);
+		for (i = 0; i != e->n_objs; i++)
+			if (!ref_entry(e->objs[i])->deleted) {
+				obj = e->objs[i];
+				break;
+			}
+		set_active_ref(ref, obj);
+		return;
+	}
+	for (frame = frames; frame; frame = frame->next)
+		for (obj = frame->objs; obj; obj = obj->next)
+			if (obj->type == ot_frame && obj->u.frame.ref == ref)
+				break;
+	set_active_ref(ref, obj);
+}
+
+
+/* ----- vectors ----------------------------------------------------------- */
+
+
+static void destroy_vec(struct vec *vec)
+{
+	free_expr(vec->x);
+	free_expr(vec->y);
+	free(vec);
+}
+
+
+/*
+ * The vectors based on this one are in the same frame. Measurements in the
+ * root frame can also use it.
+ */
+
 static void do_delete_vec(struct vec *vec)
 {
-	struct vec *walk, *prev;
+	struct ref_entry *e = ref_entry(vec);
+	struct vec *prev = e->prev;
 	struct deletion *del;
+	int i;
 
-	prev = NULL;
-	for (walk = vec->frame->vecs; walk != vec; walk = walk->next)
-		prev = walk;
 	if (prev)
 		prev->next = vec->next;
 	else
 		vec->frame->vecs = vec->next;
+	if (vec->next)
+		ref_entry(vec->next)->prev = prev;
+	e->deleted = 1;
 	del = new_deletion(dt_vec);
 	del->u.vec.ref = vec;
 	del->u.vec.prev = prev;
 
-	delete_vecs_by_ref(vec->frame->vecs, vec);
-	delete_objs_by_ref(&vec->frame->objs, vec);
-	/*
-	 * Catch measurements. During final cleanup, we may operate on an empty
-	 * list of frames, hence the test.
-	 */
-	if (frames)
-		delete_objs_by_ref(&frames->objs, vec);
+	for (i = 0; i != e->n_vecs; i++)
+		if (!ref_entry(e->vecs[i])->deleted)
+			do_delete_vec(e->vecs[i]);
+	for (i = 0; i != e->n_objs; i++)
+		if (!ref_entry(e->objs[i])->deleted)
+			do_delete_obj(e->objs[i]);
 }
 
 
+/*
+ * During final cleanup, we may operate on an empty list of frames, hence the
+ * test.
+ */
+
 void delete_vec(struct vec *vec)
 {
+	record_deletion(dt_vec, vec, 0);
 	groups++;
+	begin_refs();
+	index_frame(vec->frame);
+	if (frames)
+		index_frame(frames);
 	do_delete_vec(vec);
+	end_refs();
 }
 
 
@@ -252,28 +488,38 @@ static void destroy_obj(struct obj *obj)
 
 static void do_delete_obj(struct obj *obj)
 {
-	struct obj *walk, *prev;
+	struct ref_entry *e;
+	struct obj *prev;
 	struct deletion *del;
 
-	prev = NULL;
-	for (walk = obj->frame->objs; walk != obj; walk = walk->next)
-		prev = walk;
+	index_frame(obj->frame);
+	e = ref_entry(obj);
+	prev = e->prev;
 	if (prev)
 		prev->next = obj->next;
 	else
 		obj->frame->objs = obj->next;
+	if (obj->next)
+		ref_entry(obj->next)->prev = prev;
+	e->deleted = 1;
 	del = new_deletion(dt_obj);
 	del->u.obj.ref = obj;
 	del->u.obj.prev = prev;
-	if (obj->type == ot_frame && obj->u.frame.ref->active_ref == obj)
-		reset_active_ref(obj->u.frame.ref);
+	if (obj->type == ot_frame) {
+		if (obj->u.frame.ref->active_ref == obj)
+			reset_active_ref(obj->u.frame.ref);
+		frame_refs_changed();
+	}
 }
 
 
 void delete_obj(struct obj *obj)
 {
+	record_deletion(dt_obj, obj, 0);
 	groups++;
+	begin_refs();
 	do_delete_obj(obj);
+	end_refs();
 }
 
 
@@ -286,6 +532,8 @@ static void undelete_obj(struct obj *obj, struct obj *prev)
 		assert(obj->next == obj->frame->objs);
 		obj->frame->objs = obj;
 	}
+	if (obj->type == ot_frame)
+		frame_refs_changed();
 }
 
 
@@ -312,6 +560,7 @@ void delete_row(struct row *row)
 	struct deletion *del;
 	struct row *walk, *prev;
 
+	record_deletion(dt_row, row, 0);
 	groups++;
 	prev = NULL;
 	for (walk = row->table->rows; walk != row; walk = walk->next)
@@ -350,6 +599,7 @@ void delete_column(struct table *table, int n)
 	struct value **next, **value;
 	int i;
 
+	record_deletion(dt_column, table, n);
 	groups++;
 
 	del = new_deletion(dt_column);
@@ -376,6 +626,20 @@ void delete_column(struct table *table, int n)
 }
 
 
+static void destroy_column(struct column *col)
+{
+	struct value *next;
+
+	free(col->var);
+	while (col->values) {
+		next = col->values->next;
+		free_expr(col->values->expr);
+		free(col->values);
+		col->values = next;
+	}
+}
+
+
 static void undelete_column(const struct column *col)
 {
 	struct var **var;
@@ -428,6 +692,7 @@ void delete_table(struct table *table)
 	struct deletion *del;
 	struct table *walk, *prev;
 
+	record_deletion(dt_table, table, 0);
 	groups++;
 	prev = NULL;
 	for (walk = frame->tables; walk != table; walk = walk->next)
@@ -473,6 +738,7 @@ void delete_loop(struct loop *loop)
 	struct deletion *del;
 	struct loop *walk, *prev;
 
+	record_deletion(dt_loop, loop, 0);
 	groups++;
 	prev = NULL;
 	for (walk = frame->loops; walk != loop; walk = walk->next)
@@ -570,6 +836,8 @@ void delete_frame(struct frame *frame)
 {
 	struct deletion *del;
 	struct frame *walk;
+
+	record_deletion(dt_frame, frame, 0);
 	groups++;
 
 	del = new_deletion(dt_frame);
@@ -582,7 +850,10 @@ void delete_frame(struct frame *frame)
 	else
 		frames = frame->next; /* hmm, deleting the root frame ? */
 
+	begin_refs();
 	delete_references(frame);
+	end_refs();
+	frame_refs_changed();
 }
 
 
@@ -595,6 +866,7 @@ static void undelete_frame(struct frame *frame, struct frame *prev)
 		assert(frame->next == frames);
 		frames = frame;
 	}
+	frame_refs_changed();
 }
 
 
@@ -626,7 +898,7 @@ static void destroy_one(void)
 		destroy_row(del->u.row.ref);
 		break;
 	case dt_column:
-		abort(); /* @@@ later */
+		destroy_column(&del->u.col);
 		break;
 	default:
 		abort();
@@ -703,3 +975,76 @@ void purge(void)
 	while (deletions)
 		destroy();
 }
+
+
+/* ----- items the journal no longer needs --------------------------------- */
+
+
+void discard_expr(void *expr)
+{
+	free_expr(expr);
+}
+
+
+void discard_vec(void *vec)
+{
+	destroy_vec(vec);
+}
+
+
+void discard_obj(void *obj)
+{
+	destroy_obj(obj);
+}
+
+
+void discard_value(void *value)
+{
+	struct value *v = value;
+
+	free_expr(v->expr);
+	free(v);
+}
+
+
+void discard_row(void *row)
+{
+	destroy_row(row);
+}
+
+
+void discard_table(void *table)
+{
+	struct table *t = table;
+	struct var *next_var;
+	struct row *next_row;
+
+	while (t->vars) {
+		next_var = t->vars->next;
+		free(t->vars);
+		t->vars = next_var;
+	}
+	while (t->rows) {
+		next_row = t->rows->next;
+		destroy_row(t->rows);
+		t->rows = next_row;
+	}
+	free(t);
+}
+
+
+void discard_loop(void *loop)
+{
+	destroy_loop(loop);
+}
+
+
+/*
+ * By the time the journal forgets a new frame, everything that has been added
+ * to it has been removed again.
+ */
+
+void discard_frame(void *frame)
+{
+	free(frame);
+}
@@ -29,4 +29,18 @@ void destroy(void);
 int undelete(void);
 void purge(void);
 
+/*
+ * Free functions for journal_replace. They free items that are not linked into
+ * the model.
+ */
+
+void discard_expr(void *expr);
+void discard_vec(void *vec);
+void discard_obj(void *obj);
+void discard_value(void *value);
+void discard_row(void *row);
+void discard_table(void *table);
+void discard_loop(void *loop);
+void discard_frame(void *frame);
+
 #endif /* !DELETE_H */
@@ -0,0 +1,730 @@
+/*
+ * drc.c - Design rule check
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * We describe pads and holes by a "core" box and a radius: the shape is the
+ * set of points within the radius of the core. A rectangular pad is its own
+ * core with radius zero, while the core of a rounded pad or a hole shrinks
+ * to the line or point between the centers of its rounded ends. Distances
+ * between such shapes are then distances between boxes, minus the radii.
+ *
+ * Arcs are the only items we approximate, by chords that stay within
+ * ARC_ERROR of the arc.
+ *
+ * Holes inside pads are covered by their pad, so we only check the pad for
+ * clearance and silk screen. Pads that touch or overlap are connected and
+ * don't need clearance.
+ */
+
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "util.h"
+#include "coord.h"
+#include "expr.h"
+#include "obj.h"
+#include "inst.h"
+#include "drc.h"
+
+
+#define	ARC_ERROR	MICRON_UNITS
+#define	GRID_MAX	256	/* maximum number of cells per row or column */
+
+
+struct num drc_rules[dr_n];
+
+const char *drc_rule_names[dr_n] = {
+	[dr_clearance]	= "clearance",
+	[dr_silk]	= "silk",
+	[dr_ring]	= "ring",
+};
+
+
+struct item {
+	struct inst *inst;
+	double ax, ay, bx, by;	/* core */
+	double r;
+};
+
+
+/* ----- distances --------------------------------------------------------- */
+
+
+static double point_box(double x, double y, const struct item *it)
+{
+	double dx = 0, dy = 0;
+
+	if (x < it->ax)
+		dx = it->ax-x;
+	else if (x > it->bx)
+		dx = x-it->bx;
+	if (y < it->ay)
+		dy = it->ay-y;
+	else if (y > it->by)
+		dy = y-it->by;
+	return hypot(dx, dy);
+}
+
+
+static double box_box(const struct item *a, const struct item *b)
+{
+	double dx = 0, dy = 0;
+
+	if (a->bx < b->ax)
+		dx = b->ax-a->bx;
+	else if (b->bx < a->ax)
+		dx = a->ax-b->bx;
+	if (a->by < b->ay)
+		dy = b->ay-a->by;
+	else if (b->by < a->ay)
+		dy = a->ay-b->by;
+	return hypot(dx, dy);
+}
+
+
+static double point_seg(double x, double y,
+    double ax, double ay, double bx, double by)
+{
+	double dx = bx-ax, dy = by-ay;
+	double len2 = dx*dx+dy*dy;
+	double t;
+
+	if (!len2)
+		return hypot(x-ax, y-ay);
+	t = ((x-ax)*dx+(y-ay)*dy)/len2;
+	if (t < 0)
+		t = 0;
+	if (t > 1)
+		t = 1;
+	return hypot(x-ax-t*dx, y-ay-t*dy);
+}
+
+
+/*
+ * Liang-Barsky clipping of the segment against one side of the box.
+ */
+
+static int clip(double p, double q, double *t0, double *t1)
+{
+	double t;
+
+	if (!p)
+		return q >= 0;
+	t = q/p;
+	if (p < 0) {
+		if (t > *t1)
+			return 0;
+		if (t > *t0)
+			*t0 = t;
+	} else {
+		if (t < *t0)
+			return 0;
+		if (t < *t1)
+			*t1 = t;
+	}
+	return 1;
+}
+
+
+static double seg_box(double ax, double ay, double bx, double by,
+    const struct item *it)
+{
+	double t0 = 0, t1 = 1;
+	double d, tmp;
+
+	if (clip(ax-bx, ax-it->ax, &t0, &t1) &&
+	    clip(bx-ax, it->bx-ax, &t0, &t1) &&
+	    clip(ay-by, ay-it->ay, &t0, &t1) &&
+	    clip(by-ay, it->by-ay, &t0, &t1))
+		return 0;
+	d = point_box(ax, ay, it);
+	tmp = point_box(bx, by, it);
+	if (tmp < d)
+		d = tmp;
+	tmp = point_seg(it->ax, it->ay, ax, ay, bx, by);
+	if (tmp < d)
+		d = tmp;
+	tmp = point_seg(it->bx, it->ay, ax, ay, bx, by);
+	if (tmp < d)
+		d = tmp;
+	tmp = point_seg(it->ax, it->by, ax, ay, bx, by);
+	if (tmp < d)
+		d = tmp;
+	tmp = point_seg(it->bx, it->by, ax, ay, bx, by);
+	if (tmp < d)
+		d = tmp;
+	return d;
+}
+
+
+static double far_corner(double x, double y, const struct item *it)
+{
+	double dx, dy;
+
+	dx = fabs(x-it->ax) > fabs(x-it->bx) ? x-it->ax : x-it->bx;
+	dy = fabs(y-it->ay) > fabs(y-it->by) ? y-it->ay : y-it->by;
+	return hypot(dx, dy);
+}
+
+
+/*
+ * A circle misses the box if the box is either all inside or all outside.
+ */
+
+static double circle_box(double x, double y, double r, const struct item *it)
+{
+	double d;
+
+	d = point_box(x, y, it);
+	if (d > r)
+		return d-r;
+	d = far_corner(x, y, it);
+	if (d < r)
+		return r-d;
+	return 0;
+}
+
+
+static double arc_box(double x, double y, double r, double a1, double a2,
+    const struct item *it)
+{
+	double a, step, d, tmp;
+	double ax, ay, bx, by;
+	int n, i;
+
+	a = a2-a1;
+	while (a <= 0)
+		a += 360;
+	while (a > 360)
+		a -= 360;
+	a *= M_PI/180;
+	a1 *= M_PI/180;
+
+	if (r <= ARC_ERROR)
+		n = 1;
+	else
+		n = ceil(a/(2*acos(1-ARC_ERROR/r)));
+	step = a/n;
+
+	ax = x+r*cos(a1);
+	ay = y+r*sin(a1);
+	d = HUGE_VAL;
+	for (i = 1; i <= n; i++) {
+		bx = x+r*cos(a1+step*i);
+		by = y+r*sin(a1+step*i);
+		tmp = seg_box(ax, ay, bx, by, it);
+		if (tmp < d)
+			d = tmp;
+		ax = bx;
+		ay = by;
+	}
+	return d;
+}
+
+
+static double silk_dist(const struct inst_cols *c, enum inst_prio prio, int i,
+    const struct item *it)
+{
+	double d, tmp;
+
+	switch (prio) {
+	case ip_line:
+		d = seg_box(c->ax[i], c->ay[i], c->bx[i], c->by[i], it);
+		break;
+	case ip_rect:
+		d = seg_box(c->ax[i], c->ay[i], c->bx[i], c->ay[i], it);
+		tmp = seg_box(c->bx[i], c->ay[i], c->bx[i], c->by[i], it);
+		if (tmp < d)
+			d = tmp;
+		tmp = seg_box(c->bx[i], c->by[i], c->ax[i], c->by[i], it);
+		if (tmp < d)
+			d = tmp;
+		tmp = seg_box(c->ax[i], c->by[i], c->ax[i], c->ay[i], it);
+		if (tmp < d)
+			d = tmp;
+		break;
+	case ip_circ:
+		d = circle_box(c->ax[i], c->ay[i], c->r[i], it);
+		break;
+	case ip_arc:
+		d = arc_box(c->ax[i], c->ay[i], c->r[i], c->a1[i], c->a2[i],
+		    it);
+		break;
+	default:
+		abort();
+	}
+	return d-c->width[i]/2.0-it->r;
+}
+
+
+/* ----- shapes of pads and holes ------------------------------------------ */
+
+
+static void set_item(struct item *it, struct inst *inst,
+    unit_type ax, unit_type ay, unit_type bx, unit_type by, int rounded)
+{
+	it->inst = inst;
+	it->ax = ax;
+	it->ay = ay;
+	it->bx = bx;
+	it->by = by;
+	it->r = 0;
+	if (!rounded)
+		return;
+	if (bx-ax > by-ay)
+		it->r = (by-ay)/2.0;
+	else
+		it->r = (bx-ax)/2.0;
+	it->ax += it->r;
+	it->ay += it->r;
+	it->bx -= it->r;
+	it->by -= it->r;
+}
+
+
+static int add_items(struct item *items, int n, const struct pkg *pkg)
+{
+	const struct inst_cols *c;
+	struct inst *inst;
+	int i;
+
+	c = pkg->cols+ip_pad_copper;
+	for (i = 0; i != c->n; i++) {
+		inst = c->inst[i];
+		set_item(items+n++, inst, c->ax[i], c->ay[i], c->bx[i],
+		    c->by[i], inst->obj->u.pad.rounded);
+	}
+	c = pkg->cols+ip_hole;
+	for (i = 0; i != c->n; i++) {
+		inst = c->inst[i];
+		if (!inst->u.hole.pad)
+			set_item(items+n++, inst, c->ax[i], c->ay[i],
+			    c->bx[i], c->by[i], 1);
+	}
+	return n;
+}
+
+
+/* ----- spatial index ----------------------------------------------------- */
+
+
+/*
+ * A uniform grid over the outer boxes of the items, with about one cell per
+ * item. Each cell lists the items whose box reaches into it.
+ */
+
+struct grid {
+	double x0, y0;
+	double size;		/* width and height of a cell */
+	int nx, ny;
+	int *start;		/* first entry of each cell, then the end */
+	int *entries;		/* indices of items */
+	int *seen;		/* query that has last seen the item */
+	int query;
+};
+
+
+static int cell(double v, double v0, double size, int n)
+{
+	int i;
+
+	i = floor((v-v0)/size);
+	if (i < 0)
+		return 0;
+	return i < n ? i : n-1;
+}
+
+
+static void cells(const struct grid *g, double ax, double ay,
+    double bx, double by, int *x0, int *y0, int *x1, int *y1)
+{
+	*x0 = cell(ax, g->x0, g->size, g->nx);
+	*y0 = cell(ay, g->y0, g->size, g->ny);
+	*x1 = cell(bx, g->x0, g->size, g->nx);
+	*y1 = cell(by, g->y0, g->size, g->ny);
+}
+
+
+static void grid_add(struct grid *g, const struct item *it, int i, int fill)
+{
+	int x0, y0, x1, y1, x, y;
+
+	cells(g, it->ax-it->r, it->ay-it->r, it->bx+it->r, it->by+it->r,
+	    &x0, &y0, &x1, &y1);
+	for (y = y0; y <= y1; y++)
+		for (x = x0; x <= x1; x++)
+			if (fill)
+				g->entries[--g->start[y*g->nx+x]] = i;
+			else
+				g->start[y*g->nx+x]++;
+}
+
+
+static void grid_build(struct grid *g, const struct item *items, int n)
+{
+	double ax, ay, bx, by, w, h;
+	int i, cells;
+
+	ax = ay = HUGE_VAL;
+	bx = by = -HUGE_VAL;
+	for (i = 0; i != n; i++) {
+		if (items[i].ax-items[i].r < ax)
+			ax = items[i].ax-items[i].r;
+		if (items[i].ay-items[i].r < ay)
+			ay = items[i].ay-items[i].r;
+		if (items[i].bx+items[i].r > bx)
+			bx = items[i].bx+items[i].r;
+		if (items[i].by+items[i].r > by)
+			by = items[i].by+items[i].r;
+	}
+	w = bx-ax;
+	h = by-ay;
+	g->x0 = ax;
+	g->y0 = ay;
+	g->size = sqrt(w*h/n);
+	if (g->size < w/GRID_MAX)
+		g->size = w/GRID_MAX;
+	if (g->size < h/GRID_MAX)
+		g->size = h/GRID_MAX;
+	if (g->size < 1)
+		g->size = 1;
+	g->nx = w/g->size+1;
+	g->ny = h/g->size+1;
+	if (g->nx > GRID_MAX)
+		g->nx = GRID_MAX;
+	if (g->ny > GRID_MAX)
+		g->ny = GRID_MAX;
+
+	cells = g->nx*g->ny;
+	g->start = zalloc_size(sizeof(int)*(cells+1));
+	for (i = 0; i != n; i++)
+		grid_add(g, items+i, i, 0);
+	for (i = 1; i <= cells; i++)
+		g->start[i] += g->start[i-1];
+	g->entries = alloc_size(sizeof(int)*g->start[cells]);
+	for (i = n-1; i >= 0; i--)
+		grid_add(g, items+i, i, 1);
+	g->seen = alloc_size(sizeof(int)*n);
+	for (i = 0; i != n; i++)
+		g->seen[i] = -1;
+	g->query = 0;
+}
+
+
+/*
+ * grid_find stores the indices of all items whose cells meet the box in
+ * "found", each only once, and returns their number.
+ */
+
+static int grid_find(struct grid *g, double ax, double ay, double bx, double by,
+    int *found)
+{
+	int x0, y0, x1, y1, x, y, i, j;
+	int n = 0;
+
+	cells(g, ax, ay, bx, by, &x0, &y0, &x1, &y1);
+	for (y = y0; y <= y1; y++)
+		for (x = x0; x <= x1; x++)
+			for (i = g->start[y*g->nx+x];
+			    i != g->start[y*g->nx+x+1]; i++) {
+				j = g->entries[i];
+				if (g->seen[j] == g->query)
+					continue;
+				g->seen[j] = g->query;
+				found[n++] = j;
+			}
+	g->query++;
+	return n;
+}
+
+
+static void grid_free(struct grid *g)
+{
+	free(g->start);
+	free(g->entries);
+	free(g->seen);
+}
+
+
+/* ----- rules ------------------------------------------------------------- */
+
+
+static void violation(struct pkg *pkg, enum drc_rule rule,
+    struct inst *a, struct inst *b, double dist)
+{
+	struct drc_violation *v;
+
+	pkg->drc = realloc(pkg->drc,
+	    sizeof(struct drc_violation)*(pkg->n_drc+1));
+	if (!pkg->drc)
+		abort();
+	v = pkg->drc+pkg->n_drc++;
+	v->rule = rule;
+	v->a = a;
+	v->b = b;
+	v->dist = dist > 0 ? dist+0.5 : 0;
+}
+
+
+static unit_type rule_units(enum drc_rule rule)
+{
+	struct num num = drc_rules[rule];
+
+	if (is_undef(num))
+		return 0;
+	return num.type == nt_mil ? mil_to_units(num.n) : mm_to_units(num.n);
+}
+
+
+static void check_clearance(struct pkg *pkg, struct grid *g,
+    const struct item *items, int n, int *found, unit_type min)
+{
+	const struct item *a, *b;
+	double d;
+	int i, j, k, n_found;
+
+	for (i = 0; i != n; i++) {
+		a = items+i;
+		n_found = grid_find(g, a->ax-a->r-min, a->ay-a->r-min,
+		    a->bx+a->r+min, a->by+a->r+min, found);
+		for (k = 0; k != n_found; k++) {
+			j = found[k];
+			b = items+j;
+			if (j <= i)
+				continue;
+			if (a->inst->obj->type == ot_hole &&
+			    b->inst->obj->type == ot_hole)
+				continue;
+			d = box_box(a, b)-a->r-b->r;
+			if (d >= 0.5 && d < min)
+				violation(pkg, dr_clearance, a->inst, b->inst,
+				    d);
+		}
+	}
+}
+
+
+static void check_silk(struct pkg *pkg, const struct pkg *from,
+    struct grid *g, const struct item *items, int *found, unit_type min)
+{
+	static const enum inst_prio prios[] = {
+		ip_circ, ip_arc, ip_rect, ip_line
+	};
+	const struct inst_cols *c;
+	const struct inst *inst;
+	double d;
+	int i, j, k, p, n_found;
+
+	for (p = 0; p != sizeof(prios)/sizeof(*prios); p++) {
+		c = from->cols+prios[p];
+		for (i = 0; i != c->n; i++) {
+			inst = c->inst[i];
+			n_found = grid_find(g,
+			    inst->bbox.min.x-min, inst->bbox.min.y-min,
+			    inst->bbox.max.x+min, inst->bbox.max.y+min, found);
+			for (k = 0; k != n_found; k++) {
+				j = found[k];
+				d = silk_dist(c, prios[p], i, items+j);
+				if (d < min)
+					violation(pkg, dr_silk, items[j].inst,
+					    c->inst[i], d);
+			}
+		}
+	}
+}
+
+
+/*
+ * The narrowest copper around a hole in a rectangular pad is along the axes.
+ * In a rounded pad, it is where the hole's core is farthest from the pad's,
+ * which is at one of the corners of the hole's core.
+ */
+
+static void check_ring(struct pkg *pkg, const struct pkg *from, unit_type min)
+{
+	const struct inst_cols *c = from->cols+ip_pad_copper;
+	struct inst *pad, *hole;
+	struct item p, h;
+	struct coord ha, hb;
+	double d, tmp;
+	int i;
+
+	for (i = 0; i != c->n; i++) {
+		pad = c->inst[i];
+		hole = pad->u.pad.hole;
+		if (!hole)
+			continue;
+		ha = hole->base;
+		hb = hole->u.hole.other;
+		sort_coord(&ha, &hb);
+		set_item(&h, hole, ha.x, ha.y, hb.x, hb.y, 1);
+		if (pad->obj->u.pad.rounded) {
+			set_item(&p, pad, c->ax[i], c->ay[i], c->bx[i],
+			    c->by[i], 1);
+			d = point_box(h.ax, h.ay, &p);
+			tmp = point_box(h.bx, h.ay, &p);
+			if (tmp > d)
+				d = tmp;
+			tmp = point_box(h.ax, h.by, &p);
+			if (tmp > d)
+				d = tmp;
+			tmp = point_box(h.bx, h.by, &p);
+			if (tmp > d)
+				d = tmp;
+			d = p.r-h.r-d;
+		} else {
+			d = ha.x-c->ax[i];
+			if (c->bx[i]-hb.x < d)
+				d = c->bx[i]-hb.x;
+			if (ha.y-c->ay[i] < d)
+				d = ha.y-c->ay[i];
+			if (c->by[i]-hb.y < d)
+				d = c->by[i]-hb.y;
+		}
+		if (d < min)
+			violation(pkg, dr_ring, pad, hole, d);
+	}
+}
+
+
+/* ----- check a package --------------------------------------------------- */
+
+
+/*
+ * Items of the global package appear in all packages, so we check them along
+ * with each package's own.
+ */
+
+static void check_pkg(struct pkg *pkg)
+{
+	struct item *items;
+	struct grid grid;
+	int *found;
+	unit_type min;
+	int n;
+
+	n = pkgs->cols[ip_pad_copper].n+pkgs->cols[ip_hole].n+
+	    pkg->cols[ip_pad_copper].n+pkg->cols[ip_hole].n;
+	items = alloc_size(sizeof(struct item)*(n ? n : 1));
+	n = add_items(items, 0, pkgs);
+	n = add_items(items, n, pkg);
+	if (n) {
+		grid_build(&grid, items, n);
+		found = alloc_size(sizeof(int)*n);
+		min = rule_units(dr_clearance);
+		if (min)
+			check_clearance(pkg, &grid, items, n, found, min);
+		min = rule_units(dr_silk);
+		if (min) {
+			check_silk(pkg, pkgs, &grid, items, found, min);
+			check_silk(pkg, pkg, &grid, items, found, min);
+		}
+		free(found);
+		grid_free(&grid);
+	}
+	free(items);
+	min = rule_units(dr_ring);
+	if (min) {
+		check_ring(pkg, pkgs, min);
+		check_ring(pkg, pkg, min);
+	}
+}
+
+
+void drc_reset(void)
+{
+	enum drc_rule rule;
+
+	for (rule = 0; rule != dr_n; rule++)
+		drc_rules[rule] = undef;
+}
+
+
+void drc_check(void)
+{
+	struct pkg *pkg;
+	enum drc_rule rule;
+
+	for (rule = 0; rule != dr_n; rule++)
+		if (!is_undef(drc_rules[rule]))
+			break;
+	if (rule == dr_n)
+		return;
+	for (pkg = pkgs->next; pkg; pkg = pkg->next)
+		check_pkg(pkg);
+}
+
+
+/* ----- report ------------------------------------------------------------ */
+
+
+static void print_inst(FILE *file, const struct inst *inst)
+{
+	switch (inst->prio) {
+	case ip_pad_copper:
+	case ip_pad_special:
+		fprintf(file, "pad \"%s\"", inst->u.pad.name);
+		break;
+	case ip_hole:
+		fprintf(file, "hole");
+		break;
+	case ip_circ:
+		fprintf(file, "circle");
+		break;
+	case ip_arc:
+		fprintf(file, "arc");
+		break;
+	case ip_rect:
+		fprintf(file, "rectangle");
+		break;
+	case ip_line:
+		fprintf(file, "line");
+		break;
+	default:
+		abort();
+	}
+	fprintf(file, " (line %d)", inst->obj->lineno);
+}
+
+
+static void print_dist(FILE *file, unit_type dist, enum drc_rule rule)
+{
+	if (drc_rules[rule].type == nt_mil)
+		fprintf(file, "%.2fmil", units_to_mil(dist));
+	else
+		fprintf(file, "%.3fmm", units_to_mm(dist));
+}
+
+
+int drc_report(FILE *file)
+{
+	const struct pkg *pkg;
+	const struct drc_violation *v;
+	int n = 0;
+
+	for (pkg = pkgs->next; pkg; pkg = pkg->next)
+		for (v = pkg->drc; v != pkg->drc+pkg->n_drc; v++) {
+			fprintf(file, "package \"%s\": %s ", pkg->name,
+			    drc_rule_names[v->rule]);
+			print_dist(file, v->dist, v->rule);
+			fprintf(file, " < ");
+			print_dist(file, rule_units(v->rule), v->rule);
+			fprintf(file, ", ");
+			print_inst(file, v->a);
+			fprintf(file, " and ");
+			print_inst(file, v->b);
+			fprintf(file, "\n");
+			n++;
+		}
+	return n;
+}
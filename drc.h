@@ -0,0 +1,62 @@
+/*
+ * drc.h - Design rule check
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef DRC_H
+#define DRC_H
+
+#include <stdio.h>
+
+#include "coord.h"
+#include "expr.h"
+
+
+struct inst;
+
+enum drc_rule {
+	dr_clearance,	/* between pads, and between pads and loose holes */
+	dr_silk,	/* between silk screen and pads or loose holes */
+	dr_ring,	/* copper around the hole of a pad */
+	dr_n		/* number of rules */
+};
+
+/*
+ * The minimum distances set with the "drc" directive. A rule whose distance is
+ * undefined isn't checked.
+ */
+
+extern struct num drc_rules[dr_n];
+extern const char *drc_rule_names[dr_n];
+
+/*
+ * For dr_ring, "a" is the pad and "b" its hole. For dr_silk, "a" is the pad or
+ * hole and "b" the silk screen item.
+ */
+
+struct drc_violation {
+	enum drc_rule rule;
+	struct inst *a, *b;
+	unit_type dist;
+};
+
+
+/*
+ * drc_reset removes all rules, before a file is loaded. drc_check records the
+ * violations of each package in its "drc" array. drc_report prints them and
+ * returns their number.
+ */
+
+void drc_reset(void);
+void drc_check(void);
+int drc_report(FILE *file);
+
+#endif /* !DRC_H */
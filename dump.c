@@ -18,9 +18,11 @@
 #include <sys/types.h>
 
 #include "util.h"
+#include "hash.h"
 #include "unparse.h"
 #include "obj.h"
-#include "gui_status.h"
+#include "meas.h"
+#include "drc.h"
 #include "dump.h"
 
 
@@ -35,16 +37,139 @@ static void add_item(struct order **curr, struct vec *vec, struct obj *obj)
 }
 
 
+/*
+ * Per-vector side table, built once per frame, so that ordering doesn't have
+ * to search the frame's vectors and objects for each vector.
+ */
+
+struct vec_info {
+	const struct vec *vec;
+	int n_refs;		/* number of vectors based on this one */
+	struct vec *ref;	/* the last of them */
+	struct obj **objs;	/* non-measurement objects using this vector */
+	int n_objs;
+	int dumped;
+};
+
+
+static struct hash *vec_infos;
+static struct hash *objs_dumped;	/* objects already put in the order */
+
+
+/*
+ * Sets of items, for the objects and frames we've already dumped. The items
+ * are their own keys.
+ */
+
+static unsigned hash_item(const void *item)
+{
+	return hash_bytes(HASH_INIT, &item, sizeof(item));
+}
+
+
+static int eq_item(const void *a, const void *b)
+{
+	return a == b;
+}
+
+
+static int test_and_set(struct hash *set, void *item)
+{
+	if (hash_lookup(set, item))
+		return 1;
+	hash_add(set, item);
+	return 0;
+}
+
+
+static unsigned hash_vec_info(const void *item)
+{
+	const struct vec_info *vi = item;
+
+	return hash_bytes(HASH_INIT, &vi->vec, sizeof(vi->vec));
+}
+
+
+static int eq_vec_info(const void *a, const void *b)
+{
+	const struct vec_info *va = a, *vb = b;
+
+	return va->vec == vb->vec;
+}
+
+
+static void free_vec_info(void *item)
+{
+	struct vec_info *vi = item;
+
+	free(vi->objs);
+	free(vi);
+}
+
+
+static struct vec_info *vec_info(const struct vec *vec)
+{
+	struct vec_info key;
+
+	key.vec = vec;
+	return hash_lookup(vec_infos, &key);
+}
+
+
+static void add_obj_user(struct vec_info *vi, struct obj *obj)
+{
+	if (vi->n_objs && vi->objs[vi->n_objs-1] == obj)
+		return;
+	vi->objs = realloc(vi->objs, sizeof(struct obj *)*(vi->n_objs+1));
+	if (!vi->objs)
+		abort();
+	vi->objs[vi->n_objs++] = obj;
+}
+
+
+static void index_frame(const struct frame *frame)
+{
+	struct vec_info *vi;
+	struct vec *vec;
+	struct obj *obj;
+	struct vec **anchors[3];
+	int n, i;
+
+	vec_infos = hash_new(hash_vec_info, eq_vec_info);
+	for (vec = frame->vecs; vec; vec = vec->next) {
+		vi = zalloc_type(struct vec_info);
+		vi->vec = vec;
+		hash_add(vec_infos, vi);
+	}
+	for (vec = frame->vecs; vec; vec = vec->next) {
+		if (!vec->base)
+			continue;
+		vi = vec_info(vec->base);
+		if (vi) {
+			vi->n_refs++;
+			vi->ref = vec;
+		}
+	}
+	for (obj = frame->objs; obj; obj = obj->next) {
+		if (obj->type == ot_meas)
+			continue;
+		n = obj_anchors(obj, anchors);
+		for (i = 0; i != n; i++) {
+			if (!*anchors[i])
+				continue;
+			vi = vec_info(*anchors[i]);
+			if (vi)
+				add_obj_user(vi, obj);
+		}
+	}
+}
+
+
 static int n_vec_refs(const struct vec *vec)
 {
-	const struct vec *walk;
-	int n;
+	const struct vec_info *vi = vec_info(vec);
 
-	n = 0;
-	for (walk = vec->frame->vecs; walk; walk = walk->next)
-		if (walk->base == vec)
-			n++;
-	return n;
+	return vi ? vi->n_refs : 0;
 }
 
 
@@ -78,7 +203,12 @@ static int need(const struct vec *base, const struct vec *prev)
 
 static int later(const struct vec *base, const struct vec *prev)
 {
-	return base && !base->dumped;
+	const struct vec_info *vi;
+
+	if (!base)
+		return 0;
+	vi = vec_info(base);
+	return vi && !vi->dumped;
 #if 0
 	while (1) {
 		prev = prev->next;
@@ -137,9 +267,8 @@ static int may_put_obj_now(const struct obj *obj, const struct vec *prev)
 static void put_obj(struct order **curr, struct obj *obj,
     struct vec *prev)
 {
-	if (obj->dumped)
+	if (test_and_set(objs_dumped, obj))
 		return;
-	obj->dumped = 1;
 	add_item(curr, prev, obj);
 }
 
@@ -151,18 +280,16 @@ static void put_obj(struct order **curr, struct obj *obj,
 
 static void recurse_vec(struct order **curr, struct vec *vec)
 {
-	struct vec *next;
-	struct obj *obj;
+	struct vec_info *vi = vec_info(vec);
+	int i;
 
-	vec->dumped = 1;
+	vi->dumped = 1;
 	add_item(curr, vec, NULL);
-	for (obj = vec->frame->objs; obj; obj = obj->next)
-		if (may_put_obj_now(obj, vec))
-			put_obj(curr, obj, vec);
-	if (n_vec_refs(vec) == 1) {
-		for (next = vec->next; next->base != vec; next = next->next);
-		recurse_vec(curr, next);
-	}
+	for (i = 0; i != vi->n_objs; i++)
+		if (may_put_obj_now(vi->objs[i], vec))
+			put_obj(curr, vi->objs[i], vec);
+	if (vi->n_refs == 1)
+		recurse_vec(curr, vi->ref);
 }
 
 
@@ -189,20 +316,19 @@ struct order *order_frame(const struct frame *frame)
 		if (obj->type != ot_meas)
 			n++;
 
-	for (vec = frame->vecs; vec; vec = vec->next)
-		vec->dumped = 0;
-	for (obj = frame->objs; obj; obj = obj->next)
-		obj->dumped = 0;
-
 	order = alloc_size(sizeof(*order)*(n+1));
 	curr = order;
 
+	index_frame(frame);
+	objs_dumped = hash_new(hash_item, eq_item);
 	order_vecs(&curr, frame->vecs);
+	hash_free(vec_infos, free_vec_info);
 
 	/* frames based on @ (anything else ?) */
 	for (obj = frame->objs; obj; obj = obj->next)
 		if (obj->type != ot_meas)
 			put_obj(&curr, obj, NULL);
+	hash_free(objs_dumped, NULL);
 
 	assert(curr == order+n);
 	add_item(&curr, NULL, NULL);
@@ -217,12 +343,10 @@ struct order *order_frame(const struct frame *frame)
 static void dump_var(FILE *file, const struct table *table,
     const char *indent)
 {
-	char *s;
-
-	s = unparse(table->rows->values->expr);
-	fprintf(file, "%sset %s%s = %s\n\n", indent,
-	    table->vars->key ? "?" : "", table->vars->name, s);
-	free(s);
+	fprintf(file, "%sset %s%s = ", indent,
+	    table->vars->key ? "?" : "", table->vars->name);
+	unparse_file(file, table->rows->values->expr);
+	fprintf(file, "\n\n");
 }
 
 
@@ -232,7 +356,6 @@ static void dump_table(FILE *file, const struct table *table,
 	const struct var *var;
 	const struct row *row;
 	const struct value *value;
-	char *s;
 
 	if (table->vars && !table->vars->next &&
 	    table->rows && !table->rows->next) {
@@ -247,10 +370,8 @@ static void dump_table(FILE *file, const struct table *table,
 	for (row = table->rows; row; row = row->next) {
 		fprintf(file, "%s    {", indent);
 		for (value = row->values; value; value = value->next) {
-			s = unparse(value->expr);
-			fprintf(file, "%s %s",
-			    value == row->values? "" : ",", s);
-			free(s);
+			fprintf(file, "%s ", value == row->values? "" : ",");
+			unparse_file(file, value->expr);
 		}
 		fprintf(file, " }\n");
 	}
@@ -260,14 +381,11 @@ static void dump_table(FILE *file, const struct table *table,
 
 static void dump_loop(FILE *file, const struct loop *loop, const char *indent)
 {
-	char *from, *to;
-
-	from = unparse(loop->from.expr);
-	to = unparse(loop->to.expr);
-	fprintf(file, "%sloop %s = %s, %s\n\n",
-	    indent, loop->var.name, from, to);
-	free(from);
-	free(to);
+	fprintf(file, "%sloop %s = ", indent, loop->var.name);
+	unparse_file(file, loop->from.expr);
+	fprintf(file, ", ");
+	unparse_file(file, loop->to.expr);
+	fprintf(file, "\n\n");
 }
 
 
@@ -500,6 +618,9 @@ char *print_vec(const struct vec *vec)
 /* ----- frames ------------------------------------------------------------ */
 
 
+static struct hash *frames_dumped;
+
+
 static void dump_frame(FILE *file, struct frame *frame, const char *indent)
 {
 	const struct table *table;
@@ -510,9 +631,8 @@ static void dump_frame(FILE *file, struct frame *frame, const char *indent)
 	char *s;
 	const char *s1;
 
-	if (frame->dumped)
+	if (test_and_set(frames_dumped, frame))
 		return;
-	frame->dumped = 1;
 
 	for (obj = frame->objs; obj; obj = obj->next)
 		if (obj->type == ot_frame)
@@ -534,17 +654,19 @@ static void dump_frame(FILE *file, struct frame *frame, const char *indent)
 				fprintf(file, "%s: ", item->obj->name);
 			s = print_obj(item->obj, item->vec);
 			fprintf(file, "%s\n", s);
+			free(s);
 		} else {
 			s1 = print_label(item->vec);
 			s = print_vec(item->vec);
 			fprintf(file, "%s%s: %s\n", indent, s1, s);
+			free(s);
 		}
-		free(s);
 	}
 	free(order);
 
+	/* the order has all the objects but the measurements */
 	for (obj = frame->objs; obj; obj = obj->next) {
-		if (obj->dumped)
+		if (obj->type != ot_meas)
 			continue;
 		s = print_meas(obj);
 		fprintf(file, "%s%s\n", indent, s);
@@ -596,6 +718,17 @@ static void dump_allow(FILE *file)
 }
 
 
+static void dump_drc(FILE *file)
+{
+	enum drc_rule rule;
+
+	for (rule = 0; rule != dr_n; rule++)
+		if (!is_undef(drc_rules[rule]))
+			fprintf(file, "drc %s %lg%s\n", drc_rule_names[rule],
+			    drc_rules[rule].n, str_unit(drc_rules[rule]));
+}
+
+
 static void reverse_frames(FILE *file, struct frame *last)
 {
 	if (last) {
@@ -607,20 +740,19 @@ static void reverse_frames(FILE *file, struct frame *last)
 
 int dump(FILE *file, const char *one)
 {
-	struct frame *frame;
-
 	assert(!one);
 
 	fprintf(file, "%s\n", MACHINE_GENERATED);
-	for (frame = frames; frame; frame = frame->next)
-		frame->dumped = 0;
+	frames_dumped = hash_new(hash_item, eq_item);
 
 	reverse_frames(file, frames->next);
 	fprintf(file, "package \"%s\"\n", pkg_name);
 	dump_unit(file);
 	dump_allow(file);
+	dump_drc(file);
 	fprintf(file, "\n");
 	dump_frame(file, frames, "");
+	hash_free(frames_dumped, NULL);
 
 	fflush(file);
 	return !ferror(file);
@@ -70,6 +70,16 @@ void report_to_stderr(const char *s)
 }
 
 
+/*
+ * For speculative evaluation, where errors just mean that we have to take
+ * the regular path.
+ */
+
+void report_nothing(const char *s)
+{
+}
+
+
 void fail(const char *fmt, ...)
 {
 	va_list ap;
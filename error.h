@@ -28,6 +28,7 @@ void yyerror(const char *s);
 
 void report_to_stderr(const char *s);
 void report_parse_error(const char *s);
+void report_nothing(const char *s);
 void fail(const char *fmt, ...)
     __attribute__((format(printf, 1, 2)));
 
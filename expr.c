@@ -12,6 +12,7 @@
 
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <math.h>
 
@@ -99,7 +100,7 @@ int to_unit(struct num *n)
 /* ----- number to string conversion (hackish) ----------------------------- */
 
 
-static char *num_to_string(struct num n)
+char *num_to_string(struct num n)
 {
 	static char buf[100]; /* enough :-) */
 
@@ -176,7 +177,7 @@ struct num eval_var(const struct frame *frame, const char *name)
 }
 
 
-static const char *eval_string_var(const struct frame *frame, const char *name)
+const char *eval_string_var(const struct frame *frame, const char *name)
 {
 	const struct table *table;
 	const struct loop *loop;
@@ -448,6 +449,247 @@ struct num op_div(const struct expr *self, const struct frame *frame)
 }
 
 
+/* ----- evaluation for all iterations of a loop --------------------------- */
+
+
+/*
+ * eval_lanes evaluates an expression for all the values the variable of a
+ * loop takes, performing the same operations eval_num would perform in each
+ * iteration. Sub-expressions that don't depend on the loop variable are
+ * evaluated only once.
+ *
+ * We only handle expressions that are affine in the loop variable. For
+ * anything else, and on any error, we return 0 and the caller has to use
+ * eval_num instead.
+ */
+
+
+static struct var *lane_table_var(const struct frame *frame, const char *name,
+    const struct expr **expr)
+{
+	const struct table *table;
+	const struct value *value;
+	struct var *var;
+
+	for (table = frame->tables; table; table = table->next) {
+		value = table->curr_row ? table->curr_row->values :
+		    table->active_row->values;
+		for (var = table->vars; var; var = var->next) {
+			if (!var->key && var->name == name) {
+				*expr = value->expr;
+				return var;
+			}
+			value = value->next;
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ * Returns 1 if the expression depends on the loop variable, 0 if it doesn't,
+ * and -1 if we can't tell because evaluation would recurse.
+ */
+
+static int lane_depends(const struct expr *expr, const struct frame *frame,
+    const struct lanes *lanes)
+{
+	const struct frame *f;
+	const struct loop *loop;
+	const struct expr *def;
+	struct var *var;
+	int a, b;
+
+	if (expr->op == op_num || expr->op == op_string)
+		return 0;
+	if (expr->op == op_var) {
+		for (f = frame; f; f = f->curr_parent) {
+			var = lane_table_var(f, expr->u.var, &def);
+			if (var) {
+				if (var->visited)
+					return -1;
+				var->visited = 1;
+				a = lane_depends(def, f, lanes);
+				var->visited = 0;
+				return a;
+			}
+			for (loop = f->loops; loop; loop = loop->next)
+				if (loop->var.name == expr->u.var)
+					return loop == lanes->loop;
+			if (f == lanes->frame)
+				break;
+		}
+		return 0;
+	}
+	a = lane_depends(expr->u.op.a, frame, lanes);
+	if (a < 0)
+		return -1;
+	if (expr->op == op_minus || expr->op == op_floor ||
+	    expr->op == op_sin || expr->op == op_cos || expr->op == op_sqrt)
+		return a;
+	b = lane_depends(expr->u.op.b, frame, lanes);
+	if (b < 0)
+		return -1;
+	return a || b;
+}
+
+
+static int lane_var(const struct expr *expr, const struct frame *frame,
+    const struct lanes *lanes, struct num *res, double *out)
+{
+	const struct frame *f;
+	const struct loop *loop;
+	const struct expr *def;
+	struct var *var;
+	int ok;
+
+	for (f = frame; f; f = f->curr_parent) {
+		var = lane_table_var(f, expr->u.var, &def);
+		if (var) {
+			var->visited = 1;
+			ok = eval_lanes(def, f, lanes, res, out);
+			var->visited = 0;
+			return ok;
+		}
+		for (loop = f->loops; loop; loop = loop->next)
+			if (loop->var.name == expr->u.var)
+				break;
+		if (loop)
+			break;
+	}
+	/* lane_depends made sure this is our loop */
+	*res = make_num(0);
+	memcpy(out, lanes->values, lanes->n*sizeof(double));
+	return 1;
+}
+
+
+static void lanes_mil_to_mm(double *v, int n, int exponent)
+{
+	int i;
+
+	for (i = 0; i != n; i++)
+		v[i] = mil_to_mm(v[i], exponent);
+}
+
+
+static int lane_binary(const struct expr *self, const struct frame *frame,
+    const struct lanes *lanes, struct num *res, double *out)
+{
+	int sum = self->op == op_add || self->op == op_sub;
+	struct num a, b;
+	double *tmp;
+	int i, n = lanes->n;
+
+	if (self->op == op_mult &&
+	    lane_depends(self->u.op.a, frame, lanes) &&
+	    lane_depends(self->u.op.b, frame, lanes))
+		return 0;
+	if (self->op == op_div && lane_depends(self->u.op.b, frame, lanes))
+		return 0;
+
+	tmp = alloc_size(n*sizeof(double));
+	if (!eval_lanes(self->u.op.a, frame, lanes, &a, out) ||
+	    !eval_lanes(self->u.op.b, frame, lanes, &b, tmp))
+		goto fail;
+	if (self->op == op_div && !tmp[0])
+		goto fail;
+
+	/* same conversions as compatible_sum and compatible_mult */
+	if (a.type != b.type) {
+		if (a.type == nt_mil) {
+			a.type = nt_mm;
+			lanes_mil_to_mm(out, n, a.exponent);
+		}
+		if (b.type == nt_mil) {
+			b.type = nt_mm;
+			lanes_mil_to_mm(tmp, n, sum ? a.exponent : b.exponent);
+		}
+	}
+	if (sum && a.exponent != b.exponent)
+		goto fail;
+
+	res->type = a.type;
+	if (self->op == op_add) {
+		res->exponent = a.exponent;
+		for (i = 0; i != n; i++)
+			out[i] += tmp[i];
+	} else if (self->op == op_sub) {
+		res->exponent = a.exponent;
+		for (i = 0; i != n; i++)
+			out[i] -= tmp[i];
+	} else if (self->op == op_mult) {
+		res->exponent = a.exponent+b.exponent;
+		for (i = 0; i != n; i++)
+			out[i] *= tmp[i];
+	} else {
+		res->exponent = a.exponent-b.exponent;
+		for (i = 0; i != n; i++)
+			out[i] /= tmp[i];
+	}
+	free(tmp);
+	return 1;
+
+fail:
+	free(tmp);
+	return 0;
+}
+
+
+int eval_lanes(const struct expr *expr, const struct frame *frame,
+    const struct lanes *lanes, struct num *res, double *out)
+{
+	int dep, i;
+
+	dep = lane_depends(expr, frame, lanes);
+	if (dep < 0)
+		return 0;
+	if (!dep) {
+		*res = eval_num(expr, frame);
+		if (is_undef(*res))
+			return 0;
+		for (i = 0; i != lanes->n; i++)
+			out[i] = res->n;
+		return 1;
+	}
+	if (expr->op == op_var)
+		return lane_var(expr, frame, lanes, res, out);
+	if (expr->op == op_minus) {
+		if (!eval_lanes(expr->u.op.a, frame, lanes, res, out))
+			return 0;
+		for (i = 0; i != lanes->n; i++)
+			out[i] = -out[i];
+		return 1;
+	}
+	if (expr->op == op_add || expr->op == op_sub ||
+	    expr->op == op_mult || expr->op == op_div)
+		return lane_binary(expr, frame, lanes, res, out);
+	return 0;
+}
+
+
+/* ----- variables referenced ---------------------------------------------- */
+
+
+int expr_vars(const struct expr *expr,
+    int (*fn)(const char *name, void *user), void *user)
+{
+	int res;
+
+	if (expr->op == op_num || expr->op == op_string)
+		return 0;
+	if (expr->op == op_var)
+		return fn(expr->u.var, user);
+	res = expr_vars(expr->u.op.a, fn, user);
+	if (res)
+		return res;
+	if (expr->op == op_minus || expr->op == op_floor ||
+	    expr->op == op_sin || expr->op == op_cos || expr->op == op_sqrt)
+		return 0;
+	return expr_vars(expr->u.op.b, fn, user);
+}
+
+
 /* ----- expression construction ------------------------------------------- */
 
 
@@ -458,6 +700,7 @@ struct expr *new_op(op_type op)
 	expr = alloc_type(struct expr);
 	expr->op = op;
 	expr->lineno = lineno;
+	expr->hoist = NULL;
 	return expr;
 }
 
@@ -492,80 +735,231 @@ struct num eval_num(const struct expr *expr, const struct frame *frame)
 /* ----- string expansion -------------------------------------------------- */
 
 
-char *expand(const char *name, const struct frame *frame)
+/*
+ * Templates are compiled into a sequence of literal text and variable names.
+ * Syntax errors become segments of their own, so that they're reported in the
+ * same order as errors in evaluating the variables before them.
+ */
+
+enum seg_type {
+	st_text,
+	st_var,
+	st_error,
+};
+
+struct segment {
+	enum seg_type type;
+	const char *s;		/* text, unique variable name, or message */
+	int len;		/* st_text only */
+};
+
+struct template {
+	struct segment *segs;
+	int n;
+};
+
+
+static void add_segment(struct template *t, enum seg_type type,
+    const char *s, int len)
+{
+	struct segment *seg;
+
+	if (type == st_text && !len)
+		return;
+	t->segs = realloc(t->segs, sizeof(struct segment)*(t->n+1));
+	if (!t->segs)
+		abort();
+	seg = t->segs+t->n++;
+	seg->type = type;
+	seg->s = type == st_text ? strnalloc(s, len) : s;
+	seg->len = len;
+}
+
+
+static void add_var(struct template *t, const char *s, int len)
 {
-	int len = strlen(name);
-	char *buf = alloc_size(len+1);
-	const char *s, *s0;
 	char *var;
-	const char *var_unique, *value_string;
-	struct num value;
-	int i, value_len;
 
-	i = 0;
+	var = strnalloc(s, len);
+	add_segment(t, st_var, unique(var), 0);
+	free(var);
+}
+
+
+struct template *compile_template(const char *name)
+{
+	struct template *t;
+	const char *s, *s0, *text;
+
+	t = zalloc_type(struct template);
+	text = name;
 	for (s = name; *s; s++) {
-		if (*s != '$') {
-			buf[i++] = *s;
+		if (*s != '$')
 			continue;
-		}
+		add_segment(t, st_text, text, s-text);
 		s0 = ++s;
 		if (*s != '{') {
 			while (is_id_char(*s, s == s0))
 				s++;
 			if (s == s0) {
-				if (*s) {
-					goto invalid;
-				} else {
-					fail("incomplete variable name");
-					goto fail;
-				}
+				add_segment(t, st_error, *s ?
+				    "invalid character in variable name" :
+				    "incomplete variable name", 0);
+				return t;
 			}
-			var = strnalloc(s0, s-s0);
-			len -= s-s0+1;
+			add_var(t, s0, s-s0);
 			s--;
 		} else {
 			s++;
 			while (*s != '}') {
 				if (!*s) {
-					fail("unfinished \"${...}\"");
-					goto fail;
+					add_segment(t, st_error,
+					    "unfinished \"${...}\"", 0);
+					return t;
+				}
+				if (!is_id_char(*s, s == s0+1)) {
+					add_segment(t, st_error,
+					    "invalid character in variable name",
+					    0);
+					return t;
 				}
-				if (!is_id_char(*s, s == s0+1))
-					goto invalid;
 				s++;
 			}
-			var = strnalloc(s0+1, s-s0-1);
-			len -= s-s0+2;
+			add_var(t, s0+1, s-s0-1);
 		}
-		if (!frame)
-			continue;
-		var_unique = unique(var);
-		free(var);
-		value_string = eval_string_var(frame, var_unique);
-		if (!value_string) {
-			value = eval_var(frame, var_unique);
-			if (is_undef(value)) {
-				fail("undefined variable \"%s\"", var_unique);
-				goto fail;
-			}
-			value_string = num_to_string(value);
+		text = s+1;
+	}
+	add_segment(t, st_text, text, s-text);
+	return t;
+}
+
+
+int template_vars(const struct template *t,
+    int (*fn)(const char *name, void *user), void *user)
+{
+	int i, res;
+
+	for (i = 0; i != t->n; i++)
+		if (t->segs[i].type == st_var) {
+			res = fn(t->segs[i].s, user);
+			if (res)
+				return res;
 		}
-		value_len = strlen(value_string);
-		len += value_len;
-		buf = realloc(buf, len+1);
+	return 0;
+}
+
+
+void free_template(struct template *t)
+{
+	int i;
+
+	for (i = 0; i != t->n; i++)
+		if (t->segs[i].type == st_text)
+			free((void *) t->segs[i].s);
+	free(t->segs);
+	free(t);
+}
+
+
+static char *buf = NULL;
+static int buf_size = 0;
+
+
+static void append(int *pos, const char *s, int len)
+{
+	if (*pos+len >= buf_size) {
+		buf_size = buf_size ? buf_size*2 : 64;
+		if (*pos+len >= buf_size)
+			buf_size = *pos+len+1;
+		buf = realloc(buf, buf_size);
 		if (!buf)
 			abort();
-		strcpy(buf+i, value_string);
-		i += value_len;
 	}
-	buf[i] = 0;
+	memcpy(buf+*pos, s, len);
+	*pos += len;
+}
+
+
+/*
+ * Same as num_to_string, but without going through snprintf for the integers
+ * most names contain. "%lg" prints integers up to six digits exactly.
+ */
+
+static void append_num(int *pos, struct num n)
+{
+	char tmp[12];
+	char *p = tmp+sizeof(tmp);
+	const char *unit;
+	long v;
+
+	if (n.n != floor(n.n) || fabs(n.n) >= 1e6 ||
+	    (!n.n && signbit(n.n))) {
+		unit = num_to_string(n);
+		append(pos, unit, strlen(unit));
+		return;
+	}
+	v = labs((long) n.n);
+	do {
+		*--p = '0'+v % 10;
+		v /= 10;
+	} while (v);
+	if (n.n < 0)
+		*--p = '-';
+	append(pos, p, tmp+sizeof(tmp)-p);
+	unit = str_unit(n);
+	append(pos, unit, strlen(unit));
+}
+
+
+const char *expand_template(const struct template *t,
+    const struct frame *frame)
+{
+	const struct segment *seg;
+	const char *value_string;
+	struct num value;
+	int pos = 0;
+
+	for (seg = t->segs; seg != t->segs+t->n; seg++)
+		switch (seg->type) {
+		case st_text:
+			append(&pos, seg->s, seg->len);
+			break;
+		case st_var:
+			if (!frame)
+				break;
+			value_string = eval_string_var(frame, seg->s);
+			if (value_string) {
+				append(&pos, value_string,
+				    strlen(value_string));
+				break;
+			}
+			value = eval_var(frame, seg->s);
+			if (is_undef(value)) {
+				fail("undefined variable \"%s\"", seg->s);
+				return NULL;
+			}
+			append_num(&pos, value);
+			break;
+		case st_error:
+			fail("%s", seg->s);
+			return NULL;
+		default:
+			abort();
+		}
+	append(&pos, "", 1);
 	return buf;
+}
 
-invalid:
-	fail("invalid character in variable name");
-fail:
-	free(buf);
-	return NULL;
+
+char *expand(const char *name, const struct frame *frame)
+{
+	struct template *t;
+	const char *s;
+
+	t = compile_template(name);
+	s = expand_template(t, frame);
+	free_template(t);
+	return s ? stralloc(s) : NULL;
 }
 
 
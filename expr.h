@@ -21,8 +21,11 @@
 
 
 struct frame;
+struct loop;
 struct expr;
 struct value;
+struct hoisted;
+struct template;
 
 enum num_type {
 	nt_none,
@@ -51,6 +54,9 @@ struct expr {
 		} op;
 	} u;
 	int lineno;
+
+	/* used during generation, NULL if not hoisted */
+	struct hoisted *hoist;
 };
 
 
@@ -123,14 +129,27 @@ struct num op_sub(const struct expr *self, const struct frame *frame);
 struct num op_mult(const struct expr *self, const struct frame *frame);
 struct num op_div(const struct expr *self, const struct frame *frame);
 
+/*
+ * Calls "fn" for each variable referenced in "expr", until it returns a
+ * non-zero value. Returns that value, or zero.
+ */
+int expr_vars(const struct expr *expr,
+    int (*fn)(const char *name, void *user), void *user);
+
 struct expr *new_op(op_type op);
 struct expr *binary_op(op_type op, struct expr *a, struct expr *b);
 
 int var_eq(const struct frame *frame, const char *name,
     const struct expr *expr);
 
+/* the string var_eq compares a number with. Returns a static buffer. */
+char *num_to_string(struct num n);
+
 struct num eval_var(const struct frame *frame, const char *name);
 
+/* returns NULL if the variable isn't a string */
+const char *eval_string_var(const struct frame *frame, const char *name);
+
 /*
  * eval_str returns NULL if the result isn't a string. Evaluation may then
  * be attempted with eval_num, and the result can be converted accordingly.
@@ -139,9 +158,36 @@ const char *eval_str(const struct expr *expr, const struct frame *frame);
 
 struct num eval_num(const struct expr *expr, const struct frame *frame);
 
+/*
+ * Evaluation for all iterations of a loop at once. "frame" is the frame
+ * containing the loop. Expressions of frames it references are evaluated
+ * with their curr_parent pointing to it.
+ */
+
+struct lanes {
+	const struct frame *frame;
+	const struct loop *loop;
+	const double *values;	/* values of the loop variable */
+	int n;			/* number of iterations */
+};
+
+int eval_lanes(const struct expr *expr, const struct frame *frame,
+    const struct lanes *lanes, struct num *res, double *out);
+
 /* if frame == NULL, we only check the syntax without expanding */
 char *expand(const char *name, const struct frame *frame);
 
+/*
+ * expand_template returns a buffer that is overwritten by the next call, or
+ * NULL if expansion failed.
+ */
+struct template *compile_template(const char *name);
+const char *expand_template(const struct template *t,
+    const struct frame *frame);
+int template_vars(const struct template *t,
+    int (*fn)(const char *name, void *user), void *user);
+void free_template(struct template *t);
+
 struct expr *new_num(struct num num);
 struct expr *parse_expr(const char *s);
 void free_expr(struct expr *expr);
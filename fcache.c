@@ -0,0 +1,474 @@
+/*
+ * fcache.c - Cache for frame instantiation
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * A frame that is referenced several times, with the same values for all the
+ * variables it reads from outside, produces the same instances each time,
+ * only moved to a different base. The first time we see such a combination,
+ * we just instantiate the frame. The second time, we also capture the
+ * instances and the measurement samples. After that, we replay the capture.
+ *
+ * We only cache frames that are inactive, and only if their instances
+ * depend on nothing but their base and these variables. This excludes
+ * frames using vectors of their parents by name, and frames with debug
+ * output. The cache only lives for one call to "instantiate".
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "util.h"
+#include "error.h"
+#include "coord.h"
+#include "expr.h"
+#include "bitset.h"
+#include "meas.h"
+#include "inst.h"
+#include "hash.h"
+#include "obj.h"
+#include "fcache.h"
+
+
+struct frame_info {
+	int analyzed;
+	int cacheable;
+	const char **free;	/* variables read from outside the frame */
+	int n_free;
+};
+
+struct binding {
+	const char *s;		/* string value, NULL if numeric */
+	struct num num;
+};
+
+struct post {
+	const struct vec *vec;
+	struct coord pos;	/* relative to the base */
+	struct bitset frame_set; /* only frames inside the capture */
+};
+
+struct entry {
+	const struct frame *frame;
+	struct binding *bindings;
+	struct inst_capture *cap; /* NULL if not captured (yet) */
+	struct post *posts;
+	int n_posts;
+};
+
+struct recording {
+	struct entry *entry;
+	struct coord base;
+	struct inst_mark mark;
+	struct recording *outer;
+};
+
+
+static struct frame_info *info = NULL; /* indexed by frame->n */
+static int n_frames;
+static struct hash *entries;
+static struct recording *recordings = NULL;
+
+
+/* ----- variables read by a frame ----------------------------------------- */
+
+
+static void add_name(struct frame_info *fi, const char *name)
+{
+	int i;
+
+	for (i = 0; i != fi->n_free; i++)
+		if (fi->free[i] == name)
+			return;
+	fi->free = realloc(fi->free, sizeof(const char *)*(fi->n_free+1));
+	if (!fi->free)
+		abort();
+	fi->free[fi->n_free++] = name;
+}
+
+
+static int expr_name(const char *name, void *user)
+{
+	add_name(user, name);
+	return 0;
+}
+
+
+static void expr_names(struct frame_info *fi, const struct expr *expr)
+{
+	if (expr)
+		expr_vars(expr, expr_name, fi);
+}
+
+
+static int is_bound(const struct frame *frame, const char *name)
+{
+	const struct table *table;
+	const struct loop *loop;
+	const struct var *var;
+
+	for (table = frame->tables; table; table = table->next)
+		for (var = table->vars; var; var = var->next)
+			if (!var->key && var->name == name)
+				return 1;
+	for (loop = frame->loops; loop; loop = loop->next)
+		if (loop->var.name == name)
+			return 1;
+	return 0;
+}
+
+
+static int is_named(const struct vec *vec)
+{
+	return vec && *(const char *) vec;
+}
+
+
+static void analyze(struct frame *frame);
+
+
+static int analyze_obj(struct frame_info *fi, struct obj *obj)
+{
+	const struct frame_info *ref;
+	struct vec **anchors[3];
+	int n, i;
+
+	if (obj->type == ot_iprint || obj->type == ot_meas)
+		return 0;
+	n = obj_anchors(obj, anchors);
+	for (i = 0; i != n; i++)
+		if (is_named(*anchors[i]))
+			return 0;
+	switch (obj->type) {
+	case ot_frame:
+		analyze(obj->u.frame.ref);
+		ref = info+obj->u.frame.ref->n;
+		if (!ref->cacheable)
+			return 0;
+		for (i = 0; i != ref->n_free; i++)
+			add_name(fi, ref->free[i]);
+		break;
+	case ot_line:
+	case ot_rect:
+		expr_names(fi, obj->u.rect.width);
+		break;
+	case ot_arc:
+		expr_names(fi, obj->u.arc.width);
+		break;
+	case ot_pad:
+		template_vars(obj->u.pad.tmpl, expr_name, fi);
+		break;
+	default:
+		break;
+	}
+	return 1;
+}
+
+
+static void analyze(struct frame *frame)
+{
+	struct frame_info *fi = info+frame->n;
+	const struct table *table;
+	const struct row *row;
+	const struct value *value;
+	const struct var *var;
+	const struct loop *loop;
+	const struct vec *vec;
+	struct obj *obj;
+	int i, n;
+
+	if (fi->analyzed)
+		return;
+	fi->analyzed = 1;
+	fi->cacheable = frame != frames;
+
+	for (table = frame->tables; table; table = table->next) {
+		for (var = table->vars; var; var = var->next)
+			if (var->key)
+				add_name(fi, var->name);
+		for (row = table->rows; row; row = row->next)
+			for (value = row->values; value; value = value->next)
+				expr_names(fi, value->expr);
+	}
+	for (loop = frame->loops; loop; loop = loop->next) {
+		expr_names(fi, loop->from.expr);
+		expr_names(fi, loop->to.expr);
+	}
+	for (vec = frame->vecs; vec; vec = vec->next) {
+		if (is_named(vec->base))
+			fi->cacheable = 0;
+		expr_names(fi, vec->x);
+		expr_names(fi, vec->y);
+	}
+	for (obj = frame->objs; obj; obj = obj->next)
+		if (!analyze_obj(fi, obj))
+			fi->cacheable = 0;
+
+	n = 0;
+	for (i = 0; i != fi->n_free; i++)
+		if (!is_bound(frame, fi->free[i]))
+			fi->free[n++] = fi->free[i];
+	fi->n_free = n;
+}
+
+
+/* ----- cache entries ----------------------------------------------------- */
+
+
+static unsigned hash_entry(const void *item)
+{
+	const struct entry *e = item;
+	const struct binding *b;
+	unsigned h;
+	int i;
+
+	h = hash_bytes(HASH_INIT, &e->frame, sizeof(e->frame));
+	for (i = 0; i != info[e->frame->n].n_free; i++) {
+		b = e->bindings+i;
+		if (b->s) {
+			h = hash_str(h, b->s);
+		} else {
+			h = hash_bytes(h, &b->num.type, sizeof(b->num.type));
+			h = hash_bytes(h, &b->num.exponent,
+			    sizeof(b->num.exponent));
+			h = hash_bytes(h, &b->num.n, sizeof(b->num.n));
+		}
+	}
+	return h;
+}
+
+
+/*
+ * Numbers must be identical, not just equal, since we also expand them into
+ * strings. Thus we distinguish 0 from -0.
+ */
+
+static int eq_entry(const void *a, const void *b)
+{
+	const struct entry *ea = a, *eb = b;
+	const struct binding *ba, *bb;
+	int i;
+
+	if (ea->frame != eb->frame)
+		return 0;
+	for (i = 0; i != info[ea->frame->n].n_free; i++) {
+		ba = ea->bindings+i;
+		bb = eb->bindings+i;
+		if (!ba->s != !bb->s)
+			return 0;
+		if (ba->s) {
+			if (strcmp(ba->s, bb->s))
+				return 0;
+		} else {
+			if (ba->num.type != bb->num.type ||
+			    ba->num.exponent != bb->num.exponent ||
+			    ba->num.n != bb->num.n ||
+			    signbit(ba->num.n) != signbit(bb->num.n))
+				return 0;
+		}
+	}
+	return 1;
+}
+
+
+static void free_entry(void *item)
+{
+	struct entry *e = item;
+	int i;
+
+	if (e->cap)
+		inst_capture_free(e->cap);
+	for (i = 0; i != e->n_posts; i++)
+		bitset_release(&e->posts[i].frame_set);
+	free(e->posts);
+	free(e->bindings);
+	free(e);
+}
+
+
+/*
+ * The frame sees the same values as its parent, since these variables aren't
+ * bound in the frame itself.
+ */
+
+static int bind(const struct frame_info *fi, const struct frame *parent,
+    struct binding *bindings)
+{
+	void (*saved_reporter)(const char *s) = reporter;
+	struct binding *b;
+	int i;
+
+	reporter = report_nothing;
+	for (i = 0; i != fi->n_free; i++) {
+		b = bindings+i;
+		b->s = eval_string_var(parent, fi->free[i]);
+		if (!b->s) {
+			b->num = eval_var(parent, fi->free[i]);
+			if (is_undef(b->num))
+				break;
+		}
+	}
+	reporter = saved_reporter;
+	return i == fi->n_free;
+}
+
+
+/* ----- recording and replaying ------------------------------------------- */
+
+
+static void record_post(struct recording *rec, const struct vec *vec,
+    struct coord pos, const struct bitset *set, const struct frame *from)
+{
+	struct entry *e = rec->entry;
+	struct post *p;
+	const struct frame *f;
+
+	e->posts = realloc(e->posts, sizeof(struct post)*(e->n_posts+1));
+	if (!e->posts)
+		abort();
+	p = e->posts+e->n_posts++;
+	p->vec = vec;
+	p->pos = sub_vec(pos, rec->base);
+	if (set)
+		bitset_init_clone(&p->frame_set, set);
+	else
+		bitset_init(&p->frame_set, n_frames);
+	for (f = from; f != e->frame; f = f->curr_parent)
+		bitset_set(&p->frame_set, f->n);
+	bitset_set(&p->frame_set, e->frame->n);
+}
+
+
+void fcache_post(const struct frame *frame, const struct vec *vec,
+    struct coord pos)
+{
+	struct recording *rec;
+
+	for (rec = recordings; rec; rec = rec->outer)
+		record_post(rec, vec, pos, NULL, frame);
+}
+
+
+static int replay(const struct entry *e, const struct frame *parent,
+    struct obj *frame_ref, struct coord base, const struct bitset *frame_set)
+{
+	const struct post *p;
+	struct recording *rec;
+	struct bitset set;
+	struct coord pos;
+
+	if (!inst_replay(e->cap, base, frame_ref))
+		return 0;
+	bitset_init(&set, n_frames);
+	for (p = e->posts; p != e->posts+e->n_posts; p++) {
+		pos = add_vec(p->pos, base);
+		bitset_copy(&set, &p->frame_set);
+		bitset_or(&set, frame_set);
+		meas_post(p->vec, pos, &set);
+		for (rec = recordings; rec; rec = rec->outer)
+			record_post(rec, p->vec, pos, &p->frame_set, parent);
+	}
+	bitset_release(&set);
+	return 1;
+}
+
+
+int fcache_lookup(struct frame *frame, const struct frame *parent,
+    struct obj *frame_ref, struct coord base,
+    const struct bitset *frame_set)
+{
+	const struct frame_info *fi = info+frame->n;
+	struct entry key, *e;
+	struct recording *rec;
+
+	analyze(frame);
+	if (!fi->cacheable)
+		return 0;
+	key.frame = frame;
+	key.bindings = alloc_size(sizeof(struct binding)*fi->n_free);
+	if (!bind(fi, parent, key.bindings)) {
+		free(key.bindings);
+		return 0;
+	}
+	e = hash_lookup(entries, &key);
+	if (!e) {
+		e = alloc_type(struct entry);
+		*e = key;
+		e->cap = NULL;
+		e->posts = NULL;
+		e->n_posts = 0;
+		hash_add(entries, e);
+		return 0;
+	}
+	free(key.bindings);
+	if (e->cap)
+		return replay(e, parent, frame_ref, base, frame_set);
+
+	rec = alloc_type(struct recording);
+	rec->entry = e;
+	rec->base = base;
+	inst_mark(&rec->mark);
+	rec->outer = recordings;
+	recordings = rec;
+	return 0;
+}
+
+
+void fcache_done(const struct frame *frame, int ok)
+{
+	struct recording *rec = recordings;
+	struct entry *e;
+	int i;
+
+	if (!rec || rec->entry->frame != frame)
+		return;
+	e = rec->entry;
+	if (ok) {
+		e->cap = inst_capture(&rec->mark, rec->base);
+	} else {
+		for (i = 0; i != e->n_posts; i++)
+			bitset_release(&e->posts[i].frame_set);
+		e->n_posts = 0;
+	}
+	recordings = rec->outer;
+	free(rec);
+}
+
+
+/* ----- setup and cleanup ------------------------------------------------- */
+
+
+void fcache_start(int n)
+{
+	n_frames = n;
+	info = zalloc_size(sizeof(struct frame_info)*n);
+	entries = hash_new(hash_entry, eq_entry);
+}
+
+
+void fcache_stop(void)
+{
+	struct recording *next;
+	int i;
+
+	while (recordings) {
+		next = recordings->outer;
+		free(recordings);
+		recordings = next;
+	}
+	hash_free(entries, free_entry);
+	for (i = 0; i != n_frames; i++)
+		free(info[i].free);
+	free(info);
+	info = NULL;
+}
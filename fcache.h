@@ -0,0 +1,39 @@
+/*
+ * fcache.h - Cache for frame instantiation
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef FCACHE_H
+#define FCACHE_H
+
+#include "coord.h"
+#include "bitset.h"
+#include "obj.h"
+
+
+/*
+ * fcache_lookup returns 1 if it has replayed the frame's instances and
+ * measurement samples from the cache. Otherwise, the caller instantiates the
+ * frame and then calls fcache_done. fcache_post must be called for each
+ * sample posted during instantiation.
+ */
+
+int fcache_lookup(struct frame *frame, const struct frame *parent,
+    struct obj *frame_ref, struct coord base,
+    const struct bitset *frame_set);
+void fcache_done(const struct frame *frame, int ok);
+void fcache_post(const struct frame *frame, const struct vec *vec,
+    struct coord pos);
+
+void fcache_start(int n_frames);
+void fcache_stop(void);
+
+#endif /* !FCACHE_H */
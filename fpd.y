@@ -21,10 +21,11 @@
 #include "expr.h"
 #include "obj.h"
 #include "meas.h"
-#include "gui_status.h"
-#include "gui_inst.h" /* for %meas */
+#include "inst.h"
 #include "dump.h"
 #include "tsort.h"
+#include "hash.h"
+#include "drc.h"
 #include "fpd.h"
 
 #include "y.tab.h"
@@ -53,39 +54,192 @@ static const char *id_sin, *id_cos, *id_sqrt, *id_floor;
 static struct tsort *tsort;
 
 
-/* ----- lookup functions -------------------------------------------------- */
+/* ----- symbol tables ---------------------------------------------------- */
 
 
-static struct frame *find_frame(const char *name)
+/*
+ * The lookup functions below used to search the lists of the frame. We now
+ * keep the names already defined in hash tables, keyed on the pointer
+ * returned by "unique". A frame's tables are built from its lists when we
+ * first need them, and then updated whenever the parser names an item.
+ * Debugging directives that delete or rename items just drop all the tables.
+ */
+
+struct sym {
+	const char *name;
+	void *item;
+};
+
+struct symtab {
+	const struct frame *frame;
+	struct hash *vecs;
+	struct hash *objs;
+	struct hash *vars;	/* loop variables and non-key table variables */
+};
+
+
+static struct hash *frame_syms = NULL;
+static struct hash *symtabs = NULL;
+
+
+static unsigned hash_sym(const void *item)
+{
+	const struct sym *sym = item;
+
+	return hash_bytes(HASH_INIT, &sym->name, sizeof(sym->name));
+}
+
+
+static int eq_sym(const void *a, const void *b)
+{
+	const struct sym *sa = a, *sb = b;
+
+	return sa->name == sb->name;
+}
+
+
+static unsigned hash_symtab(const void *item)
+{
+	const struct symtab *st = item;
+
+	return hash_bytes(HASH_INIT, &st->frame, sizeof(st->frame));
+}
+
+
+static int eq_symtab(const void *a, const void *b)
+{
+	const struct symtab *sa = a, *sb = b;
+
+	return sa->frame == sb->frame;
+}
+
+
+static void free_symtab(void *item)
+{
+	struct symtab *st = item;
+
+	hash_free(st->vecs, free);
+	hash_free(st->objs, free);
+	hash_free(st->vars, free);
+	free(st);
+}
+
+
+static void free_symtabs(void)
+{
+	if (frame_syms)
+		hash_free(frame_syms, free);
+	if (symtabs)
+		hash_free(symtabs, free_symtab);
+	frame_syms = NULL;
+	symtabs = NULL;
+}
+
+
+/*
+ * Like the list searches, we return the first item with a given name.
+ */
+
+static void add_sym(struct hash *hash, const char *name, void *item)
+{
+	struct sym key, *sym;
+
+	if (!name)
+		return;
+	key.name = name;
+	if (hash_lookup(hash, &key))
+		return;
+	sym = alloc_type(struct sym);
+	sym->name = name;
+	sym->item = item;
+	hash_add(hash, sym);
+}
+
+
+static void *lookup_sym(const struct hash *hash, const char *name)
+{
+	const struct sym *sym;
+	struct sym key;
+
+	key.name = name;
+	sym = hash_lookup(hash, &key);
+	return sym ? sym->item : NULL;
+}
+
+
+static struct hash *frame_table(void)
 {
 	struct frame *f;
 
-	for (f = frames->next; f; f = f->next)
-		if (f->name == name)
-			return f;
-	return NULL;
+	if (!frame_syms) {
+		frame_syms = hash_new(hash_sym, eq_sym);
+		for (f = frames->next; f; f = f->next)
+			add_sym(frame_syms, f->name, f);
+	}
+	return frame_syms;
 }
 
 
-static struct vec *find_vec(const struct frame *frame, const char *name)
+static void add_var_syms(struct symtab *st, const struct table *table)
 {
-	struct vec *v;
+	struct var *var;
 
-	for (v = frame->vecs; v; v = v->next)
-		if (v->name == name)
-			return v;
-	return NULL;
+	for (var = table->vars; var; var = var->next)
+		if (!var->key)
+			add_sym(st->vars, var->name, var);
 }
 
 
-static struct obj *find_obj(const struct frame *frame, const char *name)
+static struct symtab *symtab(const struct frame *frame)
 {
+	struct symtab key, *st;
+	const struct table *table;
+	struct loop *loop;
+	struct vec *vec;
 	struct obj *obj;
 
+	if (!symtabs)
+		symtabs = hash_new(hash_symtab, eq_symtab);
+	key.frame = frame;
+	st = hash_lookup(symtabs, &key);
+	if (st)
+		return st;
+	st = alloc_type(struct symtab);
+	st->frame = frame;
+	st->vecs = hash_new(hash_sym, eq_sym);
+	st->objs = hash_new(hash_sym, eq_sym);
+	st->vars = hash_new(hash_sym, eq_sym);
+	for (vec = frame->vecs; vec; vec = vec->next)
+		add_sym(st->vecs, vec->name, vec);
 	for (obj = frame->objs; obj; obj = obj->next)
-		if (obj->name == name)
-			return obj;
-	return NULL;
+		add_sym(st->objs, obj->name, obj);
+	for (table = frame->tables; table; table = table->next)
+		add_var_syms(st, table);
+	for (loop = frame->loops; loop; loop = loop->next)
+		add_sym(st->vars, loop->var.name, &loop->var);
+	hash_add(symtabs, st);
+	return st;
+}
+
+
+/* ----- lookup functions -------------------------------------------------- */
+
+
+static struct frame *find_frame(const char *name)
+{
+	return lookup_sym(frame_table(), name);
+}
+
+
+static struct vec *find_vec(const struct frame *frame, const char *name)
+{
+	return lookup_sym(symtab(frame)->vecs, name);
+}
+
+
+static struct obj *find_obj(const struct frame *frame, const char *name)
+{
+	return lookup_sym(symtab(frame)->objs, name);
 }
 
 
@@ -101,18 +255,7 @@ static int find_label(const struct frame *frame, const char *name)
 
 static struct var *find_var(const struct frame *frame, const char *name)
 {
-	const struct table *table;
-	struct var *var;
-	struct loop *loop;
-
-	for (table = frame->tables; table; table = table->next)
-		for (var = table->vars; var; var = var->next)
-			if (!var->key && var->name == name)
-				return var;
-	for (loop = frame->loops; loop; loop = loop->next)
-		if (loop->var.name == name)
-			return &loop->var;
-	return NULL;
+	return lookup_sym(symtab(frame)->vars, name);
 }
 
 
@@ -148,6 +291,7 @@ static void make_var(const char *id, int key, struct expr *expr)
 	table->active_row = table->rows;
 	*next_table = table;
 	next_table = &table->next;
+	add_var_syms(symtab(curr_frame), table);
 }
 
 
@@ -171,6 +315,7 @@ static void make_loop(const char *id, struct expr *from, struct expr *to)
 	loop->initialized = 0;
 	*next_loop = loop;
 	next_loop = &loop->next;
+	add_sym(symtab(curr_frame)->vars, id, &loop->var);
 }
 
 
@@ -265,11 +410,13 @@ static int dbg_delete(const char *frame_name, const char *name)
 	vec = find_vec(frame, name);
 	if (vec) {
 		delete_vec(vec);
+		free_symtabs();
 		return 1;
 	}
 	obj = find_obj(frame, name);
 	if (obj) {
 		delete_obj(obj);
+		free_symtabs();
 		return 1;
 	}
 	if (!frame_name) {
@@ -280,6 +427,7 @@ static int dbg_delete(const char *frame_name, const char *name)
 				return 0;
 			}
 			delete_frame(frame);
+			free_symtabs();
 			return 1;
 		}
 	}
@@ -439,6 +587,7 @@ static int dbg_meas(const char *name)
 	struct obj *obj;
 	enum pad_type pt;
 	enum meas_type mt;
+	enum drc_rule drc;
 	struct {
 		int inverted;
 		int max;
@@ -463,6 +612,7 @@ static int dbg_meas(const char *name)
 %token		TOK_DBG_PRINT TOK_DBG_IPRINT
 %token		TOK_DBG_DUMP TOK_DBG_EXIT TOK_DBG_TSORT TOK_DBG_MEAS
 %token		TOK_ALLOW_HOLES TOK_ALLOW_OVERLAP TOK_ALLOW_TOUCH
+%token		TOK_DRC_CLEARANCE TOK_DRC_SILK TOK_DRC_RING
 
 %token	<num>	NUMBER
 %token	<str>	STRING
@@ -481,6 +631,7 @@ static int dbg_meas(const char *name)
 %type	<str>	opt_string
 %type	<pt>	pad_type
 %type	<mt>	meas_type
+%type	<drc>	drc_rule
 %type	<mo>	meas_op
 %type	<qvec>	qualified_base
 %type	<qbase>	qbase qbase_unchecked
@@ -492,12 +643,18 @@ all:
 		{
 			frames = zalloc_type(struct frame);
 			set_frame(frames);
+			frame_refs_changed();
+			drc_reset();
 			id_sin = unique("sin");
 			id_cos = unique("cos");
 			id_sqrt = unique("sqrt");
 			id_floor = unique("floor");
+			free_symtabs();
 		}
 	    fpd
+		{
+			free_symtabs();
+		}
 	| START_EXPR expr
 		{
 			expr_result = $2;
@@ -514,8 +671,10 @@ all:
 	;
 
 fpd:
-	frame_defs part_name opt_setup opt_frame_items opt_measurements
-	| frame_defs setup opt_frame_items opt_measurements
+	frame_defs part_name opt_setup opt_rules opt_frame_items
+	    opt_measurements
+	| frame_defs setup opt_rules opt_frame_items opt_measurements
+	| frame_defs rules opt_frame_items opt_measurements
 	| frame_defs frame_items opt_measurements
 	| frame_defs opt_measurements
 	;
@@ -590,6 +749,42 @@ allow_holes:
 		}
 	;
 
+opt_rules:
+	| rules
+	;
+
+rules:
+	rule
+	| rules rule
+	;
+
+rule:
+	drc_rule NUMBER
+		{
+			if (!is_distance($2)) {
+				yyerrorf("design rule \"%s\" needs a distance",
+				    drc_rule_names[$1]);
+				YYABORT;
+			}
+			drc_rules[$1] = $2;
+		}
+	;
+
+drc_rule:
+	TOK_DRC_CLEARANCE
+		{
+			$$ = dr_clearance;
+		}
+	| TOK_DRC_SILK
+		{
+			$$ = dr_silk;
+		}
+	| TOK_DRC_RING
+		{
+			$$ = dr_ring;
+		}
+	;
+
 frame_defs:
 	| frame_defs frame_def
 	;
@@ -606,6 +801,8 @@ frame_def:
 			set_frame(curr_frame);
 			curr_frame->next = frames->next;
 			frames->next = curr_frame;
+			frame_refs_changed();
+			add_sym(frame_table(), $2, curr_frame);
 		}
 	    opt_frame_items '}'
 		{
@@ -648,6 +845,7 @@ frame_item:
 				YYABORT;
 			}
 			$2->name = $1;
+			add_sym(symtab(curr_frame)->vecs, $1, $2);
 		}
 	| object
 	| LABEL object
@@ -657,6 +855,7 @@ frame_item:
 				YYABORT;
 			}
 			$2->name = $1;
+			add_sym(symtab(curr_frame)->objs, $1, $2);
 		}
 	| debug_item
 	;
@@ -698,6 +897,8 @@ debug_item:
 				perror("stdout");
 				exit(1);
 			}
+			/* dump may have named anonymous vectors */
+			free_symtabs();
 		}
 	| TOK_DBG_EXIT
 		{
@@ -753,6 +954,7 @@ table:
 			$$->rows = $6;
 			$$->active_row = $6;
 			next_table = &$$->next;
+			add_var_syms(symtab(curr_frame), $$);
 		}
 	;
 
@@ -929,6 +1131,8 @@ object:
 			$$ = $1;
 			*next_obj = $1;
 			next_obj = &$1->next;
+			if ($1->type == ot_frame)
+				frame_refs_changed();
 		}
 	;
 
@@ -1064,6 +1268,7 @@ meas:
 				YYABORT;
 			}
 			$$->name = $1;
+			add_sym(symtab(curr_frame)->objs, $1, $$);
 		}
 	;
 
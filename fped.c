@@ -25,11 +25,21 @@
 #include "file.h"
 #include "postscript.h"
 #include "dump.h"
-#include "gui.h"
 #include "delete.h"
+#include "journal.h"
+#include "drc.h"
 #include "fpd.h"
 #include "fped.h"
 
+/*
+ * fped-batch is built from this file with BATCH_ONLY defined. It only links
+ * with libfped and thus doesn't need GTK.
+ */
+
+#ifndef BATCH_ONLY
+#include "gui.h"
+#endif
+
 
 char *save_file_name = NULL;
 int no_save = 0;
@@ -64,20 +74,29 @@ static void load_file(const char *name)
 }
 
 
+#ifndef BATCH_ONLY
+
 void reload(void)
 {
 	struct frame *old_frames;
 
 	/* @@@ this needs more work */
+	journal_stop();
 	purge();
 	old_frames = frames;
+	clearerr(stdin);
 	scan_file();
 	load_file(save_file_name);
-	if (!instantiate())
+	if (!instantiate()) {
 		frames = old_frames;
+		frame_refs_changed();
+	}
+	journal_start();
 	change_world();
 }
 
+#endif /* !BATCH_ONLY */
+
 
 static void usage(const char *name)
 {
@@ -90,8 +109,13 @@ static void usage(const char *name)
 "  -p          write Postscript output, then exit\n"
 "  -P [-K] [-s scale] [-1 package]\n"
 "              write Postscript output (full page), then exit\n"
-"  -T          test mode. Load file, then exit\n"
+"  -T [-r]     test mode. Load file, then exit. With -r, report design rule\n"
+"              violations and fail if there are any\n"
 "  -T -T       test mode. Load file, dump to stdout, then exit\n\n"
+#ifndef BATCH_ONLY
+"GUI options:\n"
+"  -C          draw the canvas with Cairo (experimental)\n\n"
+#endif
 "Common options:\n"
 "  -1 name     output only the specified package\n"
 "  -K          show the pad type key\n"
@@ -139,16 +163,20 @@ int main(int argc, char **argv)
 		batch_test
 	} batch = batch_none;
 	char *name = *argv;
+#ifndef BATCH_ONLY
 	char **fake_argv;
 	char *args[2];
 	int fake_argc;
-	char opt[] = "-?";
 	int error;
+#endif
+	char opt[] = "-?";
 	int test_mode = 0;
+	int check_rules = 0;
+	int failed = 0;
 	const char *one = NULL;
 	int c;
 
-	while ((c = getopt(argc, argv, "1:gkps:D:I:KPTU:")) != EOF)
+	while ((c = getopt(argc, argv, "1:gkprs:CD:I:KPTU:")) != EOF)
 		switch (c) {
 		case '1':
 			one = optarg;
@@ -176,6 +204,14 @@ int main(int argc, char **argv)
 		case 'K':
 			postscript_params.show_key = 1;
 			break;
+		case 'r':
+			check_rules = 1;
+			break;
+#ifndef BATCH_ONLY
+		case 'C':
+			cairo_canvas = 1;
+			break;
+#endif
 		case 's':
 			if (batch != batch_ps_fullpage)
 				usage(*argv);
@@ -202,6 +238,14 @@ int main(int argc, char **argv)
 		usage(name);
 	if (postscript_params.show_key && batch != batch_ps_fullpage)
 		usage(name);
+	if (check_rules && batch != batch_test)
+		usage(name);
+#ifdef BATCH_ONLY
+	if (!batch)
+		usage(name);
+#else
+	if (cairo_canvas && batch)
+		usage(name);
 
 	if (!batch) {
 		args[0] = name;
@@ -212,6 +256,7 @@ int main(int argc, char **argv)
 		if (error)
 			return error;
 	}
+#endif
 
 	switch (argc-optind) {
 	case 0:
@@ -240,11 +285,13 @@ int main(int argc, char **argv)
 		return 1;
 
 	switch (batch) {
+#ifndef BATCH_ONLY
 	case batch_none:
 		error = gui_main();
 		if (error)
 			return error;
 		break;
+#endif
 	case batch_kicad:
 		write_kicad();
 		break;
@@ -258,6 +305,8 @@ int main(int argc, char **argv)
 		write_gnuplot(one);
 		break;
 	case batch_test:
+		if (check_rules && drc_report(stdout))
+			failed = 1;
 		if (test_mode > 1)
 			dump(stdout, NULL);
 		break;
@@ -270,5 +319,5 @@ int main(int argc, char **argv)
 	obj_cleanup();
 	unique_cleanup();
 
-	return 0;
+	return failed;
 }
@@ -39,32 +39,32 @@ static void identify(FILE *file, const struct inst *inst)
 }
 
 
-static void gnuplot_line(FILE *file, const struct inst *inst)
+static void gnuplot_line(FILE *file, const struct inst_cols *c, int i)
 {
 	double xa, ya, xb, yb;
 
-	xa = units_to_mm(inst->base.x);
-	ya = units_to_mm(inst->base.y);
-	xb = units_to_mm(inst->u.rect.end.x);
-	yb = units_to_mm(inst->u.rect.end.y);
+	xa = units_to_mm(c->ax[i]);
+	ya = units_to_mm(c->ay[i]);
+	xb = units_to_mm(c->bx[i]);
+	yb = units_to_mm(c->by[i]);
 
-	identify(file, inst);
+	identify(file, c->inst[i]);
 	fprintf(file, "#%%r=%f\n%f %f\n%f %f\n\n",
-	    units_to_mm(inst->u.rect.width), xa, ya, xb, yb);
+	    units_to_mm(c->width[i]), xa, ya, xb, yb);
 }
 
 
-static void gnuplot_rect(FILE *file, const struct inst *inst)
+static void gnuplot_rect(FILE *file, const struct inst_cols *c, int i)
 {
 	double xa, ya, xb, yb;
 
-	xa = units_to_mm(inst->base.x);
-	ya = units_to_mm(inst->base.y);
-	xb = units_to_mm(inst->u.rect.end.x);
-	yb = units_to_mm(inst->u.rect.end.y);
+	xa = units_to_mm(c->ax[i]);
+	ya = units_to_mm(c->ay[i]);
+	xb = units_to_mm(c->bx[i]);
+	yb = units_to_mm(c->by[i]);
 
-	identify(file, inst);
-	fprintf(file, "#%%r=%f\n", units_to_mm(inst->u.rect.width));
+	identify(file, c->inst[i]);
+	fprintf(file, "#%%r=%f\n", units_to_mm(c->width[i]));
 	fprintf(file, "%f %f\n", xa, ya);
 	fprintf(file, "%f %f\n", xa, yb);
 	fprintf(file, "%f %f\n", xb, yb);
@@ -73,42 +73,42 @@ static void gnuplot_rect(FILE *file, const struct inst *inst)
 }
 
 
-static void gnuplot_circ(FILE *file, const struct inst *inst)
+static void gnuplot_circ(FILE *file, const struct inst_cols *c, int i)
 {
 	double cx, cy, r;
 	double a;
-	int n, i;
+	int n, j;
 
-	cx = units_to_mm(inst->base.x);
-	cy = units_to_mm(inst->base.y);
-	r = units_to_mm(inst->u.arc.r);
+	cx = units_to_mm(c->ax[i]);
+	cy = units_to_mm(c->ay[i]);
+	r = units_to_mm(c->r[i]);
 
-	identify(file, inst);
-	fprintf(file, "#%%r=%f\n", units_to_mm(inst->u.arc.width));
+	identify(file, c->inst[i]);
+	fprintf(file, "#%%r=%f\n", units_to_mm(c->width[i]));
 
 	n = ceil(2*r*M_PI/ARC_STEP);
 	if (n < 2)
 		n = 2;
 
-	for (i = 0; i <= n; i++) {
-		a = 2*M_PI/n*i;
+	for (j = 0; j <= n; j++) {
+		a = 2*M_PI/n*j;
 		fprintf(file, "%f %f\n", cx+r*sin(a), cy+r*cos(a));
 	}
 	fprintf(file, "\n");
 }
 
 
-static void gnuplot_arc(FILE *file, const struct inst *inst)
+static void gnuplot_arc(FILE *file, const struct inst_cols *c, int i)
 {
 	double cx, cy, r;
 	double a, tmp;
-	int n, i;
+	int n, j;
 
-	cx = units_to_mm(inst->base.x);
-	cy = units_to_mm(inst->base.y);
-	r = units_to_mm(inst->u.arc.r);
+	cx = units_to_mm(c->ax[i]);
+	cy = units_to_mm(c->ay[i]);
+	r = units_to_mm(c->r[i]);
 
-	a = inst->u.arc.a2-inst->u.arc.a1;
+	a = c->a2[i]-c->a1[i];
 	while (a <= 0)
 		a += 360;
 	while (a > 360)
@@ -118,8 +118,8 @@ static void gnuplot_arc(FILE *file, const struct inst *inst)
 	if (n < 2)
 		n = 2;
 
-	for (i = 0; i <= n; i++) {
-		tmp = (inst->u.arc.a1+a/n*i)*M_PI/180;
+	for (j = 0; j <= n; j++) {
+		tmp = (c->a1[i]+a/n*j)*M_PI/180;
 		fprintf(file, "%f %f\n", cx+r*cos(tmp), cy+r*sin(tmp));
 	}
 
@@ -127,9 +127,11 @@ static void gnuplot_arc(FILE *file, const struct inst *inst)
 }
 
 
-static void gnuplot_inst(FILE *file, enum inst_prio prio,
-    const struct inst *inst)
+static void gnuplot_cols(FILE *file, enum inst_prio prio,
+    const struct inst_cols *c)
 {
+	int i;
+
 	switch (prio) {
 	case ip_pad_copper:
 	case ip_pad_special:
@@ -139,16 +141,20 @@ static void gnuplot_inst(FILE *file, enum inst_prio prio,
 		/* complain ? */
 		break;
 	case ip_line:
-		gnuplot_line(file, inst);
+		for (i = 0; i != c->n; i++)
+			gnuplot_line(file, c, i);
 		break;
 	case ip_rect:
-		gnuplot_rect(file, inst);
+		for (i = 0; i != c->n; i++)
+			gnuplot_rect(file, c, i);
 		break;
 	case ip_circ:
-		gnuplot_circ(file, inst);
+		for (i = 0; i != c->n; i++)
+			gnuplot_circ(file, c, i);
 		break;
 	case ip_arc:
-		gnuplot_arc(file, inst);
+		for (i = 0; i != c->n; i++)
+			gnuplot_arc(file, c, i);
 		break;
 	default:
 		/*
@@ -163,7 +169,6 @@ static void gnuplot_inst(FILE *file, enum inst_prio prio,
 static void gnuplot_package(FILE *file, const struct pkg *pkg)
 {
 	enum inst_prio prio;
-	const struct inst *inst;
 
 	/*
 	 * Package name
@@ -171,10 +176,8 @@ static void gnuplot_package(FILE *file, const struct pkg *pkg)
 	fprintf(file, "# %s\n", pkg->name);
 
 	FOR_INST_PRIOS_UP(prio) {
-		for (inst = pkgs->insts[prio]; inst; inst = inst->next)
-			gnuplot_inst(file, prio, inst);
-		for (inst = pkg->insts[prio]; inst; inst = inst->next)
-			gnuplot_inst(file, prio, inst);
+		gnuplot_cols(file, prio, pkgs->cols+prio);
+		gnuplot_cols(file, prio, pkg->cols+prio);
 	}
 
 	fprintf(file, "\n");
@@ -15,7 +15,9 @@
 #include <gtk/gtk.h>
 
 #include "inst.h"
+#include "gui_select.h"
 #include "file.h"
+#include "journal.h"
 #include "gui_util.h"
 #include "gui_style.h"
 #include "gui_status.h"
@@ -40,6 +42,7 @@ int show_all = 1;
 int show_stuff = 1;
 int show_meas = 1;
 int show_bright = 0;
+int cairo_canvas = 0;
 
 
 static GtkWidget *paned;
@@ -330,6 +333,7 @@ void change_world(void)
 	struct bbox before, after;
 	int reachable_is_active;
 
+	journal_commit();
 	inst_deselect();
 	status_begin_reporting();
 	before = inst_get_bbox(NULL);
@@ -341,7 +345,7 @@ void change_world(void)
 		instantiate();
 	}
 	after = inst_get_bbox(NULL);
-	label_in_box_bg(active_frame->label, COLOR_FRAME_SELECTED);
+	label_in_box_bg(item_widget(active_frame), COLOR_FRAME_SELECTED);
 	do_build_frames();
 	if (after.min.x < before.min.x || after.min.y < before.min.y ||
 	    after.max.x > before.max.x || after.max.y > before.max.y)
@@ -420,7 +424,9 @@ int gui_main(void)
 	select_frame(frames);
 	make_popups();
 
+	journal_start();
 	gtk_main();
+	journal_stop();
 
 	gui_cleanup_style();
 	gui_cleanup_tools();
@@ -25,6 +25,8 @@ extern int show_bright;
 
 extern int no_save;
 
+extern int cairo_canvas;	/* draw the canvas in batches, with Cairo */
+
 
 /* update everything after a model change */
 void change_world(void);
@@ -0,0 +1,282 @@
+/*
+ * gui_batch.c - GUI, batched canvas drawing with Cairo
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Drawing each instance with its own GDK call means one request to the X
+ * server per line or pad, and constant switching between GCs. Instead, we
+ * give each combination of GC, line width, and fill mode its own Cairo
+ * context and only build the path in it. The caller flushes at the points
+ * where the stacking order matters, i.e., after each class of instances.
+ *
+ * Filled shapes of the same color must combine to their union. We therefore
+ * trace all of them counter-clockwise (as seen on the screen), so that the
+ * nonzero winding rule never cancels overlapping areas.
+ */
+
+
+#include <stdlib.h>
+#include <math.h>
+#include <gtk/gtk.h>
+
+#include "util.h"
+#include "gui_util.h"
+#include "gui_batch.h"
+
+
+struct batch {
+	GdkGC *gc;
+	int width;
+	int fill;
+	cairo_t *cr;
+	struct batch *next;
+};
+
+struct text_op {
+	GdkGC *gc;
+	int x, y;
+	double angle;
+	char *s;
+	const char *font;
+	double xalign, yalign;
+	int xmax, ymax;
+	struct text_op *next;
+};
+
+
+static GdkDrawable *batch_da = NULL;	/* NULL if we draw directly */
+static struct batch *batches = NULL;
+static struct batch **last_batch = &batches;
+static struct text_op *texts = NULL;
+static struct text_op **last_text = &texts;
+
+
+/* ----- paths ------------------------------------------------------------- */
+
+
+static int gc_width(GdkGC *gc)
+{
+	GdkGCValues values;
+
+	gdk_gc_get_values(gc, &values);
+	return values.line_width;
+}
+
+
+/*
+ * GDK draws lines of width zero one pixel wide. A line of odd width is
+ * centered on the pixel, so we move the path to the middle of the pixel.
+ */
+
+static cairo_t *get_path(GdkGC *gc, int fill)
+{
+	GdkGCValues values;
+	GdkColor color;
+	struct batch *b;
+	int width;
+
+	width = gc_width(gc);
+	for (b = batches; b; b = b->next)
+		if (b->gc == gc && b->width == width && b->fill == fill)
+			return b->cr;
+
+	b = alloc_type(struct batch);
+	b->gc = gc;
+	b->width = width;
+	b->fill = fill;
+	b->cr = gdk_cairo_create(batch_da);
+	gdk_gc_get_values(gc, &values);
+	gdk_colormap_query_color(gdk_drawable_get_colormap(batch_da),
+	    values.foreground.pixel, &color);
+	gdk_cairo_set_source_color(b->cr, &color);
+	if (!fill) {
+		cairo_set_line_width(b->cr, width ? width : 1);
+		if (!width || width & 1)
+			cairo_translate(b->cr, 0.5, 0.5);
+	}
+	b->next = NULL;
+	*last_batch = b;
+	last_batch = &b->next;
+	return b->cr;
+}
+
+
+/* ----- drawing ----------------------------------------------------------- */
+
+
+void batch_line(GdkGC *gc, int xa, int ya, int xb, int yb)
+{
+	cairo_t *cr;
+
+	if (!batch_da) {
+		gdk_draw_line(DA, gc, xa, ya, xb, yb);
+		return;
+	}
+	cr = get_path(gc, FALSE);
+	cairo_move_to(cr, xa, ya);
+	cairo_line_to(cr, xb, yb);
+}
+
+
+void batch_rectangle(GdkGC *gc, int fill, int x, int y, int w, int h)
+{
+	cairo_t *cr;
+
+	if (!batch_da) {
+		gdk_draw_rectangle(DA, gc, fill, x, y, w, h);
+		return;
+	}
+	cr = get_path(gc, fill);
+	cairo_move_to(cr, x, y);
+	cairo_line_to(cr, x, y+h);
+	cairo_line_to(cr, x+w, y+h);
+	cairo_line_to(cr, x+w, y);
+	cairo_close_path(cr);
+}
+
+
+/*
+ * With y pointing down, the shoelace sum of a counter-clockwise polygon is
+ * negative.
+ */
+
+void batch_polygon(GdkGC *gc, int fill, const GdkPoint *points, int n)
+{
+	cairo_t *cr;
+	long area = 0;
+	int i;
+
+	if (!batch_da) {
+		gdk_draw_polygon(DA, gc, fill, (GdkPoint *) points, n);
+		return;
+	}
+	cr = get_path(gc, fill);
+	for (i = 0; i != n; i++)
+		area += (long) points[i].x*points[(i+1) % n].y-
+		    (long) points[(i+1) % n].x*points[i].y;
+	if (area > 0) {
+		cairo_move_to(cr, points[n-1].x, points[n-1].y);
+		for (i = n-2; i >= 0; i--)
+			cairo_line_to(cr, points[i].x, points[i].y);
+	} else {
+		cairo_move_to(cr, points[0].x, points[0].y);
+		for (i = 1; i != n; i++)
+			cairo_line_to(cr, points[i].x, points[i].y);
+	}
+	cairo_close_path(cr);
+}
+
+
+/*
+ * Like draw_arc. GDK counts angles counter-clockwise and draws a filled arc
+ * as a pie slice.
+ */
+
+void batch_arc(GdkGC *gc, int fill, int x, int y, int r, double a1, double a2)
+{
+	cairo_t *cr;
+
+	if (!batch_da) {
+		draw_arc(DA, gc, fill, x, y, r, a1, a2);
+		return;
+	}
+	if (a2 <= a1)
+		a2 += 360;
+	cr = get_path(gc, fill);
+	if (fill) {
+		cairo_move_to(cr, x, y);
+	} else {
+		cairo_new_sub_path(cr);
+	}
+	cairo_arc_negative(cr, x, y, r, -a1/180*M_PI, -a2/180*M_PI);
+	if (fill)
+		cairo_close_path(cr);
+}
+
+
+void batch_circle(GdkGC *gc, int fill, int x, int y, int r)
+{
+	batch_arc(gc, fill, x, y, r, 0, 360);
+}
+
+
+void batch_text(GdkGC *gc, int x, int y, double angle,
+    const char *s, const char *font, double xalign, double yalign,
+    int xmax, int ymax)
+{
+	struct text_op *t;
+
+	if (!batch_da) {
+		render_text(DA, gc, x, y, angle, s, font, xalign, yalign,
+		    xmax, ymax);
+		return;
+	}
+	t = alloc_type(struct text_op);
+	t->gc = gc;
+	t->x = x;
+	t->y = y;
+	t->angle = angle;
+	t->s = stralloc(s);
+	t->font = font;
+	t->xalign = xalign;
+	t->yalign = yalign;
+	t->xmax = xmax;
+	t->ymax = ymax;
+	t->next = NULL;
+	*last_text = t;
+	last_text = &t->next;
+}
+
+
+/* ----- batches ----------------------------------------------------------- */
+
+
+void batch_begin(GdkDrawable *da)
+{
+	batch_da = da;
+}
+
+
+void batch_flush(void)
+{
+	struct batch *b;
+	struct text_op *t;
+
+	if (!batch_da)
+		return;
+	while (batches) {
+		b = batches;
+		if (b->fill)
+			cairo_fill(b->cr);
+		else
+			cairo_stroke(b->cr);
+		cairo_destroy(b->cr);
+		batches = b->next;
+		free(b);
+	}
+	last_batch = &batches;
+	while (texts) {
+		t = texts;
+		render_text(batch_da, t->gc, t->x, t->y, t->angle, t->s,
+		    t->font, t->xalign, t->yalign, t->xmax, t->ymax);
+		texts = t->next;
+		free(t->s);
+		free(t);
+	}
+	last_text = &texts;
+}
+
+
+void batch_end(void)
+{
+	batch_flush();
+	batch_da = NULL;
+}
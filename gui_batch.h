@@ -0,0 +1,40 @@
+/*
+ * gui_batch.h - GUI, batched canvas drawing with Cairo
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef GUI_BATCH_H
+#define	GUI_BATCH_H
+
+#include <gtk/gtk.h>
+
+
+/*
+ * Between batch_begin and batch_end, the drawing functions below only add to
+ * one path per GC, line width, and fill mode. batch_flush fills or strokes
+ * these paths, in the order in which they were first used, and then draws the
+ * text on top. Outside a batch, the functions draw with GDK right away.
+ */
+
+void batch_line(GdkGC *gc, int xa, int ya, int xb, int yb);
+void batch_rectangle(GdkGC *gc, int fill, int x, int y, int w, int h);
+void batch_polygon(GdkGC *gc, int fill, const GdkPoint *points, int n);
+void batch_arc(GdkGC *gc, int fill, int x, int y, int r, double a1, double a2);
+void batch_circle(GdkGC *gc, int fill, int x, int y, int r);
+void batch_text(GdkGC *gc, int x, int y, double angle,
+    const char *s, const char *font, double xalign, double yalign,
+    int xmax, int ymax);
+
+void batch_begin(GdkDrawable *da);
+void batch_flush(void);
+void batch_end(void);
+
+#endif /* !GUI_BATCH_H */
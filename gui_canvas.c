@@ -16,14 +16,17 @@
 #include <gdk/gdkkeysyms.h>
 
 #include "obj.h"
-#include "delete.h"
+#include "journal.h"
 #include "inst.h"
+#include "gui_select.h"
 #include "gui_util.h"
+#include "gui_batch.h"
 #include "gui_inst.h"
 #include "gui_style.h"
 #include "gui_status.h"
 #include "gui_tool.h"
 #include "gui.h"
+#include "gui_frame.h"
 #include "gui_frame_drag.h"
 #include "gui_canvas.h"
 
@@ -139,7 +142,10 @@ void redraw(void)
 	    instantiation_error ? gc_bg_error : gc_bg, TRUE, 0, 0, aw, ah);
 
 	DPRINTF("--- redraw: inst_draw ---");
+	if (cairo_canvas)
+		batch_begin(DA);
 	inst_draw();
+	batch_end();
 	if (highlight)
 		highlight();
 	DPRINTF("--- redraw: tool_redraw ---");
@@ -405,6 +411,80 @@ static gboolean scroll_event(GtkWidget *widget, GdkEventScroll *event,
 /* ----- keys -------------------------------------------------------------- */
 
 
+/*
+ * The journal doesn't record which rows and frame references the user
+ * selected, so undo and redo may remove the ones selected. We then pick the
+ * first row or reference instead. Loop iterations past the end are harmless.
+ */
+
+static int ref_exists(const struct frame *ref, const struct obj *ref_obj)
+{
+	const struct frame *frame;
+	const struct obj *obj;
+
+	for (frame = frames; frame; frame = frame->next)
+		for (obj = frame->objs; obj; obj = obj->next)
+			if (obj == ref_obj)
+				return obj->type == ot_frame &&
+				    obj->u.frame.ref == ref;
+	return 0;
+}
+
+
+static struct obj *first_ref(const struct frame *ref)
+{
+	const struct frame *frame;
+	struct obj *obj;
+
+	for (frame = frames; frame; frame = frame->next)
+		for (obj = frame->objs; obj; obj = obj->next)
+			if (obj->type == ot_frame && obj->u.frame.ref == ref)
+				return obj;
+	return NULL;
+}
+
+
+static void check_selection(void)
+{
+	struct frame *frame;
+	struct table *table;
+	const struct row *row;
+
+	for (frame = frames; frame; frame = frame->next) {
+		for (table = frame->tables; table; table = table->next) {
+			for (row = table->rows; row; row = row->next)
+				if (row == table->active_row)
+					break;
+			if (!row)
+				table->active_row = table->rows;
+		}
+		if (frame->active_ref && !ref_exists(frame, frame->active_ref))
+			frame->active_ref = first_ref(frame);
+	}
+}
+
+
+/*
+ * Undo and redo may remove the frame we're in, or items a tool is working on.
+ */
+
+static void change_history(int (*step)(void))
+{
+	const struct frame *frame;
+
+	tool_reset();
+	if (!step())
+		return;
+	check_selection();
+	for (frame = frames; frame; frame = frame->next)
+		if (frame == active_frame)
+			break;
+	if (!frame)
+		select_frame(frames);
+	change_world();
+}
+
+
 static gboolean key_press_event(GtkWidget *widget, GdkEventKey *event,
     gpointer data)
 {
@@ -446,8 +526,10 @@ static gboolean key_press_event(GtkWidget *widget, GdkEventKey *event,
 		break;
 #endif
 	case 'u':
-		if (undelete())
-			change_world();
+		change_history(journal_undo);
+		break;
+	case 'r':
+		change_history(journal_redo);
 		break;
 	case '/':
 {
@@ -18,8 +18,11 @@
 #include "error.h"
 #include "dump.h"
 #include "inst.h"
+#include "gui_select.h"
 #include "obj.h"
 #include "delete.h"
+#include "journal.h"
+#include "hash.h"
 #include "unparse.h"
 #include "gui_util.h"
 #include "gui_style.h"
@@ -34,6 +37,78 @@
 int show_vars = 1;
 
 
+/* ----- widgets of items ------------------------------------------------- */
+
+
+/*
+ * The widgets showing variables, values, vectors, objects, and frames. They
+ * only live until the next build_frames, so we forget them all there.
+ */
+
+struct item_widget {
+	const void *item;
+	GtkWidget *widget;
+};
+
+
+static struct hash *item_widgets = NULL;
+
+
+static unsigned hash_item_widget(const void *item)
+{
+	const struct item_widget *iw = item;
+
+	return hash_bytes(HASH_INIT, &iw->item, sizeof(iw->item));
+}
+
+
+static int eq_item_widget(const void *a, const void *b)
+{
+	const struct item_widget *ia = a, *ib = b;
+
+	return ia->item == ib->item;
+}
+
+
+GtkWidget *item_widget(const void *item)
+{
+	struct item_widget key;
+	const struct item_widget *iw;
+
+	if (!item_widgets)
+		return NULL;
+	key.item = item;
+	iw = hash_lookup(item_widgets, &key);
+	return iw ? iw->widget : NULL;
+}
+
+
+void set_item_widget(const void *item, GtkWidget *widget)
+{
+	struct item_widget key, *iw;
+
+	if (!item_widgets)
+		item_widgets = hash_new(hash_item_widget, eq_item_widget);
+	key.item = item;
+	iw = hash_lookup(item_widgets, &key);
+	if (!iw) {
+		iw = alloc_type(struct item_widget);
+		iw->item = item;
+		hash_add(item_widgets, iw);
+	}
+	iw->widget = widget;
+}
+
+
+static void forget_item_widgets(void)
+{
+	if (item_widgets) {
+		hash_free(item_widgets, free);
+		item_widgets = NULL;
+	}
+}
+
+
 /* ----- add elements, shared ---------------------------------------------- */
 
 
@@ -56,10 +131,10 @@ static void add_table(struct frame *frame, struct table **anchor)
 	table->active_row = table->rows;
 	if (anchor) {
 		table->next = *anchor;
-		*anchor = table;
+		journal_replace(anchor, table, NULL, discard_table);
 	} else {
 		for (walk = &frame->tables; *walk; walk = &(*walk)->next);
-		*walk = table;
+		journal_replace(walk, table, NULL, discard_table);
 	}
 	change_world();
 }
@@ -76,11 +151,11 @@ static void add_loop(struct frame *frame, struct loop **anchor)
 	loop->to.expr = parse_expr("0");
 	if (anchor) {
 		loop->next = *anchor;
-		*anchor = loop;
+		journal_replace(anchor, loop, NULL, discard_loop);
 	} else {
 		loop->next = NULL;
 		for (walk = &frame->loops; *walk; walk = &(*walk)->next);
-		*walk = loop;
+		journal_replace(walk, loop, NULL, discard_loop);
 	}
 	change_world();
 }
@@ -115,7 +190,8 @@ static void popup_add_frame(void)
 	new = zalloc_type(struct frame);
 	new->name = unique("_");
 	new->next = parent->next;
-	parent->next = new;
+	journal_replace(&parent->next, new, NULL, discard_frame);
+	frame_refs_changed();
 	change_world();
 }
 
@@ -237,8 +313,7 @@ static void add_row_here(struct table *table, struct row **anchor)
 		row->values = value;
 	}
 	row->next = *anchor;
-	*anchor = row;
-	change_world();
+	journal_replace(anchor, row, NULL, discard_row);
 }
 
 
@@ -258,7 +333,7 @@ static void add_column_here(struct table *table, struct var **anchor)
 	var->frame = table->vars->frame;
 	var->table = table;
 	var->next = *anchor;
-	*anchor = var;
+	journal_replace(anchor, var, NULL, free);
 	for (row = table->rows; row; row = row->next) {
 		value_anchor = &row->values;
 		for (i = 0; i != n; i++)
@@ -267,9 +342,8 @@ static void add_column_here(struct table *table, struct var **anchor)
 		value->expr = parse_expr("0");
 		value->row = row;
 		value->next = *value_anchor;
-		*value_anchor = value;
+		journal_replace(value_anchor, value, NULL, discard_value);
 	}
-	change_world();
 }
 
 
@@ -278,6 +352,7 @@ static void popup_add_row(void)
 	struct var *var = popup_data;
 
 	add_row_here(var->table, &var->table->rows);
+	change_world();
 }
 
 
@@ -286,6 +361,7 @@ static void popup_add_column(void)
 	struct var *var = popup_data;
 
 	add_column_here(var->table, &var->next);
+	change_world();
 }
 
 
@@ -407,6 +483,7 @@ static void popup_add_column_by_value(void)
 	for (walk = value->row->values; walk != value; walk = walk->next)
 		var = var->next;
 	add_column_here(table, &var->next);
+	change_world();
 }
 
 
@@ -415,6 +492,7 @@ static void popup_add_row_by_value(void)
 	struct value *value = popup_data;
 
 	add_row_here(value->row->table, &value->row->next);
+	change_world();
 }
 
 
@@ -424,8 +502,10 @@ static void popup_del_row(void)
 	struct table *table = value->row->table;
 
 	delete_row(value->row);
-	if (table->active_row == value->row)
+	if (table->active_row == value->row) {
+		journal_store(&table->active_row, sizeof(table->active_row));
 		table->active_row = table->rows;
+	}
 	change_world();
 }
 
@@ -607,7 +687,7 @@ static void unselect_var(void *data)
 {
 	struct var *var = data;
 
-	label_in_box_bg(var->widget, COLOR_VAR_PASSIVE);
+	label_in_box_bg(item_widget(var), COLOR_VAR_PASSIVE);
 }
 
 
@@ -649,7 +729,7 @@ static void edit_var(struct var *var,
     void *user, int max_values)
 {
 	inst_select_outside(var, unselect_var);
-	label_in_box_bg(var->widget, COLOR_VAR_EDITING);
+	label_in_box_bg(item_widget(var), COLOR_VAR_EDITING);
 	status_set_type_entry(NULL, "name =");
 	status_set_name("Variable name", "%s", var->name);
 	show_var_value(var, var->frame);
@@ -689,7 +769,7 @@ static void unselect_value(void *data)
 	 * We need the last condition because the expressions of assignments
 	 * are drawn with COLOR_EXPR_PASSIVE. (See build_assignment.)
 	 */
-	label_in_box_bg(value->widget,
+	label_in_box_bg(item_widget(value),
 	    value->row && value->row->table->active_row == value->row &&
 	    (value->row->table->rows->next || value->row->table->vars->next) ?
 	     COLOR_CHOICE_SELECTED : COLOR_EXPR_PASSIVE);
@@ -699,7 +779,7 @@ static void unselect_value(void *data)
 static void edit_value(struct value *value, const struct frame *frame)
 {
 	inst_select_outside(value, unselect_value);
-	label_in_box_bg(value->widget, COLOR_EXPR_EDITING);
+	label_in_box_bg(item_widget(value), COLOR_EXPR_EDITING);
 	show_value(value->expr, frame);
 	edit_nothing();
 	edit_expr(&value->expr, "Value");
@@ -711,7 +791,7 @@ static void edit_value_list(struct value *value, const struct frame *frame,
     void *user)
 {
 	inst_select_outside(value, unselect_value);
-	label_in_box_bg(value->widget, COLOR_EXPR_EDITING);
+	label_in_box_bg(item_widget(value), COLOR_EXPR_EDITING);
 	show_value(value->expr, frame);
 	edit_nothing();
 	edit_expr_list(value->expr, set_values, user, "Value(s)");
@@ -764,8 +844,8 @@ static void set_col_values(void *user, const struct value *values,
 		value = (*row)->values;
 		for (walk = table->vars; walk != var; walk = walk->next)
 			value = value->next;
-		free_expr(value->expr);
-		value->expr = values->expr;
+		journal_replace(&value->expr, values->expr,
+		    discard_expr, discard_expr);
 		values = values->next;
 		row = &(*row)->next;
 	}
@@ -831,7 +911,7 @@ static void build_assignment(GtkWidget *vbox, struct frame *frame,
 
 	gtk_box_pack_start(GTK_BOX(hbox), box_of_label(field), FALSE, FALSE, 0);
 	label_in_box_bg(field, COLOR_VAR_PASSIVE);
-	table->vars->widget = field;
+	set_item_widget(table->vars, field);
 	g_signal_connect(G_OBJECT(box_of_label(field)),
 	    "button_press_event",
 	    G_CALLBACK(assignment_var_select_event), table->vars);
@@ -844,7 +924,7 @@ static void build_assignment(GtkWidget *vbox, struct frame *frame,
 	free(expr);
 	gtk_box_pack_start(GTK_BOX(hbox), box_of_label(field), FALSE, FALSE, 0);
 	label_in_box_bg(field, COLOR_EXPR_PASSIVE);
-	table->rows->values->widget = field;
+	set_item_widget(table->rows->values, field);
 	g_signal_connect(G_OBJECT(box_of_label(field)),
 	    "button_press_event",
 	    G_CALLBACK(assignment_value_select_event), table->rows->values);
@@ -860,10 +940,10 @@ static void select_row(struct row *row)
 	struct value *value;
 
 	for (value = table->active_row->values; value; value = value->next)
-		label_in_box_bg(value->widget, COLOR_ROW_UNSELECTED);
+		label_in_box_bg(item_widget(value), COLOR_ROW_UNSELECTED);
 	table->active_row = row;
 	for (value = table->active_row->values; value; value = value->next)
-		label_in_box_bg(value->widget, COLOR_ROW_SELECTED);
+		label_in_box_bg(item_widget(value), COLOR_ROW_SELECTED);
 }
 
 
@@ -888,8 +968,8 @@ static void set_row_values(void *user, const struct value *values,
 			first = 0;
 		else
 			value = value->next;
-		free_expr(value->expr);
-		value->expr = values->expr;
+		journal_replace(&value->expr, values->expr,
+		    discard_expr, discard_expr);
 		values = values->next;
 		var = &(*var)->next;
 	}
@@ -1055,7 +1135,7 @@ static void build_table(GtkWidget *vbox, struct frame *frame,
 		g_signal_connect(G_OBJECT(box_of_label(field)),
 		    "scroll_event",
 		    G_CALLBACK(table_scroll_event), table);
-		var->widget = field;
+		set_item_widget(var, field);
 
 		setup_var_drag(var);
 
@@ -1083,7 +1163,7 @@ static void build_table(GtkWidget *vbox, struct frame *frame,
 			g_signal_connect(G_OBJECT(box_of_label(field)),
 			    "scroll_event",
 			    G_CALLBACK(table_scroll_event), table);
-			value->widget = field;
+			set_item_widget(value, field);
 			setup_value_drag(value);
 			n_row++;
 		}
@@ -1099,13 +1179,13 @@ static void build_table(GtkWidget *vbox, struct frame *frame,
 			 * to explicitly remove their content as well.
 			 */
 			gtk_container_remove(GTK_CONTAINER(tab),
-			    box_of_label(var->widget));
+			    box_of_label(item_widget(var)));
 			for (row = table->rows; row; row = row->next) {
 				value = row->values;
 				for (pos = 0; pos != n_var; pos++)
 					value = value->next;
 				gtk_container_remove(GTK_CONTAINER(tab),
-				    box_of_label(value->widget));
+				    box_of_label(item_widget(value)));
 			}
 			gtk_table_resize(GTK_TABLE(tab), n_rows, n_vars);
 
@@ -1134,14 +1214,12 @@ static void set_loop_values(void *user, const struct value *values,
 
 	switch (n_values) {
 	case 2:
-		if (loop->to.expr)
-			free_expr(loop->to.expr);
-		loop->to.expr = values->next->expr;
+		journal_replace(&loop->to.expr, values->next->expr,
+		    discard_expr, discard_expr);
 		/* fall through */
 	case 1:
-		if (loop->from.expr)
-			free_expr(loop->from.expr);
-		loop->from.expr = values->expr;
+		journal_replace(&loop->from.expr, values->expr,
+		    discard_expr, discard_expr);
 		break;
 	case 0:
 		break;
@@ -1258,7 +1336,7 @@ static void build_loop(GtkWidget *vbox, struct frame *frame,
 	g_signal_connect(G_OBJECT(box_of_label(field)),
 	    "button_press_event",
 	    G_CALLBACK(loop_var_select_event), loop);
-	loop->var.widget = field;
+	set_item_widget(&loop->var, field);
 
 	gtk_box_pack_start(GTK_BOX(hbox), gtk_label_new(" = "),
 	    FALSE, FALSE, 0);
@@ -1272,7 +1350,7 @@ static void build_loop(GtkWidget *vbox, struct frame *frame,
 	g_signal_connect(G_OBJECT(box_of_label(field)),
 	    "button_press_event",
 	    G_CALLBACK(loop_from_select_event), loop);
-	loop->from.widget = field;
+	set_item_widget(&loop->from, field);
 
 	gtk_box_pack_start(GTK_BOX(hbox), gtk_label_new(" ... "),
 	    FALSE, FALSE, 0);
@@ -1285,7 +1363,7 @@ static void build_loop(GtkWidget *vbox, struct frame *frame,
 	g_signal_connect(G_OBJECT(box_of_label(field)),
 	    "button_press_event",
 	    G_CALLBACK(loop_to_select_event), loop);
-	loop->to.widget = field;
+	set_item_widget(&loop->to, field);
 
 	gtk_box_pack_start(GTK_BOX(hbox), gtk_label_new(" ("),
 	    FALSE, FALSE, 0);
@@ -1339,9 +1417,9 @@ static void set_item_color(struct inst *inst, const char *color)
 	GtkWidget *label;
 
 	if (inst->vec)
-		label = inst->vec->list_widget;
+		label = item_widget(inst->vec);
 	else
-		label = inst->obj->list_widget;
+		label = item_widget(inst->obj);
 	if (label)
 		label_in_box_bg(box_of_label(label), color);
 }
@@ -1414,7 +1492,7 @@ static GtkWidget *item_label(GtkWidget *tab, char *s, int col, int row,
 
 static GtkWidget *build_items(struct frame *frame)
 {
-	GtkWidget *vbox, *hbox, *tab;
+	GtkWidget *vbox, *hbox, *tab, *label;
 	struct order *order, *item;
 	struct vec *vec;
 	struct obj *obj;
@@ -1442,21 +1520,21 @@ static GtkWidget *build_items(struct frame *frame)
 	for (item = order; item->vec || item->obj; item++) {
 		if (item->obj) {
 			s = print_obj(item->obj, item->vec);
-			item->obj->list_widget = item_label(tab, s, 1, n,
+			label = item_label(tab, s, 1, n,
 			    item_select_obj, item->obj);
+			set_item_widget(item->obj, label);
 			if (item->obj == instantiation_error)
-				label_in_box_fg(item->obj->list_widget,
-				    COLOR_ITEM_ERROR);
+				label_in_box_fg(label, COLOR_ITEM_ERROR);
 		} else {
 			t = stralloc_printf("%s: ", print_label(item->vec));
 			item_label(tab, t, 0, n, NULL, NULL);
 
 			s = print_vec(item->vec);
-			item->vec->list_widget = item_label(tab, s, 1, n,
+			label = item_label(tab, s, 1, n,
 			    item_select_vec, item->vec);
+			set_item_widget(item->vec, label);
 			if (item->vec == instantiation_error)
-				label_in_box_fg(item->vec->list_widget,
-				    COLOR_ITEM_ERROR);
+				label_in_box_fg(label, COLOR_ITEM_ERROR);
 		}
 		n++;
         }
@@ -1468,7 +1546,7 @@ static GtkWidget *build_items(struct frame *frame)
 
 static GtkWidget *build_meas(struct frame *frame)
 {
-	GtkWidget *vbox, *hbox, *tab;
+	GtkWidget *vbox, *hbox, *tab, *label;
 	struct obj *obj;
 	int n;
 	char *s;
@@ -1492,10 +1570,11 @@ static GtkWidget *build_meas(struct frame *frame)
 		if (obj->type != ot_meas)
 			continue;
 		s = print_meas(obj);
-		obj->list_widget = item_label(tab, s, 0, n,
+		label = item_label(tab, s, 0, n,
 		    item_select_obj, obj);
+		set_item_widget(obj, label);
 		if (obj == instantiation_error)
-			label_in_box_fg(obj->list_widget, COLOR_ITEM_ERROR);
+			label_in_box_fg(label, COLOR_ITEM_ERROR);
 		n++;
         }
 
@@ -1503,18 +1582,6 @@ static GtkWidget *build_meas(struct frame *frame)
 }
 
 
-static void dont_build_items(struct frame *frame)
-{
-	struct vec *vec;
-	struct obj *obj;
-
-	for (vec = frame->vecs; vec; vec = vec->next)
-		vec->list_widget = NULL;
-	for (obj = frame->objs; obj; obj = obj->next)
-		obj->list_widget = NULL;
-}
-
-
 /* ----- package name ------------------------------------------------------ */
 
 
@@ -1671,7 +1738,7 @@ static void unselect_frame(void *data)
 	 * change here doesn't matter if selecting a different frame.)
 	 * So we revert from "editing" to "selected".
 	 */
-	label_in_box_bg(frame->label, COLOR_FRAME_SELECTED);
+	label_in_box_bg(item_widget(frame), COLOR_FRAME_SELECTED);
 }
 
 
@@ -1680,7 +1747,7 @@ static void edit_frame(struct frame *frame)
 	const char *tip;
 
 	inst_select_outside(frame, unselect_frame);
-	label_in_box_bg(frame->label, COLOR_FRAME_EDITING);
+	label_in_box_bg(item_widget(frame), COLOR_FRAME_EDITING);
 	tip = "Frame name";
 	status_set_type_entry(NULL, "name =");
 	status_set_name(tip, "%s", frame->name);
@@ -1692,7 +1759,8 @@ static void edit_frame(struct frame *frame)
 void select_frame(struct frame *frame)
 {
 	if (active_frame)
-		label_in_box_bg(active_frame->label, COLOR_FRAME_UNSELECTED);
+		label_in_box_bg(item_widget(active_frame),
+		    COLOR_FRAME_UNSELECTED);
 	active_frame = frame;
 	change_world();
 }
@@ -1752,7 +1820,7 @@ static GtkWidget *build_frame_label(struct frame *frame)
 	    "button_press_event", G_CALLBACK(frame_press_event), frame);
 	g_signal_connect(G_OBJECT(box_of_label(label)),
 	    "button_release_event", G_CALLBACK(frame_release_event), frame);
-	frame->label = label;
+	set_item_widget(frame, label);
 
 	if (frame != frames)
 		setup_frame_drag(frame);
@@ -1814,6 +1882,7 @@ void build_frames(GtkWidget *vbox, int wrap_width)
 	int max_name_width, name_width;
 
 	destroy_all_children(GTK_CONTAINER(vbox));
+	forget_item_widgets();
 	for (frame = frames; frame; frame = frame->next)
 		n++;
 
@@ -1855,7 +1924,6 @@ void build_frames(GtkWidget *vbox, int wrap_width)
 			vars = build_vars(frame, wrap_width);
 			gtk_table_attach_defaults(GTK_TABLE(tab), vars,
 			    1, 2, n*2+2, n*2+3);
-			dont_build_items(frame);
 		} else {
 			items = build_items(frame);
 			gtk_table_attach_defaults(GTK_TABLE(tab), items,
@@ -28,6 +28,14 @@ void make_popups(void);
 
 void select_frame(struct frame *frame);
 
+/*
+ * item_widget returns the widget showing a variable, value, vector, object, or
+ * frame, or NULL if there is none.
+ */
+
+GtkWidget *item_widget(const void *item);
+void set_item_widget(const void *item, GtkWidget *widget);
+
 void gui_frame_select_inst(struct inst *inst);
 void gui_frame_deselect_inst(struct inst *inst);
 
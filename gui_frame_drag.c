@@ -16,9 +16,11 @@
 
 #include "util.h"
 #include "obj.h"
+#include "journal.h"
 #include "gui_util.h"
 #include "gui.h"
 #include "gui_canvas.h"
+#include "gui_frame.h"
 #include "gui_frame_drag.h"
 
 #if 0
@@ -197,6 +199,19 @@ static void swap_table_rows(GtkWidget *table, int a, int b)
 /* ----- swap table items -------------------------------------------------- */
 
 
+/*
+ * Like SWAP, but records the change in the journal. A drag is undone as a
+ * whole.
+ */
+
+#define JOURNAL_SWAP(a, b)				\
+	do {						\
+		journal_store(&(a), sizeof(a));		\
+		journal_store(&(b), sizeof(b));		\
+		SWAP(a, b);				\
+	} while (0)
+
+
 static void swap_vars(struct table *table, int a, int b)
 {
 	struct var **var_a, **var_b;
@@ -204,11 +219,11 @@ static void swap_vars(struct table *table, int a, int b)
 	var_a = NTH(table->vars, a);
 	var_b = NTH(table->vars, b);
 
-	swap_table_cells(box_of_label((*var_a)->widget),
-	    box_of_label((*var_b)->widget));
+	swap_table_cells(box_of_label(item_widget(*var_a)),
+	    box_of_label(item_widget(*var_b)));
 
-	SWAP(*var_a, *var_b);
-	SWAP((*var_a)->next, (*var_b)->next);
+	JOURNAL_SWAP(*var_a, *var_b);
+	JOURNAL_SWAP((*var_a)->next, (*var_b)->next);
 }
 
 
@@ -219,11 +234,11 @@ static void swap_values(struct row *row, int a, int b)
 	value_a = NTH(row->values, a);
 	value_b = NTH(row->values, b);
 
-	swap_table_cells(box_of_label((*value_a)->widget),
-	    box_of_label((*value_b)->widget));
+	swap_table_cells(box_of_label(item_widget(*value_a)),
+	    box_of_label(item_widget(*value_b)));
 
-	SWAP(*value_a, *value_b);
-	SWAP((*value_a)->next, (*value_b)->next);
+	JOURNAL_SWAP(*value_a, *value_b);
+	JOURNAL_SWAP((*value_a)->next, (*value_b)->next);
 }
 
 
@@ -244,13 +259,13 @@ static void swap_rows(struct row **a, struct row **b)
 	value_a = (*a)->values;
 	value_b = (*b)->values;
 	while (value_a) {
-		swap_table_cells(box_of_label(value_a->widget),
-		    box_of_label(value_b->widget));
+		swap_table_cells(box_of_label(item_widget(value_a)),
+		    box_of_label(item_widget(value_b)));
 		value_a = value_a->next;
 		value_b = value_b->next;
 	}
-	SWAP(*a, *b);
-	SWAP((*a)->next, (*b)->next);
+	JOURNAL_SWAP(*a, *b);
+	JOURNAL_SWAP((*a)->next, (*b)->next);
 }
 
 
@@ -265,8 +280,8 @@ static void swap_frames(GtkWidget *table, int a, int b)
 	swap_table_rows(table, 2*a+1, 2*b+1);
 	swap_table_rows(table, 2*a+2, 2*b+2);
 
-	SWAP(*frame_a, *frame_b);
-	SWAP((*frame_a)->next, (*frame_b)->next);
+	JOURNAL_SWAP(*frame_a, *frame_b);
+	JOURNAL_SWAP((*frame_a)->next, (*frame_b)->next);
 }
 
 
@@ -315,6 +330,7 @@ static void drag_end(GtkWidget *widget, GdkDragContext *drag_context,
     gpointer user_data)
 {
 	dragging = NULL;
+	journal_commit();
 }
 
 
@@ -354,7 +370,7 @@ void setup_var_drag(struct var *var)
 {
 	GtkWidget *box;
 
-	box = box_of_label(var->widget);
+	box = box_of_label(item_widget(var));
 	gtk_drag_source_set(box, GDK_BUTTON1_MASK,
 	    &target_var, 1, GDK_ACTION_PRIVATE);
 	gtk_drag_dest_set(box, GTK_DEST_DEFAULT_MOTION,
@@ -422,7 +438,7 @@ void setup_value_drag(struct value *value)
 {
 	GtkWidget *box;
 
-	box = box_of_label(value->widget);
+	box = box_of_label(item_widget(value));
 	gtk_drag_source_set(box, GDK_BUTTON1_MASK,
 	    &target_value, 1, GDK_ACTION_PRIVATE);
 	gtk_drag_dest_set(box, GTK_DEST_DEFAULT_MOTION,
@@ -510,7 +526,7 @@ void setup_frame_drag(struct frame *frame)
 {
 	GtkWidget *box;
 
-	box = box_of_label(frame->label);
+	box = box_of_label(item_widget(frame));
 	gtk_drag_source_set(box, GDK_BUTTON1_MASK,
 	    &target_frame, 1, GDK_ACTION_COPY | GDK_ACTION_MOVE);
 	gtk_drag_dest_set(box, GTK_DEST_DEFAULT_MOTION,
@@ -18,8 +18,11 @@
 #include "util.h"
 #include "coord.h"
 #include "inst.h"
+#include "drc.h"
+#include "gui_select.h"
 #include "gui.h"
 #include "gui_util.h"
+#include "gui_batch.h"
 #include "gui_style.h"
 #include "gui_status.h"
 #include "gui_inst.h"
@@ -59,8 +62,8 @@ struct coord canvas_to_coord(int x, int y)
 
 static void draw_eye(GdkGC *gc, struct coord center, int r1, int r2)
 {
-	draw_circle(DA, gc, TRUE, center.x, center.y, r1);
-	draw_circle(DA, gc, FALSE, center.x, center.y, r2);
+	batch_circle(gc, TRUE, center.x, center.y, r1);
+	batch_circle(gc, FALSE, center.x, center.y, r2);
 }
 
 
@@ -80,10 +83,10 @@ static void draw_poly(GdkGC *gc, int fill,
 		gp[i].y = points[i].y;
 	}
 	if (fill) {
-		gdk_draw_polygon(DA, gc, fill, gp, n_points);
+		batch_polygon(gc, fill, gp, n_points);
 	} else {
-		gdk_draw_line(DA, gc, gp[0].x, gp[0].y, gp[1].x, gp[1].y);
-		gdk_draw_line(DA, gc, gp[1].x, gp[1].y, gp[2].x, gp[2].y);
+		batch_line(gc, gp[0].x, gp[0].y, gp[1].x, gp[1].y);
+		batch_line(gc, gp[1].x, gp[1].y, gp[2].x, gp[2].y);
 	}
 }
 
@@ -147,7 +150,7 @@ void gui_highlight_vec(struct inst *self)
 {
 	struct coord center = translate(self->u.vec.end);
 
-	draw_circle(DA, gc_highlight, FALSE, center.x, center.y, VEC_EYE_R);
+	batch_circle(gc_highlight, FALSE, center.x, center.y, VEC_EYE_R);
 }
 
 
@@ -159,8 +162,8 @@ void gui_draw_vec(struct inst *self)
 
 	gc = gc_vec[get_mode(self)];
 	draw_arrow(gc, TRUE, from, to, VEC_ARROW_LEN, VEC_ARROW_ANGLE);
-	gdk_draw_line(DA, gc, from.x, from.y, to.x, to.y);
-	draw_circle(DA, gc, FALSE, to.x, to.y, VEC_EYE_R);
+	batch_line(gc, from.x, from.y, to.x, to.y);
+	batch_circle(gc, FALSE, to.x, to.y, VEC_EYE_R);
 }
 
 
@@ -187,7 +190,7 @@ void gui_draw_line(struct inst *self)
 
 	gc = gc_obj[get_mode(self)];
 	set_width(gc, self->u.rect.width/draw_ctx.scale);
-	gdk_draw_line(DA, gc, min.x, min.y, max.x, max.y);
+	batch_line(gc, min.x, min.y, max.x, max.y);
 }
 
 
@@ -215,7 +218,7 @@ void gui_draw_rect(struct inst *self)
 	sort_coord(&min, &max);
 	gc = gc_obj[get_mode(self)];
 	set_width(gc, self->u.rect.width/draw_ctx.scale);
-	gdk_draw_rectangle(DA, gc, FALSE,
+	batch_rectangle(gc, FALSE,
 	    min.x, min.y, max.x-min.x, max.y-min.y);
 }
 
@@ -249,7 +252,7 @@ static void pad_text_in_rect(struct inst *self,
 	c = add_vec(min, max);
 	h = max.y-min.y;
 	w = max.x-min.x;
-	render_text(DA, gc, c.x/2, c.y/2, rot ? 0 : 90,
+	batch_text(gc, c.x/2, c.y/2, rot ? 0 : 90,
 	    self->u.pad.name, PAD_FONT, 0.5, 0.5,
 	    w-2*PAD_BORDER, h-2*PAD_BORDER);
 }
@@ -339,7 +342,7 @@ void gui_draw_pad(struct inst *self)
 
 	gc = pad_gc(self, &fill);
 	sort_coord(&min, &max);
-	gdk_draw_rectangle(DA, gc, fill,
+	batch_rectangle(gc, fill,
 	    min.x, min.y, max.x-min.x, max.y-min.y);
 
 	gui_draw_pad_text(self);
@@ -358,26 +361,26 @@ static void draw_rounded_rect(GdkGC *gc, struct coord a, struct coord b,
 	w = max.x-min.x;
 	if (h > w) {
 		r = w/2;
-		draw_arc(DA, gc, fill, min.x+r, max.y-r, r, 180, 0);
+		batch_arc(gc, fill, min.x+r, max.y-r, r, 180, 0);
 		if (fill) {
-			gdk_draw_rectangle(DA, gc, fill,
+			batch_rectangle(gc, fill,
 			    min.x, min.y+r, w, h-2*r);
 		} else {
-			gdk_draw_line(DA, gc, min.x, min.y+r, min.x, max.y-r);
-			gdk_draw_line(DA, gc, max.x, min.y+r, max.x, max.y-r);
+			batch_line(gc, min.x, min.y+r, min.x, max.y-r);
+			batch_line(gc, max.x, min.y+r, max.x, max.y-r);
 		}
-		draw_arc(DA, gc, fill, min.x+r, min.y+r, r, 0, 180);
+		batch_arc(gc, fill, min.x+r, min.y+r, r, 0, 180);
 	} else {
 		r = h/2;
-		draw_arc(DA, gc, fill, min.x+r, min.y+r, r, 90, 270);
+		batch_arc(gc, fill, min.x+r, min.y+r, r, 90, 270);
 		if (fill) {
-			gdk_draw_rectangle(DA, gc, fill,
+			batch_rectangle(gc, fill,
 			    min.x+r, min.y, w-2*r, h);
 		} else {
-			gdk_draw_line(DA, gc, min.x+r, min.y, max.x-r, min.y);
-			gdk_draw_line(DA, gc, min.x+r, max.y, max.x-r, max.y);
+			batch_line(gc, min.x+r, min.y, max.x-r, min.y);
+			batch_line(gc, min.x+r, max.y, max.x-r, max.y);
 		}
-		draw_arc(DA, gc, fill, max.x-r, min.y+r, r, 270, 90);
+		batch_arc(gc, fill, max.x-r, min.y+r, r, 270, 90);
 	}
 }
 
@@ -474,7 +477,7 @@ void gui_draw_arc(struct inst *self)
 
 	gc = gc_obj[get_mode(self)];
 	set_width(gc, self->u.arc.width/draw_ctx.scale);
-	draw_arc(DA, gc, FALSE, center.x, center.y,
+	batch_arc(gc, FALSE, center.x, center.y,
 	    self->u.arc.r/draw_ctx.scale, self->u.arc.a1, self->u.arc.a2);
 }
 
@@ -482,51 +485,6 @@ void gui_draw_arc(struct inst *self)
 /* ----- meas -------------------------------------------------------------- */
 
 
-static struct coord offset_vec(struct coord a, struct coord b,
-    const struct inst *self)
-{
-	struct coord res;
-	double f;
-
-	res.x = a.y-b.y;
-	res.y = b.x-a.x;
-	if (res.x == 0 && res.y == 0)
-		return res;
-	f = self->u.meas.offset/hypot(res.x, res.y);
-	res.x *= f;
-	res.y *= f;
-	return res;
-}
-
-
-void project_meas(const struct inst *inst, struct coord *a1, struct coord *b1)
-{
-	const struct meas *meas = &inst->obj->u.meas;
-	struct coord off;
-
-	*a1 = inst->base;
-	*b1 = inst->u.meas.end;
-	switch (meas->type) {
-	case mt_xy_next:
-	case mt_xy_max:
-		break;
-	case mt_x_next:
-	case mt_x_max:
-		b1->y = a1->y;
-		break;
-	case mt_y_next:
-	case mt_y_max:
-		b1->x = a1->x;
-		break;
-	default:
-		abort();
-	}
-	off = offset_vec(*a1, *b1, inst);
-	*a1 = add_vec(*a1, off);
-	*b1 = add_vec(*b1, off);
-}
-
-
 unit_type gui_dist_meas(struct inst *self, struct coord pos, unit_type scale)
 {
 	struct coord a1, b1;
@@ -538,35 +496,6 @@ unit_type gui_dist_meas(struct inst *self, struct coord pos, unit_type scale)
 }
 
 
-char *format_len(const char *label, unit_type len, enum curr_unit unit)
-{
-	const char *u = "";
-	double n;
-	int mm;
-
-	switch (unit) {
-	case curr_unit_mm:
-		n = units_to_mm(len);
-		mm = 1;
-		break;
-	case curr_unit_mil:
-		n = units_to_mil(len);
-		mm = 0;
-		break;
-	case curr_unit_auto:
-		n = units_to_best(len, &mm);
-		u = mm ? "mm" : "mil";
-		break;
-	default:
-		abort();
-	}
-	return stralloc_printf(mm ?
-	    "%s" MM_FORMAT_SHORT "%s" :
-	    "%s" MIL_FORMAT_SHORT "%s",
-	    label, n, u);
-}
-
-
 void gui_draw_meas(struct inst *self)
 {
 	const struct meas *meas = &self->obj->u.meas;
@@ -583,16 +512,16 @@ void gui_draw_meas(struct inst *self)
 	a1 = translate(a1);
 	b1 = translate(b1);
 	gc = gc_meas[get_mode(self)];
-	gdk_draw_line(DA, gc, a0.x, a0.y, a1.x, a1.y);
-	gdk_draw_line(DA, gc, b0.x, b0.y, b1.x, b1.y);
-	gdk_draw_line(DA, gc, a1.x, a1.y, b1.x, b1.y);
+	batch_line(gc, a0.x, a0.y, a1.x, a1.y);
+	batch_line(gc, b0.x, b0.y, b1.x, b1.y);
+	batch_line(gc, a1.x, a1.y, b1.x, b1.y);
 	draw_arrow(gc, FALSE, a1, b1, MEAS_ARROW_LEN, MEAS_ARROW_ANGLE);
 	draw_arrow(gc, FALSE, b1, a1, MEAS_ARROW_LEN, MEAS_ARROW_ANGLE);
 
 	c = add_vec(a1, b1);
 	d = sub_vec(b1, a1);
 	s = format_len(meas->label ? meas->label : "", len, curr_unit);
-	render_text(DA, gc, c.x/2, c.y/2, -atan2(d.y, d.x)/M_PI*180, s,
+	batch_text(gc, c.x/2, c.y/2, -atan2(d.y, d.x)/M_PI*180, s,
 	    MEAS_FONT, 0.5, -MEAS_BASELINE_OFFSET,
 	    dist_point(a1, b1)-1.5*MEAS_ARROW_LEN, 0);
 	free(s);
@@ -659,10 +588,112 @@ void gui_draw_frame(struct inst *self)
 	corner = translate(corner);
 	corner.x -= FRAME_CLEARANCE;
 	corner.y -= FRAME_CLEARANCE;
-	gdk_draw_line(DA, gc, corner.x, corner.y,
+	batch_line(gc, corner.x, corner.y,
 	    corner.x+FRAME_SHORT_X, corner.y);
-	gdk_draw_line(DA, gc, corner.x, corner.y,
+	batch_line(gc, corner.x, corner.y,
 	    corner.x, corner.y+FRAME_SHORT_Y);
-	render_text(DA, gc, corner.x, corner.y, 0, self->u.frame.ref->name,
+	batch_text(gc, corner.x, corner.y, 0, self->u.frame.ref->name,
 	    FRAME_FONT, 0, -FRAME_BASELINE_OFFSET, 0, 0);
 }
+
+
+/* ----- design rule violations -------------------------------------------- */
+
+
+static void highlight_bbox(const struct inst *inst)
+{
+	struct coord min = translate(inst->bbox.min);
+	struct coord max = translate(inst->bbox.max);
+
+	sort_coord(&min, &max);
+	batch_rectangle(gc_drc, FALSE, min.x-DRC_BORDER, min.y-DRC_BORDER,
+	    max.x-min.x+2*DRC_BORDER, max.y-min.y+2*DRC_BORDER);
+}
+
+
+void gui_highlight_drc(const struct drc_violation *v)
+{
+	struct coord a, b;
+
+	highlight_bbox(v->a);
+	highlight_bbox(v->b);
+	a.x = (v->a->bbox.min.x+v->a->bbox.max.x)/2;
+	a.y = (v->a->bbox.min.y+v->a->bbox.max.y)/2;
+	b.x = (v->b->bbox.min.x+v->b->bbox.max.x)/2;
+	b.y = (v->b->bbox.min.y+v->b->bbox.max.y)/2;
+	a = translate(a);
+	b = translate(b);
+	batch_line(gc_drc, a.x, a.y, b.x, b.y);
+}
+
+
+/* ----- batched distances ------------------------------------------------- */
+
+
+static void select_lines(const struct inst_cols *c, unit_type scale,
+    unit_type *d)
+{
+	unit_type r;
+	int i;
+
+	for (i = 0; i != c->n; i++) {
+		r = c->width[i]/scale/2;
+		if (r < SELECT_R)
+			r = SELECT_R;
+		d[i] /= scale;
+		if (d[i] > r)
+			d[i] = -1;
+	}
+}
+
+
+static void select_areas(const struct inst_cols *c, struct coord pos,
+    unit_type scale, unit_type *d)
+{
+	int i;
+
+	for (i = 0; i != c->n; i++) {
+		if (pos.x >= c->ax[i] && pos.x <= c->bx[i] &&
+		    pos.y >= c->ay[i] && pos.y <= c->by[i]) {
+			d[i] = SELECT_R;
+			continue;
+		}
+		d[i] /= scale;
+		if (d[i] > SELECT_R)
+			d[i] = -1;
+	}
+}
+
+
+int gui_dists(const struct inst_cols *c, enum inst_prio prio,
+    struct coord pos, unit_type scale, unit_type *d)
+{
+	int i;
+
+	switch (prio) {
+	case ip_vec:
+		dist_points(pos, c->bx, c->by, c->n, d);
+		for (i = 0; i != c->n; i++) {
+			d[i] /= scale;
+			if (d[i] > VEC_EYE_R)
+				d[i] = -1;
+		}
+		return 1;
+	case ip_line:
+		dist_lines(pos, c->ax, c->ay, c->bx, c->by, c->n, d);
+		select_lines(c, scale, d);
+		return 1;
+	case ip_rect:
+		dist_rects(pos, c->ax, c->ay, c->bx, c->by, c->n, d);
+		select_lines(c, scale, d);
+		return 1;
+	case ip_pad_copper:
+	case ip_pad_special:
+	case ip_hole:
+		dist_rects(pos, c->ax, c->ay, c->bx, c->by, c->n, d);
+		select_areas(c, pos, scale, d);
+		return 1;
+	default:
+		return 0;
+	}
+}
@@ -18,6 +18,7 @@
 
 #include "coord.h"
 #include "inst.h"
+#include "drc.h"
 #include "gui_status.h"
 
 
@@ -37,8 +38,14 @@ unit_type gui_dist_frame(struct inst *self, struct coord pos, unit_type scale);
 unit_type gui_dist_frame_eye(struct inst *self, struct coord pos,
     unit_type scale);
 
-void project_meas(const struct inst *inst, struct coord *a1, struct coord *b1);
-char *format_len(const char *label, unit_type len, enum curr_unit unit);
+/*
+ * gui_dists stores in "d" what the "distance" operations return for all the
+ * instances in "c", which have the priority "prio". It returns 0 if it can't
+ * do this for the priority.
+ */
+
+int gui_dists(const struct inst_cols *c, enum inst_prio prio,
+    struct coord pos, unit_type scale, unit_type *d);
 
 void gui_draw_vec(struct inst *self);
 void gui_draw_line(struct inst *self);
@@ -51,5 +58,6 @@ void gui_draw_meas(struct inst *self);
 void gui_draw_frame(struct inst *self);
 
 void gui_highlight_vec(struct inst *self);
+void gui_highlight_drc(const struct drc_violation *v);
 
 #endif /* !GUI_INST_H */
@@ -15,6 +15,8 @@
 #include "coord.h"
 #include "meas.h"
 #include "inst.h"
+#include "gui_select.h"
+#include "journal.h"
 #include "gui_canvas.h"
 #include "gui_tool.h"
 #include "gui_meas.h"
@@ -420,9 +422,12 @@ void do_move_to_meas(struct inst *inst, struct inst *to, int i)
 
 	switch (i) {
 	case 0:
+		journal_store(&inst->obj->base, sizeof(inst->obj->base));
 		inst->obj->base = inst_get_vec(to);
 		break;
 	case 1:
+		journal_store(&meas->high, sizeof(meas->high));
+		journal_store(&meas->type, sizeof(meas->type));
 		meas->high = inst_get_vec(to);
 		if (is_max(meas_dsc->lt, to))
 			meas->type = (meas->type % 3)+3;
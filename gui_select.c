@@ -0,0 +1,1126 @@
+/*
+ * gui_select.c - GUI, selecting, editing, and drawing instances
+ *
+ * Written 2009-2012 by Werner Almesberger
+ * Copyright 2009-2012 by Werner Almesberger
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "util.h"
+#include "coord.h"
+#include "expr.h"
+#include "obj.h"
+#include "delete.h"
+#include "journal.h"
+#include "hash.h"
+#include "inst.h"
+#include "drc.h"
+#include "gui_util.h"
+#include "gui_batch.h"
+#include "gui_status.h"
+#include "gui_canvas.h"
+#include "gui_tool.h"
+#include "gui_meas.h"
+#include "gui_inst.h"
+#include "gui_frame.h"
+#include "gui.h"
+#include "gui_select.h"
+
+
+struct inst *selected_inst = NULL;
+
+
+/* ----- selective visibility ---------------------------------------------- */
+
+
+static int show(enum inst_prio prio)
+{
+	switch (prio) {
+	case ip_vec:
+	case ip_frame:
+		return show_stuff;
+	case ip_meas:
+		return show_meas;
+	default:
+		return 1;
+	}
+}
+
+
+int bright(const struct inst *inst)
+{
+	if (!show_bright)
+		return 0;
+	return inst->type != it_vec && inst->type != it_frame &&
+	    inst->type != it_meas;
+}
+
+
+static int show_this(const struct inst *inst)
+{
+	if (show_all)
+		return 1;
+	if (inst->type == it_frame && inst->u.frame.ref == active_frame)
+		return 1;
+	if (!inst->outer)
+		return active_frame == frames;
+	return inst->outer->u.frame.ref == active_frame;
+}
+
+
+/* ----- selection of items not on the canvas ------------------------------ */
+
+
+static void *selected_outside = NULL;
+static void (*outside_deselect)(void *item);
+
+
+static void deselect_outside(void)
+{
+	if (selected_outside && outside_deselect)
+		outside_deselect(selected_outside);
+	selected_outside = NULL;
+}
+
+
+void inst_select_outside(void *item, void (*deselect)(void *item))
+{
+	if (item == selected_outside)
+		return;
+	deselect_outside();
+	inst_deselect();
+	selected_outside = item;
+	outside_deselect = deselect;
+}
+
+
+/* ----- check connectedness ----------------------------------------------- */
+
+
+/*
+ * After an instantiation failure, the instances can get out of sync with the
+ * object tree, and attempts to select an item on the canvas can cause accesses
+ * to objects that aren't there anymore. So we need to check if we can still
+ * reach the corresponding object.
+ *
+ * Note: even this isn't bullet-proof. Theoretically, we may get a new object
+ * in the old place. However, this probably doesn't do any serious damage.
+ */
+
+
+static int inst_connected(const struct inst *inst)
+{
+	const struct frame *frame;
+	const struct vec *vec;
+	const struct obj *obj;
+
+	for (frame = frames; frame; frame = frame->next) {
+		if (inst->type == it_vec) {
+			for (vec = frame->vecs; vec; vec = vec->next)
+				if (vec == inst->vec)
+					return 1;
+		} else {
+			for (obj = frame->objs; obj; obj = obj->next)
+				if (obj == inst->obj)
+					return 1;
+		}
+	}
+	return 0;
+}
+
+
+/* ----- selection --------------------------------------------------------- */
+
+
+static void inst_select_inst(struct inst *inst)
+{
+	selected_inst = inst;
+	tool_selected_inst(inst);
+	gui_frame_select_inst(inst);
+	if (inst_ops_of(inst)->select)
+		inst_ops_of(selected_inst)->select(inst);
+	status_set_icon(get_icon_by_inst(inst));
+}
+
+
+/*
+ * @@@ This logic is overly complicated and should be simplified. The general
+ * idea was to avoid making unnecessary changes to the user's selections, but
+ * that risk doesn't exist. Furthermore, the way activate_item is used, its
+ * preconditions aren't met. It works anyway but it could be simpler as a
+ * consequence.
+ *
+ * activate_item tries to activate the path through the frame references,
+ * leading to a specific instance. It returns whether this is failed or whether
+ * it may have been successful.
+ *
+ * The initial condition is that we want to activate an item on a frame
+ * instance that's not active. Since the frame has been instantiated, there
+ * must be a way to activate it. We just have to find out how.
+ *
+ * The first test eliminates the root frame. If we're at the root frame and
+ * still haven't figured out what to do, something is wrong and we give up.
+ *
+ * The next test skips references that are already right. Since we know that
+ * there must be at least one reference that leads elsewhere, and we haven't
+ * found it yet, the recursion will tell us whether it can find it at all.
+ *
+ * Finally, if we've found a mismatch, we correct it. We then try to fix any
+ * further mismatches. Since we've made progress, we return 1, even if the
+ * other fixes should fail (or reach the root frame).
+ *
+ */
+
+static int activate_item(struct inst *inst)
+{
+	if (!inst->outer)
+		return 0;
+	if (inst->outer->u.frame.ref->active_ref == inst->outer->obj)
+		return activate_item(inst->outer);
+	inst->outer->u.frame.ref->active_ref = inst->outer->obj;
+	activate_item(inst->outer);
+	return 1;
+}
+
+
+static void activate_inst_path(const struct inst *inst)
+{
+	for (; inst->outer; inst = inst->outer)
+		if (inst->path)
+			activate_path(inst->outer->u.frame.ref, inst->path);
+}
+
+
+/*
+ * Distances of the instances of one priority in the global package (0) and in
+ * the active package (1), in the order FOR_ALL_INSTS visits them. If gui_dists
+ * can't compute them in one go, we ask each instance.
+ */
+
+static unit_type *dists[2] = { NULL, NULL };
+static int dists_size[2] = { 0, 0 };
+static int have_dists[2];
+
+
+static void begin_dists(enum inst_prio prio, struct coord pos)
+{
+	const struct pkg *pkg;
+	const struct inst_cols *c;
+	int i;
+
+	for (i = 0; i != 2; i++) {
+		pkg = i ? active_pkg : pkgs;
+		have_dists[i] = 0;
+		if (!pkg)
+			continue;
+		c = pkg->cols+prio;
+		if (c->n > dists_size[i]) {
+			dists_size[i] = c->n;
+			dists[i] = realloc(dists[i], sizeof(unit_type)*c->n);
+			if (!dists[i])
+				abort();
+		}
+		have_dists[i] =
+		    gui_dists(c, prio, pos, draw_ctx.scale, dists[i]);
+	}
+}
+
+
+/*
+ * "n" counts the instances FOR_ALL_INSTS has visited in package "i", including
+ * those the caller skipped.
+ */
+
+static unit_type inst_dist(struct inst *inst, int i, int n, struct coord pos)
+{
+	if (have_dists[i])
+		return dists[i][n];
+	return inst_ops_of(inst)->distance(inst, pos, draw_ctx.scale);
+}
+
+
+static int __inst_select(struct coord pos, int tries)
+{
+	enum inst_prio prio;
+	const struct inst *prev;
+	struct inst *inst;
+	struct inst *first = NULL;	/* first active item */
+	struct inst *next = NULL;	/* active item after currently sel. */
+	struct inst *any_first = NULL;	/* first item, active or inactive */
+	struct inst *any_same_frame = NULL; /* first item on active frame */
+	struct frame *frame;
+	int best_dist = 0; /* keep gcc happy */
+	int select_next;
+	int dist, i, j;
+	int n[2];
+
+	if (!tries) {
+		fprintf(stderr, "__inst_select: tries exhausted\n");
+		return 0;
+	}
+	prev = selected_inst;
+	deselect_outside();
+	edit_nothing();
+	if (selected_inst) {
+		gui_frame_deselect_inst(selected_inst);
+		tool_selected_inst(NULL);
+	}
+	inst_deselect();
+	select_next = 0;
+	FOR_INST_PRIOS_DOWN(prio) {
+		if (!show(prio))
+			continue;
+		begin_dists(prio, pos);
+		n[0] = n[1] = 0;
+		FOR_ALL_INSTS(i, prio, inst) {
+			j = n[i]++;
+			if (!show_this(inst))
+				continue;
+			if (!inst_ops_of(inst)->distance)
+				continue;
+			if (!inst_connected(inst))
+				continue;
+			dist = inst_dist(inst, i, j, pos);
+			if (dist >= 0) {
+				if (!any_first)
+					any_first = inst;
+				if (!any_same_frame && inst->outer &&
+				    inst->outer->u.frame.ref == active_frame)
+					any_same_frame = inst;
+				if (!inst->active)
+					continue;
+				if (!first)
+					first = inst;
+				if (!next && select_next)
+					next = inst;
+				if (inst == prev)
+					select_next = 1;
+				if (!selected_inst || best_dist > dist) {
+					selected_inst = inst;
+					best_dist = dist;
+				}
+			}
+		}
+	}
+	if (select_next) {
+		selected_inst = next ? next : first;
+		goto selected;
+	}
+	if (selected_inst)
+		goto selected;
+
+	/* give vectors a second chance */
+
+	if (show_stuff) {
+		FOR_ALL_INSTS(i, ip_vec, inst) {
+			if (!inst->active)
+				continue;
+			if (!inst_connected(inst))
+				continue;
+			dist = gui_dist_vec_fallback(inst, pos, draw_ctx.scale);
+			if (dist >= 0 && (!selected_inst || best_dist > dist)) {
+				selected_inst = inst;
+				best_dist = dist;
+			}
+		}
+
+		if (selected_inst)
+			goto selected;
+	}
+
+	if (!show_all)
+		return 0;
+
+	if (any_same_frame) {
+		activate_item(any_same_frame);
+		activate_inst_path(any_same_frame);
+		change_world();
+		return __inst_select(pos, tries-1);
+	}
+	if (any_first) {
+		frame = any_first->outer ? any_first->outer->u.frame.ref : NULL;
+		if (frame != active_frame) {
+			select_frame(frame);
+			return __inst_select(pos, tries-1);
+		}
+	}
+
+	return 0;
+
+selected:
+	inst_select_inst(selected_inst);
+	return 1;
+}
+
+
+int inst_select(struct coord pos)
+{
+	/*
+	 * We shouldn't need more than 2 tries to select any item, so 5 is more
+	 * than enough. This can still fail, but then it would for any number
+	 * of tries.
+	 */
+	return __inst_select(pos, 5);
+}
+
+
+struct inst *inst_find_point(struct coord pos)
+{
+	struct inst *inst, *found;
+	int best_dist = 0; /* keep gcc happy */
+	int dist, i, j;
+	int n[2] = { 0, 0 };
+
+	found = NULL;
+	FOR_ALL_INSTS(i, ip_frame, inst) {
+		if (!inst->u.frame.active)
+			continue;
+		dist = gui_dist_frame_eye(inst, pos, draw_ctx.scale);
+		if (dist >= 0 && (!found || best_dist > dist)) {
+			found = inst;
+			best_dist = dist;
+		}
+	}
+	if (found)
+		return found;
+
+	begin_dists(ip_vec, pos);
+	FOR_ALL_INSTS(i, ip_vec, inst) {
+		j = n[i]++;
+		if (!inst->active || !inst_ops_of(inst)->distance)
+			continue;
+		dist = inst_dist(inst, i, j, pos);
+		if (dist >= 0 && (!found || best_dist > dist)) {
+			found = inst;
+			best_dist = dist;
+		}
+	}
+	return found;
+}
+
+
+int inst_find_point_selected(struct coord pos, struct inst **res)
+{
+	struct vec **anchors[3];
+	int n, best_i, i;
+	struct inst *best = NULL;
+	struct inst *inst;
+	int d_min, d, j;
+
+	assert(selected_inst);
+	n = inst_anchors(selected_inst, anchors);
+	for (i = 0; i != n; i++) {
+		if (*anchors[i]) {
+			FOR_ALL_INSTS(j, ip_vec, inst) {
+				if (inst->vec != *anchors[i])
+					continue;
+				d = gui_dist_vec(inst, pos, draw_ctx.scale);
+				if (d != -1 && (!best || d < d_min)) {
+					best = inst;
+					best_i = i;
+					d_min = d;
+				}
+			}
+		} else {
+			FOR_ALL_INSTS(j, ip_frame, inst) {
+				if (inst != selected_inst->outer)
+					continue;
+				d = gui_dist_frame(inst, pos, draw_ctx.scale);
+				if (d != -1 && (!best || d < d_min)) {
+					best = inst;
+					best_i = i;
+					d_min = d;
+				}
+			}
+		}
+	}
+	if (!best)
+		return -1;
+	if (res)
+		*res = best;
+	return best_i;
+}
+
+
+struct coord inst_get_point(const struct inst *inst)
+{
+	if (inst->type == it_vec)
+		return inst->u.vec.end;
+	if (inst->type == it_frame)
+		return inst->base;
+	abort();
+}
+
+
+struct vec *inst_get_vec(const struct inst *inst)
+{
+	if (inst->type == it_vec)
+		return inst->vec;
+	if (inst->type == it_frame)
+		return NULL;
+	abort();
+}
+
+
+int inst_anchors(struct inst *inst, struct vec ***anchors)
+{
+	if (inst->vec) {
+		anchors[0] = &inst->vec->base;
+		return 1;
+	}
+	return obj_anchors(inst->obj, anchors);
+}
+
+
+void inst_deselect(void)
+{
+	if (selected_inst) {
+		tool_selected_inst(NULL);
+		gui_frame_deselect_inst(selected_inst);
+	}
+	deselect_outside();
+	status_set_type_x(NULL, "");
+	status_set_type_y(NULL, "");
+	status_set_type_entry(NULL, "");
+	status_set_name(NULL, "");
+	status_set_x(NULL, "");
+	status_set_y(NULL, "");
+	status_set_r(NULL, "");
+	status_set_angle(NULL, "");
+	selected_inst = NULL;
+	edit_nothing();
+	refresh_pos();
+	status_set_icon(NULL);
+}
+
+
+/* ----- select instance by vector/object ---------------------------------- */
+
+
+static void vec_edit(struct vec *vec);
+static void obj_edit(struct obj *obj);
+
+
+void inst_select_vec(struct vec *vec)
+{
+	struct inst *inst;
+	int i;
+
+	if (vec->frame != active_frame)
+		select_frame(vec->frame);
+	for (i = 0; i != 2; i++) {
+		inst = inst_lookup(i ? active_pkg : pkgs, vec, ip_vec, 1);
+		if (inst) {
+			inst_deselect();
+			inst_select_inst(inst);
+			return;
+		}
+	}
+	vec_edit(vec);
+}
+
+
+void inst_select_obj(struct obj *obj)
+{
+	enum inst_prio prio;
+	struct inst *inst;
+	int i;
+
+	if (obj->frame != active_frame)
+		select_frame(obj->frame);
+	FOR_INST_PRIOS_DOWN(prio)
+		for (i = 0; i != 2; i++) {
+			inst = inst_lookup(i ? active_pkg : pkgs, obj, prio, 1);
+			if (inst)
+				goto found;
+		}
+	obj_edit(obj);
+	return;
+
+found:
+	inst_deselect();
+	inst_select_inst(inst);
+}
+
+
+/* ----- common status reporting ------------------------------------------- */
+
+
+static void rect_status(struct coord a, struct coord b, unit_type width,
+    int rounded)
+{
+	const char *tip;
+	struct coord d = sub_vec(b, a);
+	double r;
+	unit_type diag;
+
+	status_set_xy(d);
+	tip = "Angle of diagonal";
+	if (!d.x && !d.y) {
+		status_set_angle(tip, "a = 0 deg");
+	} else {
+		status_set_angle(tip, "a = %3.1f deg", theta(a, b));
+	}
+	if (d.x < 0)
+		d.x = -d.x;
+	if (d.y < 0)
+		d.y = -d.y;
+	diag = hypot(d.x, d.y);
+	if (rounded) {
+		/*
+		 * Only consider the part of the diagonal that is on the pad
+		 * surface.
+		 *
+		 * The circle: (x-r)^2+(y-r)^2 = r^2
+		 * The diagonal: x = t*cos(theta), y = t*sin(theta)
+		 *
+		 * t is the distance from the corner of the surrounding
+		 * rectangle to the half-circle:
+		 *
+		 * t = 2*r*(s+c-sqrt(2*s*c))
+		 *
+		 * With s = sin(theta) and c = cos(theta).
+		 *
+		 * Since d.x = diag*cos(theta), we don't need to calculate the
+		 * sinus and cosinus but can use d.x and d.y directly.
+		 */
+		r = (d.x > d.y ? d.y : d.x)/2;
+		diag -= 2*r*(d.x+d.y-sqrt(2*d.x*d.y))/diag;
+	}
+	set_with_units(status_set_r, "d = ", diag, "Length of diagonal");
+	if (width != -1) {
+		status_set_type_entry(NULL, "width =");
+		set_with_units(status_set_name, "", width, "Line width");
+	}
+}
+
+
+static void rect_status_sort(struct coord a, struct coord b, unit_type width,
+    int rounded)
+{
+	sort_coord(&a, &b);
+	rect_status(a, b, width, rounded);
+}
+
+
+/* ----- vec --------------------------------------------------------------- */
+
+
+static int validate_vec_name(const char *s, void *ctx)
+{
+	struct vec *vec = ctx;
+	const struct vec *walk;
+
+	if (!is_id(s))
+		return 0;
+	for (walk = vec->frame->vecs; walk; walk = walk->next)
+		if (walk->name && !strcmp(walk->name, s))
+			return 0;
+	return 1;
+}
+
+
+static void vec_edit(struct vec *vec)
+{
+	edit_x(&vec->x, "X distance");
+	edit_y(&vec->y, "Y distance");
+	edit_unique_null(&vec->name, validate_vec_name, vec, "Vector name");
+}
+
+
+static void vec_op_select(struct inst *self)
+{
+	status_set_type_entry(NULL, "ref =");
+	status_set_name("Vector reference (name)",
+	    "%s", self->vec->name ? self->vec->name : "");
+	rect_status(self->base, self->u.vec.end, -1, 0);
+	vec_edit(self->vec);
+}
+
+
+/*
+ * @@@ The logic of gui_find_point_vec isn't great. Instead of selecting a
+ * point and then filtering, we should filter the candidates, so that a point
+ * that's close end eligible can win against one that's closer but not
+ * eligible.
+ */
+
+static struct inst *find_point_vec(struct inst *self, struct coord pos)
+{
+	struct inst *inst;
+	const struct vec *vec;
+
+	inst = inst_find_point(pos);
+	if (!inst)
+		return NULL;
+	if (inst->type == it_frame)
+		return inst;
+	for (vec = inst->vec; vec; vec = vec->base)
+		if (vec == self->vec)
+		return NULL;
+	return inst;
+}
+
+
+/*
+ * When instantiating and when dumping, we assume that bases appear in the
+ * frame->vecs list before vectors using them. A move may change this order.
+ * We therefore have to sort the list after the move.
+ *
+ * Since the list is already ordered, cleaning it up is just O(n).
+ */
+
+
+static unsigned hash_vec(const void *item)
+{
+	return hash_bytes(HASH_INIT, &item, sizeof(item));
+}
+
+
+static int eq_vec(const void *a, const void *b)
+{
+	return a == b;
+}
+
+
+static void do_move_to_vec(struct inst *inst, struct inst *to, int i)
+{
+	struct vec *to_vec = inst_get_vec(to);
+	struct vec *vec = inst->vec;
+	struct frame *frame = vec->frame;
+	struct vec *v, **anchor, **walk;
+	struct hash *marked;
+
+	assert(!i);
+	journal_store(&vec->base, sizeof(vec->base));
+	vec->base = to_vec;
+
+	/*
+	 * Mark the vector that's being rebased and all vectors that
+	 * (recursively) depend on it.
+	 *
+	 * We're mainly interested in the range between the vector being moved
+	 * and the new base. If the vector follows the base, the list is
+	 * already in the correct order and nothing needs moving.
+	 */
+	marked = hash_new(hash_vec, eq_vec);
+	hash_add(marked, vec);
+	for (v = vec->next; v && v != to_vec; v = v->next)
+		if (v->base && hash_lookup(marked, v->base))
+			hash_add(marked, v);
+	if (!v) {
+		hash_free(marked, NULL);
+		return;
+	}
+
+	/*
+	 * All the marked vectors appearing on the list before the new base
+	 * are moved after the new base, preserving their order.
+	 *
+	 * Start at frame->vecs, not "vec", so that we move the the vector
+	 * being rebased as well.
+	 */
+	anchor = &to_vec->next;
+	walk = &frame->vecs;
+	while (*walk != to_vec) {
+		v = *walk;
+		if (!hash_lookup(marked, v)) {
+			walk = &v->next;
+		} else {
+			journal_store(walk, sizeof(*walk));
+			*walk = v->next;
+			journal_store(&v->next, sizeof(v->next));
+			v->next = *anchor;
+			journal_store(anchor, sizeof(*anchor));
+			*anchor = v;
+			anchor = &v->next;
+		}
+	}
+	hash_free(marked, NULL);
+}
+
+
+static const struct inst_ops vec_ops = {
+	.draw		= gui_draw_vec,
+	.hover		= gui_hover_vec,
+	.distance	= gui_dist_vec,
+	.select		= vec_op_select,
+	.find_point	= find_point_vec,
+	.draw_move	= draw_move_vec,
+	.do_move_to	= do_move_to_vec,
+};
+
+
+/* ----- line -------------------------------------------------------------- */
+
+
+static void obj_line_edit(struct obj *obj)
+{
+	edit_dist_expr(&obj->u.line.width, "Line width");
+}
+
+
+static void line_op_select(struct inst *self)
+{
+	rect_status_sort(self->base, self->u.rect.end, self->u.rect.width, 0);
+	obj_line_edit(self->obj);
+}
+
+
+static const struct inst_ops line_ops = {
+	.draw		= gui_draw_line,
+	.distance	= gui_dist_line,
+	.select		= line_op_select,
+	.draw_move	= draw_move_line,
+};
+
+
+/* ----- rect -------------------------------------------------------------- */
+
+
+static void obj_rect_edit(struct obj *obj)
+{
+	edit_dist_expr(&obj->u.rect.width, "Line width");
+}
+
+
+static void rect_op_select(struct inst *self)
+{
+	rect_status_sort(self->base, self->u.rect.end, self->u.rect.width, 0);
+	obj_rect_edit(self->obj);
+}
+
+
+static const struct inst_ops rect_ops = {
+	.draw		= gui_draw_rect,
+	.distance	= gui_dist_rect,
+	.select		= rect_op_select,
+	.draw_move	= draw_move_rect,
+};
+
+
+/* ----- pad / rpad -------------------------------------------------------- */
+
+
+static int validate_pad_name(const char *s, void *ctx)
+{
+	char *tmp;
+
+	status_begin_reporting();
+	tmp = expand(s, NULL);
+	if (!tmp)
+		return 0;
+	free(tmp);
+	return 1;
+}
+
+
+static void obj_pad_edit(struct obj *obj)
+{
+	edit_pad_type(&obj->u.pad.type);
+	edit_name(&obj->u.pad.name, validate_pad_name, NULL,
+	    "Pad name (template)");
+}
+
+
+static void pad_op_select(struct inst *self)
+{
+	status_set_type_entry(NULL, "label =");
+	status_set_name("Pad name (actual)", "%s", self->u.pad.name);
+	rect_status_sort(self->base, self->u.pad.other, -1, 0);
+	obj_pad_edit(self->obj);
+}
+
+
+static const struct inst_ops pad_ops = {
+	.draw		= gui_draw_pad,
+	.distance	= gui_dist_pad,
+	.select		= pad_op_select,
+	.draw_move	= draw_move_pad,
+};
+
+
+static void rpad_op_select(struct inst *self)
+{
+	status_set_type_entry(NULL, "label =");
+	status_set_name("Pad name (actual)", "%s", self->u.pad.name);
+	rect_status_sort(self->base, self->u.pad.other, -1, 1);
+	obj_pad_edit(self->obj);
+}
+
+
+static const struct inst_ops rpad_ops = {
+	.draw		= gui_draw_rpad,
+	.distance	= gui_dist_pad, /* @@@ */
+	.select		= rpad_op_select,
+	.draw_move	= draw_move_rpad,
+};
+
+
+/* ----- hole -------------------------------------------------------------- */
+
+
+static void hole_op_select(struct inst *self)
+{
+	rect_status_sort(self->base, self->u.hole.other, -1, 1);
+}
+
+
+static const struct inst_ops hole_ops = {
+	.draw		= gui_draw_hole,
+	.distance	= gui_dist_hole,
+	.select		= hole_op_select,
+	.draw_move	= draw_move_hole,
+};
+
+
+/* ----- arc --------------------------------------------------------------- */
+
+
+static void obj_arc_edit(struct obj *obj)
+{
+	edit_dist_expr(&obj->u.arc.width, "Line width");
+}
+
+
+static void arc_op_select(struct inst *self)
+{
+	status_set_xy(self->base);
+	status_set_angle("Angle", "a = %3.1f deg",
+	    self->u.arc.a1 == self->u.arc.a2 ? 360 :
+	    self->u.arc.a2-self->u.arc.a1);
+	set_with_units(status_set_r, "r = ", self->u.arc.r, "Radius");
+	status_set_type_entry(NULL, "width =");
+	set_with_units(status_set_name, "", self->u.arc.width, "Line width");
+	obj_arc_edit(self->obj);
+}
+
+
+static const struct inst_ops arc_ops = {
+	.draw		= gui_draw_arc,
+	.distance	= gui_dist_arc,
+	.select		= arc_op_select,
+	.draw_move	= draw_move_arc,
+	.do_move_to	= do_move_to_arc,
+};
+
+
+/* ----- measurement ------------------------------------------------------- */
+
+
+static void obj_meas_edit(struct obj *obj)
+{
+	edit_dist_expr(&obj->u.meas.offset, "Measurement line offset");
+}
+
+
+static void meas_op_select(struct inst *self)
+{
+	rect_status_sort(self->base, self->u.meas.end, -1, 0);
+	status_set_type_entry(NULL, "offset =");
+	set_with_units(status_set_name, "", self->u.meas.offset,
+	    "Measurement line offset");
+	obj_meas_edit(self->obj);
+}
+
+
+static const struct inst_ops meas_ops = {
+	.draw		= gui_draw_meas,
+	.distance	= gui_dist_meas,
+	.select		= meas_op_select,
+	.begin_drag_move= begin_drag_move_meas,
+	.find_point	= find_point_meas_move,
+	.draw_move	= draw_move_meas,
+	.end_drag_move	= end_drag_move_meas,
+	.do_move_to	= do_move_to_meas,
+};
+
+
+/* ----- direct editing of objects ----------------------------------------- */
+
+
+static void obj_edit(struct obj *obj)
+{
+	switch (obj->type) {
+	case ot_frame:
+		break;
+	case ot_line:
+		obj_line_edit(obj);
+		break;
+	case ot_rect:
+		obj_rect_edit(obj);
+		break;
+	case ot_arc:
+		obj_arc_edit(obj);
+		break;
+	case ot_pad:
+		obj_pad_edit(obj);
+		break;
+	case ot_meas:
+		obj_meas_edit(obj);
+		break;
+	default:
+		abort();
+	}
+}
+
+
+/* ----- frame ------------------------------------------------------------- */
+
+
+static void frame_op_select(struct inst *self)
+{
+	rect_status(self->bbox.min, self->bbox.max, -1, 0);
+	status_set_type_entry(NULL, "name =");
+	status_set_name("Frame name", "%s", self->u.frame.ref->name);
+}
+
+
+static const struct inst_ops frame_ops = {
+	.draw		= gui_draw_frame,
+	.hover		= gui_hover_frame,
+	.distance	= gui_dist_frame,
+	.select		= frame_op_select,
+	.draw_move	= draw_move_frame,
+};
+
+
+/* ----- operations by instance type --------------------------------------- */
+
+
+const struct inst_ops *const inst_type_ops[it_n] = {
+	[it_vec]	= &vec_ops,
+	[it_line]	= &line_ops,
+	[it_rect]	= &rect_ops,
+	[it_pad]	= &pad_ops,
+	[it_rpad]	= &rpad_ops,
+	[it_hole]	= &hole_ops,
+	[it_arc]	= &arc_ops,
+	[it_meas]	= &meas_ops,
+	[it_frame]	= &frame_ops,
+};
+
+
+/* ----- drawing and dragging ---------------------------------------------- */
+
+
+void inst_draw(void)
+{
+	enum inst_prio prio;
+	struct inst *inst;
+	int i;
+
+	FOR_INST_PRIOS_UP(prio) {
+		FOR_ALL_INSTS(i, prio, inst)
+			if (show_this(inst))
+				if (show(prio) && !inst->active &&
+				    inst_ops_of(inst)->draw)
+					inst_ops_of(inst)->draw(inst);
+		batch_flush();
+	}
+	FOR_INST_PRIOS_UP(prio) {
+		FOR_ALL_INSTS(i, prio, inst)
+			if (show(prio) && prio != ip_frame && inst->active &&
+			    inst != selected_inst && inst_ops_of(inst)->draw)
+				inst_ops_of(inst)->draw(inst);
+		batch_flush();
+	}
+	if (show_stuff)
+		FOR_ALL_INSTS(i, ip_frame, inst)
+			if (inst->active && inst != selected_inst &&
+			    inst_ops_of(inst)->draw)
+				inst_ops_of(inst)->draw(inst);
+	if (active_pkg)
+		for (i = 0; i != active_pkg->n_drc; i++)
+			gui_highlight_drc(active_pkg->drc+i);
+	batch_flush();
+	if (selected_inst && inst_ops_of(selected_inst)->draw)
+		inst_ops_of(selected_inst)->draw(selected_inst);
+}
+
+
+void inst_highlight_vecs(int (*pick)(struct inst *inst, void *user), void *user)
+{
+	struct inst *inst;
+	int i;
+
+	FOR_ALL_INSTS(i, ip_vec, inst) {
+		inst->u.vec.highlighted = pick(inst, user);
+		if (inst->u.vec.highlighted)
+			gui_highlight_vec(inst);
+	}
+}
+
+
+struct inst *inst_find_vec(struct coord pos,
+    int (*pick)(struct inst *inst, void *user), void *user)
+{
+	struct inst *inst, *found;
+	int best_dist = 0; /* keep gcc happy */
+	int dist, i, j;
+	int n[2] = { 0, 0 };
+
+	found = NULL;
+	begin_dists(ip_vec, pos);
+	FOR_ALL_INSTS(i, ip_vec, inst) {
+		j = n[i]++;
+		if (!inst_ops_of(inst)->distance)
+			continue;
+		dist = inst_dist(inst, i, j, pos);
+		if (dist < 0 || (found && best_dist <= dist))
+			continue;
+		if (!pick(inst, user))
+			continue;
+		found = inst;
+		best_dist = dist;
+	}
+	return found;
+}
+
+
+struct pix_buf *inst_draw_move(struct inst *inst, struct coord pos, int i)
+{
+	return inst_ops_of(inst)->draw_move(inst, pos, i);
+}
+
+
+int inst_do_move_to(struct inst *inst, struct inst *to, int i)
+{
+	if (!inst_ops_of(inst)->do_move_to)
+		return 0;
+	inst_ops_of(inst)->do_move_to(inst, to, i);
+	return 1;
+}
+
+
+struct pix_buf *inst_hover(struct inst *inst)
+{
+	if (!inst_ops_of(inst)->hover)
+		return NULL;
+	return inst_ops_of(inst)->hover(inst);
+}
+
+
+void inst_begin_drag_move(struct inst *inst, int i)
+{
+	if (inst_ops_of(inst)->begin_drag_move)
+		inst_ops_of(inst)->begin_drag_move(inst, i);
+}
+
+
+void inst_delete(struct inst *inst)
+{
+	if (inst->type == it_vec)
+		delete_vec(inst->vec);
+	else
+		delete_obj(inst->obj);
+}
@@ -0,0 +1,83 @@
+/*
+ * gui_select.h - GUI, selecting, editing, and drawing instances
+ *
+ * Written 2009-2012 by Werner Almesberger
+ * Copyright 2009-2012 by Werner Almesberger
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef GUI_SELECT_H
+#define GUI_SELECT_H
+
+#include "coord.h"
+#include "obj.h"
+#include "inst.h"
+
+
+struct pix_buf;
+
+struct inst_ops {
+	void (*draw)(struct inst *self);
+	struct pix_buf *(*hover)(struct inst *self);
+	unit_type (*distance)(struct inst *self, struct coord pos,
+	    unit_type scale);
+	void (*select)(struct inst *self);
+	void (*begin_drag_move)(struct inst *from, int i);
+	struct inst *(*find_point)(struct inst *self, struct coord pos);
+	struct pix_buf *(*draw_move)(struct inst *inst,
+	    struct coord pos, int i);
+	void (*end_drag_move)(void);
+	/* arcs and measurements need this special override */
+	void (*do_move_to)(struct inst *inst, struct inst *to, int i);
+};
+
+
+/*
+ * The instances only record their type, so that they can be created without
+ * the GUI. The GUI operations of each type are in this table.
+ */
+
+extern const struct inst_ops *const inst_type_ops[it_n];
+
+extern struct inst *selected_inst;
+
+
+static inline const struct inst_ops *inst_ops_of(const struct inst *inst)
+{
+	return inst_type_ops[inst->type];
+}
+
+
+int bright(const struct inst *inst);
+
+void inst_select_outside(void *item, void (*deselect)(void *item));
+int inst_select(struct coord pos);
+void inst_deselect(void);
+
+void inst_select_vec(struct vec *vec);
+void inst_select_obj(struct obj *obj);
+
+struct inst *inst_find_point(struct coord pos);
+int inst_find_point_selected(struct coord pos, struct inst **res);
+struct coord inst_get_point(const struct inst *inst);
+int inst_anchors(struct inst *inst, struct vec ***anchors);
+struct vec *inst_get_vec(const struct inst *inst);
+
+void inst_draw(void);
+void inst_highlight_vecs(int (*pick)(struct inst *inst, void *user),
+     void *user);
+struct inst *inst_find_vec(struct coord pos,
+    int (*pick)(struct inst *inst, void *user), void *user);
+
+struct pix_buf *inst_draw_move(struct inst *inst, struct coord pos, int i);
+int inst_do_move_to(struct inst *inst, struct inst *to, int i);
+struct pix_buf *inst_hover(struct inst *inst);
+void inst_begin_drag_move(struct inst *inst, int i);
+void inst_delete(struct inst *inst);
+
+#endif /* !GUI_SELECT_H */
@@ -24,7 +24,10 @@
 #include "error.h"
 #include "unparse.h"
 #include "obj.h"
+#include "delete.h"
+#include "journal.h"
 #include "layer.h"
+#include "gui_select.h"
 #include "gui_util.h"
 #include "gui_style.h"
 #include "gui_canvas.h"
@@ -47,9 +50,6 @@ struct edit_ops {
 };
 
 
-enum curr_unit curr_unit = curr_unit_mm;
-
-
 static GtkWidget *open_edits = NULL;
 static GtkWidget *last_edit = NULL;
 
@@ -205,6 +205,7 @@ static gboolean pad_type_button_press_event(GtkWidget *widget,
 {
 	switch (event->button) {
 	case 1:
+		journal_store(curr_pad_type, sizeof(*curr_pad_type));
 		*curr_pad_type = (*curr_pad_type+1) % pt_n;
 		show_pad_type();
 		break;
@@ -346,6 +347,7 @@ static void unique_store(const char *s, void *ctx)
 {
 	const struct edit_unique_ctx *unique_ctx = ctx;
 
+	journal_store(unique_ctx->s, sizeof(*unique_ctx->s));
 	*unique_ctx->s = unique(s);
 }
 
@@ -389,6 +391,7 @@ static void unique_null_store(const char *s, void *ctx)
 {
 	const struct edit_unique_ctx *unique_ctx = ctx;
 
+	journal_store(unique_ctx->s, sizeof(*unique_ctx->s));
 	if (!*s)
 		*unique_ctx->s = NULL;
 	else
@@ -463,6 +466,7 @@ static void unique_with_values_store(const char *s, void *ctx)
 	int n;
 
 	status_begin_reporting();
+	journal_store(unique_ctx->s, sizeof(*unique_ctx->s));
 	n = parse_var(s, unique_ctx->s, &values, unique_ctx->max_values);
 	if (!n)
 		return;
@@ -524,14 +528,18 @@ static int attempt_var_type_change(struct var *var)
 {
 	const struct edit_unique_with_values_ctx *ctx;
 	const char *s;
+	int ok;
 
 	ctx = gtk_object_get_data(GTK_OBJECT(status_entry), "edit-ctx");
 	s = gtk_entry_get_text(GTK_ENTRY(status_entry));
 	var->key = !var->key;
-	if (unique_with_values_check(s, ctx))
-		return 1;
+	ok = unique_with_values_check(s, ctx);
+	var->key = !var->key;
+	if (!ok)
+		return 0;
+	journal_store(&var->key, sizeof(var->key));
 	var->key = !var->key;
-	return 0;
+	return 1;
 }
 
 
@@ -602,8 +610,7 @@ static void name_store(const char *s, void *ctx)
 {
 	const struct edit_name_ctx *name_ctx = ctx;
 
-	free(*name_ctx->s);
-	*name_ctx->s = stralloc(s);
+	journal_replace(name_ctx->s, stralloc(s), free, free);
 }
 
 
@@ -663,9 +670,7 @@ static void expr_store(const char *s, void *ctx)
 
 	expr = try_parse_expr(s);
 	assert(expr);
-	if (*anchor)
-		free_expr(*anchor);
-	*anchor = expr;
+	journal_replace(anchor, expr, discard_expr, discard_expr);
 }
 
 
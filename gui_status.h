@@ -19,17 +19,7 @@
 #include "coord.h"
 #include "expr.h"
 #include "obj.h"
-
-
-enum curr_unit {
-	curr_unit_mm,
-	curr_unit_mil,
-	curr_unit_auto,
-	curr_unit_n
-};
-
-
-extern enum curr_unit curr_unit;
+#include "meas.h"
 
 
 void edit_var_type(struct var *var);
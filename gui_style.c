@@ -22,6 +22,7 @@
 GdkGC *gc_bg, *gc_bg_error;
 GdkGC *gc_drag;
 GdkGC *gc_highlight;
+GdkGC *gc_drc;
 GdkGC *gc_active_frame;
 GdkGC *gc_vec[mode_n];
 GdkGC *gc_obj[mode_n];
@@ -81,6 +82,7 @@ void gui_setup_style(GdkDrawable *drawable)
 	gc_active_frame = gc("#00ff00", 2);
 //	gc_highlight = gc("#ff8020", 2);
 	gc_highlight = gc("#ff90d0", 2);
+	gc_drc = gc("#ff8020", 2);
 	gc_frame[mode_hover] = gc_vec[mode_hover] = gc("#c00000", 2);
 
 	item_list_font = pango_font_description_from_string(ITEM_LIST_FONT);
@@ -34,6 +34,8 @@
 #define	PAD_FONT		"Sans Bold 24"
 #define	PAD_BORDER		2
 
+#define	DRC_BORDER		4	/* around items violating a rule */
+
 #define	MEAS_FONT		"Sans 8"
 #define	MEAS_BASELINE_OFFSET	0.1
 #define	MEAS_ARROW_LEN		9
@@ -58,8 +60,6 @@
 
 #define	MM_FORMAT_FIXED		"%8.3f"	/* -NNN.NNN */
 #define	MIL_FORMAT_FIXED	"%7.1f"	/* -NNNN.N */
-#define	MM_FORMAT_SHORT		"%.4g"
-#define	MIL_FORMAT_SHORT	"%.4g"
 
 #define	DEFAULT_FRAME_AREA_WIDTH 250
 #define	DEFAULT_FRAME_AREA_HEIGHT 100
@@ -109,6 +109,7 @@
 extern GdkGC *gc_bg, *gc_bg_error;
 extern GdkGC *gc_drag;
 extern GdkGC *gc_highlight;
+extern GdkGC *gc_drc;
 extern GdkGC *gc_active_frame;
 extern GdkGC *gc_vec[mode_n];
 extern GdkGC *gc_obj[mode_n];
@@ -18,8 +18,11 @@
 
 #include "util.h"
 #include "inst.h"
+#include "gui_select.h"
 #include "meas.h"
 #include "obj.h"
+#include "delete.h"
+#include "journal.h"
 #include "gui_util.h"
 #include "gui_style.h"
 #include "gui_inst.h"
@@ -79,7 +82,7 @@ static struct vec *new_vec(struct inst *base)
 	vec->next = NULL;
 	vec->frame = active_frame;
 	for (walk = &active_frame->vecs; *walk; walk = &(*walk)->next);
-	*walk = vec;
+	journal_replace(walk, vec, NULL, discard_vec);
 	return vec;
 }
 
@@ -99,16 +102,6 @@ struct obj *new_obj_unconnected(enum obj_type type, struct inst *base)
 }
 
 
-void connect_obj(struct frame *frame, struct obj *obj)
-{
-	struct obj **walk;
-
-	obj->frame = frame;
-	for (walk = &frame->objs; *walk; walk = &(*walk)->next);
-	*walk = obj;
-}
-
-
 static struct obj *new_obj(enum obj_type type, struct inst *base)
 {
 	struct obj *obj;
@@ -581,12 +574,15 @@ void do_move_to_arc(struct inst *inst, struct inst *to, int i)
 
 	switch (i) {
 	case 0:
+		journal_store(&obj->base, sizeof(obj->base));
 		obj->base = vec;
 		break;
 	case 2:
+		journal_store(&obj->u.arc.start, sizeof(obj->u.arc.start));
 		obj->u.arc.start = vec;
 		break;
 	case 1:
+		journal_store(&obj->u.arc.end, sizeof(obj->u.arc.end));
 		obj->u.arc.end = vec;
 		break;
 	default:
@@ -601,23 +597,6 @@ static struct tool_ops circ_ops = {
 };
 
 
-/* ----- frame helper ------------------------------------------------------ */
-
-
-int is_parent_of(const struct frame *p, const struct frame *c)
-{
-	const struct obj *obj;
-
-	if (p == c)
-		return 1;
-	for (obj = p->objs; obj; obj = obj->next)
-		if (obj->type == ot_frame)
-			if (is_parent_of(obj->u.frame.ref, c))
-				return 1;
-	return 0;
-}
-
-
 /* ----- frame ------------------------------------------------------------- */
 
 
@@ -652,8 +631,11 @@ static int end_new_frame(struct inst *from, struct inst *to)
 	obj = new_obj(ot_frame, from);
 	obj->u.frame.ref = locked_frame;
 	obj->u.frame.lineno = 0;
-	if (!locked_frame->active_ref)
+	if (!locked_frame->active_ref) {
+		journal_store(&locked_frame->active_ref,
+		    sizeof(locked_frame->active_ref));
 		locked_frame->active_ref = obj;
+	}
 	locked_frame = NULL;
 	tool_reset();
 	return 1;
@@ -723,8 +705,11 @@ static int may_move_to(const struct drag_state *state, struct inst *curr)
 
 static void do_move_to(struct drag_state *state, struct inst *curr)
 {
-	assert(state->inst->ops->find_point || may_move_to(state, curr));
-	*state->anchors[state->anchor_i] = inst_get_vec(curr);
+	struct vec **anchor = state->anchors[state->anchor_i];
+
+	assert(inst_ops_of(state->inst)->find_point || may_move_to(state, curr));
+	journal_store(anchor, sizeof(*anchor));
+	*anchor = inst_get_vec(curr);
 }
 
 
@@ -774,8 +759,8 @@ static struct inst *get_hover_inst(struct coord pos)
 		return inst_find_point(pos);
 	}
 	if (drag.anchors_n) {
-		if (drag.inst->ops->find_point)
-			return drag.inst->ops->find_point(drag.inst, pos);
+		if (inst_ops_of(drag.inst)->find_point)
+			return inst_ops_of(drag.inst)->find_point(drag.inst, pos);
 		inst = inst_find_point(pos);
 		if (!inst)
 			return NULL;
@@ -1005,8 +990,8 @@ void tool_drag(struct coord to)
 
 void tool_cancel_drag(void)
 {
-	if (drag.anchors_n && drag.inst->ops->end_drag_move)
-		drag.inst->ops->end_drag_move();
+	if (drag.anchors_n && inst_ops_of(drag.inst)->end_drag_move)
+		inst_ops_of(drag.inst)->end_drag_move();
 	drag.new = NULL;
 	active_ops = NULL;
 	drag.anchors_n = 0;
@@ -1028,8 +1013,8 @@ int tool_end_drag(struct coord to)
 	if (state.new && ops->find_point) {
 		end = ops->find_point(to);
 	} else {
-		if (state.inst && state.inst->ops->find_point)
-			end = state.inst->ops->find_point(state.inst, to);
+		if (state.inst && inst_ops_of(state.inst)->find_point)
+			end = inst_ops_of(state.inst)->find_point(state.inst, to);
 		else
 			end = inst_find_point(to);
 	}
@@ -1042,7 +1027,7 @@ int tool_end_drag(struct coord to)
 		return ops->end_new(state.new, end);
 
 	/* if we got the point from find_point, it's authoritative */
-	if (!state.inst->ops->find_point && !may_move_to(&state, end))
+	if (!inst_ops_of(state.inst)->find_point && !may_move_to(&state, end))
 		return 0;
 	if (!inst_do_move_to(state.inst, end, state.anchor_i))
 		do_move_to(&state, end);
@@ -12,10 +12,12 @@
 
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <gtk/gtk.h>
 
 #include "util.h"
+#include "hash.h"
 #include "gui_style.h"
 #include "gui.h"
 #include "gui_util.h"
@@ -251,21 +253,181 @@ GtkWidget *tool_button(GtkWidget *bar, GdkDrawable *drawable,
 }
 
 
+/* ----- cache of text layouts -------------------------------------------- */
+
+
+/*
+ * Shaping text with Pango is expensive, and a redraw renders the same pad
+ * names and measurement labels again, usually at the same size and angle.
+ * We therefore keep the layouts, each with its own context carrying the
+ * rotation and scale. The position only enters when drawing.
+ */
+
+#define	TEXT_CACHE_SIZE	1024	/* layouts we keep */
+#define	SCALE_STEPS	64	/* resolution of the font scale */
+
+
+struct text {
+	GdkScreen *screen;
+	char *s;
+	char *font;
+	int scale;		/* in 1/SCALE_STEPS */
+	double angle;
+	PangoContext *context;
+	PangoLayout *layout;
+	struct text *prev, *next; /* most recently used first */
+};
+
+
+static struct hash *texts = NULL;
+static struct text *text_first = NULL, *text_last = NULL;
+static int n_texts = 0;
+
+
+/*
+ * eq_text compares angles with ==, so -0.0 and 0.0 have to hash the same.
+ */
+
+static unsigned hash_text(const void *item)
+{
+	const struct text *t = item;
+	double angle = t->angle ? t->angle : 0;
+	unsigned h;
+
+	h = hash_bytes(HASH_INIT, &t->screen, sizeof(t->screen));
+	h = hash_str(h, t->s);
+	h = hash_str(h, t->font);
+	h = hash_bytes(h, &t->scale, sizeof(t->scale));
+	return hash_bytes(h, &angle, sizeof(angle));
+}
+
+
+static int eq_text(const void *a, const void *b)
+{
+	const struct text *ta = a, *tb = b;
+
+	return ta->screen == tb->screen && ta->scale == tb->scale &&
+	    ta->angle == tb->angle && !strcmp(ta->s, tb->s) &&
+	    !strcmp(ta->font, tb->font);
+}
+
+
+static void text_unlink(struct text *t)
+{
+	if (t->prev)
+		t->prev->next = t->next;
+	else
+		text_first = t->next;
+	if (t->next)
+		t->next->prev = t->prev;
+	else
+		text_last = t->prev;
+}
+
+
+static void text_push(struct text *t)
+{
+	t->prev = NULL;
+	t->next = text_first;
+	if (text_first)
+		text_first->prev = t;
+	else
+		text_last = t;
+	text_first = t;
+}
+
+
+static void text_evict(void)
+{
+	struct text *t = text_last;
+
+	text_unlink(t);
+	hash_remove(texts, t);
+	g_object_unref(t->layout);
+	g_object_unref(t->context);
+	free(t->s);
+	free(t->font);
+	free(t);
+	n_texts--;
+}
+
+
+static void text_matrix(PangoMatrix *m, int scale, double angle)
+{
+	PangoMatrix init = PANGO_MATRIX_INIT;
+
+	*m = init;
+	pango_matrix_rotate(m, angle);
+	pango_matrix_scale(m, (double) scale/SCALE_STEPS,
+	    (double) scale/SCALE_STEPS);
+}
+
+
+static struct text *get_text(GdkScreen *screen, const char *s,
+    const char *font, int scale, double angle)
+{
+	struct text key, *t;
+	PangoFontDescription *desc;
+	PangoMatrix m;
+
+	if (!texts)
+		texts = hash_new(hash_text, eq_text);
+	key.screen = screen;
+	key.s = (char *) s;
+	key.font = (char *) font;
+	key.scale = scale;
+	key.angle = angle;
+	t = hash_lookup(texts, &key);
+	if (t) {
+		text_unlink(t);
+		text_push(t);
+		return t;
+	}
+
+	t = alloc_type(struct text);
+	*t = key;
+	t->s = stralloc(s);
+	t->font = stralloc(font);
+
+	t->context = gdk_pango_context_get_for_screen(screen);
+	if (scale != SCALE_STEPS || angle) {
+		text_matrix(&m, scale, angle);
+		pango_context_set_matrix(t->context, &m);
+	}
+	t->layout = pango_layout_new(t->context);
+	pango_layout_set_text(t->layout, s, -1);
+
+	desc = pango_font_description_from_string(font);
+	pango_layout_set_font_description(t->layout, desc);
+	pango_font_description_free(desc);
+
+	hash_add(texts, t);
+	text_push(t);
+	if (++n_texts > TEXT_CACHE_SIZE)
+		text_evict();
+	return t;
+}
+
+
 /* ----- render a text string ---------------------------------------------- */
 
 
+/*
+ * The unscaled, unrotated layout gives us the size of the text. We then draw
+ * the layout for the scale and angle, and move it into place with the inverse
+ * of its matrix.
+ */
+
 void render_text(GdkDrawable *da, GdkGC *gc, int x, int y, double angle,
     const char *s, const char *font, double xalign, double yalign,
     int xmax, int ymax)
 {
 	GdkScreen *screen;
 	PangoRenderer *renderer;
-	PangoContext *context;
-	PangoLayout *layout;
-	PangoFontDescription *desc;
-	int width, height;
-	PangoMatrix m = PANGO_MATRIX_INIT;
-	double f_min, f;
+	struct text *t;
+	int width, height, scale;
+	PangoMatrix m;
+	double f_min, f, det, ux, uy;
 
 	/* set up the renderer */
 
@@ -274,21 +436,10 @@ void render_text(GdkDrawable *da, GdkGC *gc, int x, int y, double angle,
 	gdk_pango_renderer_set_drawable(GDK_PANGO_RENDERER(renderer), da);
 	gdk_pango_renderer_set_gc(GDK_PANGO_RENDERER(renderer), gc);
 
-	/* start preparing the layout */
-
-	context = gdk_pango_context_get_for_screen(screen);
-	layout = pango_layout_new(context);
-	pango_layout_set_text(layout, s, -1);
-
-	/* apply the font */
+	/* measure the text */
 
-	desc = pango_font_description_from_string(font);
-	pango_layout_set_font_description(layout, desc);
-	pango_font_description_free(desc);
-
-	/* align and position the text */
-
-	pango_layout_get_size(layout, &width, &height);
+	t = get_text(screen, s, font, SCALE_STEPS, 0);
+	pango_layout_get_size(t->layout, &width, &height);
 	f_min = 1.0;
 	if (xmax) {
 		f = xmax/((double) width/PANGO_SCALE);
@@ -302,26 +453,23 @@ void render_text(GdkDrawable *da, GdkGC *gc, int x, int y, double angle,
 	}
 	if (f_min < MIN_FONT_SCALE)
 		f_min = MIN_FONT_SCALE;
-	pango_matrix_translate(&m, x, y);
-	pango_matrix_rotate(&m, angle);
-	pango_matrix_translate(&m,
-	    -xalign*f_min*width/PANGO_SCALE,
-	    (yalign-1)*f_min*height/PANGO_SCALE);
-	pango_matrix_scale(&m, f_min, f_min);
+	scale = floor(f_min*SCALE_STEPS+0.5);
 
-	pango_context_set_matrix(context, &m);
-	pango_layout_context_changed(layout);
-	pango_renderer_draw_layout(renderer, layout, 0, 0);
+	/* align and position the text */
+
+	t = get_text(screen, s, font, scale, angle);
+	text_matrix(&m, scale, angle);
+	det = m.xx*m.yy-m.xy*m.yx;
+	ux = (m.yy*x-m.xy*y)/det;
+	uy = (m.xx*y-m.yx*x)/det;
+	pango_renderer_draw_layout(renderer, t->layout,
+	    floor(ux*PANGO_SCALE-xalign*width+0.5),
+	    floor(uy*PANGO_SCALE+(yalign-1)*height+0.5));
 
 	/* clean up renderer */
 
 	gdk_pango_renderer_set_drawable(GDK_PANGO_RENDERER(renderer), NULL);
 	gdk_pango_renderer_set_gc(GDK_PANGO_RENDERER(renderer), NULL);
-
-	/* free objects */
-
-	g_object_unref(layout);
-	g_object_unref(context);
 }
 
 
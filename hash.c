@@ -0,0 +1,167 @@
+/*
+ * hash.c - Generic hash tables
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#include <stdlib.h>
+
+#include "util.h"
+#include "hash.h"
+
+
+#define	INITIAL_BUCKETS	16
+
+
+struct hash_item {
+	void *item;
+	unsigned hash;
+	struct hash_item *next;
+};
+
+struct hash {
+	unsigned (*hash)(const void *item);
+	int (*eq)(const void *a, const void *b);
+	struct hash_item **buckets;
+	unsigned n_buckets;	/* power of two */
+	unsigned n_items;
+};
+
+
+/* ----- hash functions ---------------------------------------------------- */
+
+
+unsigned hash_bytes(unsigned h, const void *data, size_t size)
+{
+	const unsigned char *p = data;
+
+	while (size--) {
+		h ^= *p++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+
+unsigned hash_str(unsigned h, const char *s)
+{
+	while (*s) {
+		h ^= (unsigned char) *s++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+
+/* ----- table operations -------------------------------------------------- */
+
+
+struct hash *hash_new(unsigned (*hash)(const void *item),
+    int (*eq)(const void *a, const void *b))
+{
+	struct hash *new;
+
+	new = alloc_type(struct hash);
+	new->hash = hash;
+	new->eq = eq;
+	new->n_buckets = INITIAL_BUCKETS;
+	new->buckets = zalloc_size(sizeof(struct hash_item *)*new->n_buckets);
+	new->n_items = 0;
+	return new;
+}
+
+
+void *hash_lookup(const struct hash *hash, const void *key)
+{
+	const struct hash_item *hi;
+	unsigned h;
+
+	h = hash->hash(key);
+	for (hi = hash->buckets[h & (hash->n_buckets-1)]; hi; hi = hi->next)
+		if (hi->hash == h && hash->eq(hi->item, key))
+			return hi->item;
+	return NULL;
+}
+
+
+static void grow(struct hash *hash)
+{
+	struct hash_item **old = hash->buckets;
+	struct hash_item *hi, *next;
+	unsigned i, n = hash->n_buckets;
+
+	hash->n_buckets = n*2;
+	hash->buckets =
+	    zalloc_size(sizeof(struct hash_item *)*hash->n_buckets);
+	for (i = 0; i != n; i++)
+		for (hi = old[i]; hi; hi = next) {
+			next = hi->next;
+			hi->next = hash->buckets[hi->hash & (hash->n_buckets-1)];
+			hash->buckets[hi->hash & (hash->n_buckets-1)] = hi;
+		}
+	free(old);
+}
+
+
+void hash_add(struct hash *hash, void *item)
+{
+	struct hash_item *hi, **bucket;
+
+	if (hash->n_items >= hash->n_buckets*2)
+		grow(hash);
+	hi = alloc_type(struct hash_item);
+	hi->item = item;
+	hi->hash = hash->hash(item);
+	bucket = hash->buckets+(hi->hash & (hash->n_buckets-1));
+	hi->next = *bucket;
+	*bucket = hi;
+	hash->n_items++;
+}
+
+
+/*
+ * Removes the item itself, not just one that is equal to it.
+ */
+
+void hash_remove(struct hash *hash, const void *item)
+{
+	struct hash_item **anchor, *hi;
+	unsigned h;
+
+	h = hash->hash(item);
+	for (anchor = hash->buckets+(h & (hash->n_buckets-1)); *anchor;
+	    anchor = &(*anchor)->next) {
+		hi = *anchor;
+		if (hi->item == item) {
+			*anchor = hi->next;
+			free(hi);
+			hash->n_items--;
+			return;
+		}
+	}
+	abort();
+}
+
+
+void hash_free(struct hash *hash, void (*free_item)(void *item))
+{
+	struct hash_item *hi, *next;
+	unsigned i;
+
+	for (i = 0; i != hash->n_buckets; i++)
+		for (hi = hash->buckets[i]; hi; hi = next) {
+			next = hi->next;
+			if (free_item)
+				free_item(hi->item);
+			free(hi);
+		}
+	free(hash->buckets);
+	free(hash);
+}
@@ -0,0 +1,41 @@
+/*
+ * hash.h - Generic hash tables
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+
+
+#define	HASH_INIT	2166136261u	/* FNV-1a offset basis */
+
+
+struct hash;
+
+
+unsigned hash_bytes(unsigned h, const void *data, size_t size);
+unsigned hash_str(unsigned h, const char *s);
+
+/*
+ * The table stores pointers to items. "hash" must return the same value for
+ * items "eq" considers equal. Lookups are done with an item acting as key.
+ */
+
+struct hash *hash_new(unsigned (*hash)(const void *item),
+    int (*eq)(const void *a, const void *b));
+void *hash_lookup(const struct hash *hash, const void *key);
+void hash_add(struct hash *hash, void *item);
+void hash_remove(struct hash *hash, const void *item);
+void hash_free(struct hash *hash, void (*free_item)(void *item));
+
+#endif /* !HASH_H */
@@ -0,0 +1,266 @@
+/*
+ * hoist.c - Hoisting of loop-invariant expressions
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Within a frame, instantiation iterates over the rows of the tables, in
+ * order, and then over the loops, innermost last. We number these nesting
+ * levels from 1, with 0 standing for the frame itself, i.e., for variables
+ * set by its parents.
+ *
+ * The level of an expression is the innermost level of the variables it uses,
+ * following table variables to the expressions that set them. Since all the
+ * inner levels start over whenever an outer level changes, the stamp of that
+ * one level tells us whether we can reuse a value.
+ */
+
+
+#include <stdlib.h>
+
+#include "util.h"
+#include "expr.h"
+#include "obj.h"
+#include "hoist.h"
+
+
+struct hoisted {
+	struct expr *expr;
+	const unsigned long *stamp;
+	unsigned long epoch;	/* when we evaluated it, 0 if never */
+	struct num value;
+	struct hoisted *next;
+};
+
+
+unsigned long hoist_epoch = 0;
+
+static struct hoisted *hoisted = NULL;
+
+
+/* ----- dependency analysis ----------------------------------------------- */
+
+
+struct level_ctx {
+	const struct frame *frame;
+	int level;
+};
+
+
+static int expr_level(const struct frame *frame, const struct expr *expr);
+
+
+static int table_var_level(const struct frame *frame,
+    const struct table *table, struct var *var, int level)
+{
+	const struct row *row;
+	const struct value *value;
+	const struct var *v;
+	int res = level;
+	int tmp;
+
+	if (var->visited)
+		return -1;
+	var->visited = 1;
+	for (row = table->rows; row; row = row->next) {
+		value = row->values;
+		for (v = table->vars; v != var; v = v->next)
+			value = value->next;
+		tmp = expr_level(frame, value->expr);
+		if (tmp < 0) {
+			res = -1;
+			break;
+		}
+		if (tmp > res)
+			res = tmp;
+	}
+	var->visited = 0;
+	return res;
+}
+
+
+/* same search order as eval_var */
+
+static int var_level(const char *name, void *user)
+{
+	struct level_ctx *ctx = user;
+	const struct table *table;
+	const struct loop *loop;
+	struct var *var;
+	int level = 1;
+	int res = 0;
+
+	for (table = ctx->frame->tables; table; table = table->next) {
+		for (var = table->vars; var; var = var->next)
+			if (!var->key && var->name == name) {
+				res = table_var_level(ctx->frame, table, var,
+				    level);
+				goto found;
+			}
+		level++;
+	}
+	for (loop = ctx->frame->loops; loop; loop = loop->next) {
+		if (loop->var.name == name) {
+			res = level;
+			goto found;
+		}
+		level++;
+	}
+
+found:
+	if (res < 0)
+		return 1;
+	if (res > ctx->level)
+		ctx->level = res;
+	return 0;
+}
+
+
+/* returns -1 if we can't tell, e.g., because of recursion */
+
+static int expr_level(const struct frame *frame, const struct expr *expr)
+{
+	struct level_ctx ctx = {
+		.frame = frame,
+		.level = 0,
+	};
+
+	if (expr_vars(expr, var_level, &ctx))
+		return -1;
+	return ctx.level;
+}
+
+
+static unsigned long *level_stamp(struct frame *frame, int level)
+{
+	struct table *table;
+	struct loop *loop;
+
+	if (!level)
+		return &frame->stamp;
+	for (table = frame->tables; table; table = table->next)
+		if (!--level)
+			return &table->stamp;
+	for (loop = frame->loops; loop; loop = loop->next)
+		if (!--level)
+			return &loop->stamp;
+	abort();
+}
+
+
+/* ----- registering expressions ------------------------------------------- */
+
+
+/*
+ * Constants are cheap enough as they are. "max" is the first level at which
+ * the value would not be available yet.
+ */
+
+static void hoist(struct frame *frame, struct expr *expr, int max)
+{
+	struct hoisted *h;
+	int level;
+
+	if (!expr || expr->op == op_num || expr->hoist)
+		return;
+	level = expr_level(frame, expr);
+	if (level < 0 || level >= max)
+		return;
+	h = alloc_type(struct hoisted);
+	h->expr = expr;
+	h->stamp = level_stamp(frame, level);
+	h->epoch = 0;
+	h->next = hoisted;
+	hoisted = h;
+	expr->hoist = h;
+}
+
+
+static void hoist_frame(struct frame *frame)
+{
+	struct table *table;
+	struct loop *loop;
+	struct vec *vec;
+	struct obj *obj;
+	int level = 1;
+
+	for (table = frame->tables; table; table = table->next)
+		level++;
+	for (loop = frame->loops; loop; loop = loop->next) {
+		hoist(frame, loop->from.expr, level);
+		hoist(frame, loop->to.expr, level);
+		level++;
+	}
+	for (vec = frame->vecs; vec; vec = vec->next) {
+		hoist(frame, vec->x, level);
+		hoist(frame, vec->y, level);
+	}
+	for (obj = frame->objs; obj; obj = obj->next)
+		switch (obj->type) {
+		case ot_line:
+			hoist(frame, obj->u.line.width, level);
+			break;
+		case ot_rect:
+			hoist(frame, obj->u.rect.width, level);
+			break;
+		case ot_arc:
+			hoist(frame, obj->u.arc.width, level);
+			break;
+		case ot_meas:
+			hoist(frame, obj->u.meas.offset, level);
+			break;
+		default:
+			break;
+		}
+}
+
+
+/* ----- evaluation -------------------------------------------------------- */
+
+
+struct num eval_hoisted(const struct expr *expr, const struct frame *frame)
+{
+	struct hoisted *h = expr->hoist;
+	struct num res;
+
+	if (h && h->epoch && h->epoch >= *h->stamp)
+		return h->value;
+	res = eval_num(expr, frame);
+	if (h && !is_undef(res)) {
+		h->value = res;
+		h->epoch = hoist_epoch;
+	}
+	return res;
+}
+
+
+/* ----- setup and cleanup ------------------------------------------------- */
+
+
+void hoist_start(void)
+{
+	struct frame *frame;
+
+	for (frame = frames; frame; frame = frame->next)
+		hoist_frame(frame);
+}
+
+
+void hoist_stop(void)
+{
+	struct hoisted *next;
+
+	while (hoisted) {
+		next = hoisted->next;
+		hoisted->expr->hoist = NULL;
+		free(hoisted);
+		hoisted = next;
+	}
+}
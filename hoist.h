@@ -0,0 +1,41 @@
+/*
+ * hoist.h - Hoisting of loop-invariant expressions
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef HOIST_H
+#define HOIST_H
+
+#include "expr.h"
+
+
+/*
+ * Frames, tables, and loops have a stamp that changes whenever instantiation
+ * enters the frame, selects a new row, or begins a new iteration. A hoisted
+ * expression keeps its value until the stamp of the innermost of these it
+ * depends on changes.
+ */
+
+extern unsigned long hoist_epoch;
+
+
+static inline void hoist_changed(unsigned long *stamp)
+{
+	*stamp = ++hoist_epoch;
+}
+
+
+struct num eval_hoisted(const struct expr *expr, const struct frame *frame);
+
+void hoist_start(void);
+void hoist_stop(void);
+
+#endif /* !HOIST_H */
@@ -50,26 +50,35 @@ static int check_through_hole(struct inst *pad, struct inst *hole)
 
 static int connect_holes(const struct pkg *pkg)
 {
-	struct inst *pad, *hole;
+	const struct inst_cols *pads = pkg->cols+ip_pad_copper;
+	const struct inst_cols *holes = pkg->cols+ip_hole;
+	int i, j;
 
-	for (pad = pkg->insts[ip_pad_copper]; pad; pad = pad->next)
-		for (hole = pkg->insts[ip_hole]; hole; hole = hole->next)
-			if (!check_through_hole(pad, hole))
+	for (i = 0; i != pads->n; i++)
+		for (j = 0; j != holes->n; j++) {
+			if (inst_cols_apart(pads, i, holes, j))
+				continue;
+			if (!check_through_hole(pads->inst[i], holes->inst[j]))
 				return 0;
+		}
 	return 1;
 }
 
 
 static void clear_links(const struct pkg *pkg)
 {
-	struct inst *pad, *hole;
+	const struct inst_cols *c;
+	int i;
 
-	for (pad = pkg->insts[ip_pad_copper]; pad; pad = pad->next)
-		pad->u.pad.hole = NULL;
-	for (pad = pkg->insts[ip_pad_special]; pad; pad = pad->next)
-		pad->u.pad.hole = NULL;
-	for (hole = pkg->insts[ip_hole]; hole; hole = hole->next)
-		hole->u.hole.pad = NULL;
+	c = pkg->cols+ip_pad_copper;
+	for (i = 0; i != c->n; i++)
+		c->inst[i]->u.pad.hole = NULL;
+	c = pkg->cols+ip_pad_special;
+	for (i = 0; i != c->n; i++)
+		c->inst[i]->u.pad.hole = NULL;
+	c = pkg->cols+ip_hole;
+	for (i = 0; i != c->n; i++)
+		c->inst[i]->u.hole.pad = NULL;
 }
 
 
@@ -21,19 +21,11 @@
 #include "expr.h"
 #include "layer.h"
 #include "obj.h"
-#include "delete.h"
-#include "gui_util.h"
-#include "gui_status.h"
-#include "gui_canvas.h"
-#include "gui_tool.h"
-#include "gui_meas.h"
-#include "gui_inst.h"
-#include "gui_frame.h"
-#include "gui.h"
+#include "hash.h"
+#include "strpool.h"
+#include "meas.h"
 #include "inst.h"
 
-
-struct inst *selected_inst = NULL;
 struct bbox active_frame_bbox;
 struct pkg *pkgs, *active_pkg, *curr_pkg;
 struct pkg *reachable_pkg = NULL;
@@ -41,520 +33,98 @@ struct inst *frame_instantiating = NULL;
 
 static struct pkg *prev_pkgs, *prev_reachable_pkg;
 
-static unsigned long active_set = 0;
-
-static struct inst_ops vec_ops;
-static struct inst_ops frame_ops;
-static struct inst_ops meas_ops;
-
-
-#define	IS_ACTIVE	((active_set & 1))
-
-
-/* ----- selective visibility ---------------------------------------------- */
-
-
-static int show(enum inst_prio prio)
-{
-	switch (prio) {
-	case ip_vec:
-	case ip_frame:
-		return show_stuff;
-	case ip_meas:
-		return show_meas;
-	default:
-		return 1;
-	}
-}
-
-
-int bright(const struct inst *inst)
-{
-	if (!show_bright)
-		return 0;
-	return inst->ops != &vec_ops && inst->ops != &frame_ops &&
-	    inst->ops != &meas_ops;
-}
-
-
-static int show_this(const struct inst *inst)
-{
-	if (show_all)
-		return 1;
-	if (inst->ops == &frame_ops && inst->u.frame.ref == active_frame)
-		return 1;
-	if (!inst->outer)
-		return active_frame == frames;
-	return inst->outer->u.frame.ref == active_frame;
-}
-
+/* pad names of the instances in pkgs and prev_pkgs */
+static struct strpool *pad_names = NULL, *prev_pad_names;
 
-/* ----- selection of items not on the canvas ------------------------------ */
+/* likewise for the paths of the instances */
+static struct inst_path *paths = NULL, *prev_paths;
 
-
-static void *selected_outside = NULL;
-static void (*outside_deselect)(void *item);
-
-
-static void deselect_outside(void)
-{
-	if (selected_outside && outside_deselect)
-		outside_deselect(selected_outside);
-	selected_outside = NULL;
-}
+static unsigned long active_set = 0;
 
 
-void inst_select_outside(void *item, void (*deselect)(void *item))
-{
-	if (item == selected_outside)
-		return;
-	deselect_outside();
-	inst_deselect();
-	selected_outside = item;
-	outside_deselect = deselect;
-}
+#define	IS_ACTIVE	((active_set & 1))
 
 
-/* ----- check connectedness ----------------------------------------------- */
+/* ----- index of instances by vector/object ------------------------------- */
 
 
 /*
- * After an instantiation failure, the instances can get out of sync with the
- * object tree, and attempts to select an item on the canvas can cause accesses
- * to objects that aren't there anymore. So we need to check if we can still
- * reach the corresponding object.
- *
- * Note: even this isn't bullet-proof. Theoretically, we may get a new object
- * in the old place. However, this probably doesn't do any serious damage.
+ * Instances are only ever appended to the lists of a package, so we bring the
+ * index up to date when looking something up, starting where we stopped the
+ * last time. An arc can yield circles and arcs, so we also key on priority.
  */
 
-
-static int inst_connected(const struct inst *inst)
-{
-	const struct frame *frame;
-	const struct vec *vec;
-	const struct obj *obj;
-
-	for (frame = frames; frame; frame = frame->next) {
-		if (inst->ops == &vec_ops) {
-			for (vec = frame->vecs; vec; vec = vec->next)
-				if (vec == inst->vec)
-					return 1;
-		} else {
-			for (obj = frame->objs; obj; obj = obj->next)
-				if (obj == inst->obj)
-					return 1;
-		}
-	}
-	return 0;
-}
-
-
-/* ----- selection --------------------------------------------------------- */
-
-
-static void inst_select_inst(struct inst *inst)
-{
-	selected_inst = inst;
-	tool_selected_inst(inst);
-	gui_frame_select_inst(inst);
-	if (inst->ops->select)
-		selected_inst->ops->select(inst);
-	status_set_icon(get_icon_by_inst(inst));
-}
-
-
-/*
- * @@@ This logic is overly complicated and should be simplified. The general
- * idea was to avoid making unnecessary changes to the user's selections, but
- * that risk doesn't exist. Furthermore, the way activate_item is used, its
- * preconditions aren't met. It works anyway but it could be simpler as a
- * consequence.
- *
- * activate_item tries to activate the path through the frame references,
- * leading to a specific instance. It returns whether this is failed or whether
- * it may have been successful.
- *
- * The initial condition is that we want to activate an item on a frame
- * instance that's not active. Since the frame has been instantiated, there
- * must be a way to activate it. We just have to find out how.
- *
- * The first test eliminates the root frame. If we're at the root frame and
- * still haven't figured out what to do, something is wrong and we give up.
- *
- * The next test skips references that are already right. Since we know that
- * there must be at least one reference that leads elsewhere, and we haven't
- * found it yet, the recursion will tell us whether it can find it at all.
- *
- * Finally, if we've found a mismatch, we correct it. We then try to fix any
- * further mismatches. Since we've made progress, we return 1, even if the
- * other fixes should fail (or reach the root frame).
- *
- */
-
-static int activate_item(struct inst *inst)
-{
-	if (!inst->outer)
-		return 0;
-	if (inst->outer->u.frame.ref->active_ref == inst->outer->obj)
-		return activate_item(inst->outer);
-	inst->outer->u.frame.ref->active_ref = inst->outer->obj;
-	activate_item(inst->outer);
-	return 1;
-}
-
-
-static int __inst_select(struct coord pos, int tries)
-{
+struct inst_ref {
+	const void *item;	/* vector or object */
 	enum inst_prio prio;
-	const struct inst *prev;
-	struct inst *inst;
-	struct inst *first = NULL;	/* first active item */
-	struct inst *next = NULL;	/* active item after currently sel. */
-	struct inst *any_first = NULL;	/* first item, active or inactive */
-	struct inst *any_same_frame = NULL; /* first item on active frame */
-	struct frame *frame;
-	int best_dist = 0; /* keep gcc happy */
-	int select_next;
-	int dist, i;
-
-	if (!tries) {
-		fprintf(stderr, "__inst_select: tries exhausted\n");
-		return 0;
-	}
-	prev = selected_inst;
-	deselect_outside();
-	edit_nothing();
-	if (selected_inst) {
-		gui_frame_deselect_inst(selected_inst);
-		tool_selected_inst(NULL);
-	}
-	inst_deselect();
-	select_next = 0;
-	FOR_INST_PRIOS_DOWN(prio) {
-		if (!show(prio))
-			continue;
-		FOR_ALL_INSTS(i, prio, inst) {
-			if (!show_this(inst))
-				continue;
-			if (!inst->ops->distance)
-				continue;
-			if (!inst_connected(inst))
-				continue;
-			dist = inst->ops->distance(inst, pos, draw_ctx.scale);
-			if (dist >= 0) {
-				if (!any_first)
-					any_first = inst;
-				if (!any_same_frame && inst->outer &&
-				    inst->outer->u.frame.ref == active_frame)
-					any_same_frame = inst;
-				if (!inst->active)
-					continue;
-				if (!first)
-					first = inst;
-				if (!next && select_next)
-					next = inst;
-				if (inst == prev)
-					select_next = 1;
-				if (!selected_inst || best_dist > dist) {
-					selected_inst = inst;
-					best_dist = dist;
-				}
-			}
-		}
-	}
-	if (select_next) {
-		selected_inst = next ? next : first;
-		goto selected;
-	}
-	if (selected_inst)
-		goto selected;
-
-	/* give vectors a second chance */
-
-	if (show_stuff) {
-		FOR_ALL_INSTS(i, ip_vec, inst) {
-			if (!inst->active)
-				continue;
-			if (!inst_connected(inst))
-				continue;
-			dist = gui_dist_vec_fallback(inst, pos, draw_ctx.scale);
-			if (dist >= 0 && (!selected_inst || best_dist > dist)) {
-				selected_inst = inst;
-				best_dist = dist;
-			}
-		}
-
-		if (selected_inst)
-			goto selected;
-	}
-
-	if (!show_all)
-		return 0;
-
-	if (any_same_frame) {
-		activate_item(any_same_frame);
-		search_inst(any_same_frame);
-		instantiate();
-		change_world();
-		return __inst_select(pos, tries-1);
-	}
-	if (any_first) {
-		frame = any_first->outer ? any_first->outer->u.frame.ref : NULL;
-		if (frame != active_frame) {
-			select_frame(frame);
-			return __inst_select(pos, tries-1);
-		}
-	}
-
-	return 0;
-
-selected:
-	inst_select_inst(selected_inst);
-	return 1;
-}
+	struct inst *first;
+	struct inst *active;	/* first active instance, NULL if none */
+};
 
 
-int inst_select(struct coord pos)
+static unsigned hash_inst_ref(const void *item)
 {
-	/*
-	 * We shouldn't need more than 2 tries to select any item, so 5 is more
-	 * than enough. This can still fail, but then it would for any number
-	 * of tries.
-	 */
-	return __inst_select(pos, 5);
-}
+	const struct inst_ref *ref = item;
+	unsigned h;
 
-
-struct inst *inst_find_point(struct coord pos)
-{
-	struct inst *inst, *found;
-	int best_dist = 0; /* keep gcc happy */
-	int dist, i;
-
-	found = NULL;
-	FOR_ALL_INSTS(i, ip_frame, inst) {
-		if (!inst->u.frame.active)
-			continue;
-		dist = gui_dist_frame_eye(inst, pos, draw_ctx.scale);
-		if (dist >= 0 && (!found || best_dist > dist)) {
-			found = inst;
-			best_dist = dist;
-		}
-	}
-	if (found)
-		return found;
-
-	FOR_ALL_INSTS(i, ip_vec, inst) {
-		if (!inst->active || !inst->ops->distance)
-			continue;
-		dist = inst->ops->distance(inst, pos, draw_ctx.scale);
-		if (dist >= 0 && (!found || best_dist > dist)) {
-			found = inst;
-			best_dist = dist;
-		}
-	}
-	return found;
+	h = hash_bytes(HASH_INIT, &ref->item, sizeof(ref->item));
+	return hash_bytes(h, &ref->prio, sizeof(ref->prio));
 }
 
 
-int inst_find_point_selected(struct coord pos, struct inst **res)
+static int eq_inst_ref(const void *a, const void *b)
 {
-	struct vec **anchors[3];
-	int n, best_i, i;
-	struct inst *best = NULL;
-	struct inst *inst;
-	int d_min, d, j;
-
-	assert(selected_inst);
-	n = inst_anchors(selected_inst, anchors);
-	for (i = 0; i != n; i++) {
-		if (*anchors[i]) {
-			FOR_ALL_INSTS(j, ip_vec, inst) {
-				if (inst->vec != *anchors[i])
-					continue;
-				d = gui_dist_vec(inst, pos, draw_ctx.scale);
-				if (d != -1 && (!best || d < d_min)) {
-					best = inst;
-					best_i = i;
-					d_min = d;
-				}
-			}
-		} else {
-			FOR_ALL_INSTS(j, ip_frame, inst) {
-				if (inst != selected_inst->outer)
-					continue;
-				d = gui_dist_frame(inst, pos, draw_ctx.scale);
-				if (d != -1 && (!best || d < d_min)) {
-					best = inst;
-					best_i = i;
-					d_min = d;
-				}
-			}
-		}
-	}
-	if (!best)
-		return -1;
-	if (res)
-		*res = best;
-	return best_i;
-}
-
+	const struct inst_ref *ra = a, *rb = b;
 
-struct coord inst_get_point(const struct inst *inst)
-{
-	if (inst->ops == &vec_ops)
-		return inst->u.vec.end;
-	if (inst->ops == &frame_ops)
-		return inst->base;
-	abort();
+	return ra->item == rb->item && ra->prio == rb->prio;
 }
 
 
-struct vec *inst_get_vec(const struct inst *inst)
+static void index_inst(struct pkg *pkg, struct inst *inst)
 {
-	if (inst->ops == &vec_ops)
-		return inst->vec;
-	if (inst->ops == &frame_ops)
-		return NULL;
-	abort();
-}
+	struct inst_ref key, *ref;
 
-
-int inst_anchors(struct inst *inst, struct vec ***anchors)
-{
-	if (inst->vec) {
-		anchors[0] = &inst->vec->base;
-		return 1;
-	}
-	return obj_anchors(inst->obj, anchors);
-}
-
-
-void inst_deselect(void)
-{
-	if (selected_inst) {
-		tool_selected_inst(NULL);
-		gui_frame_deselect_inst(selected_inst);
+	key.item = inst->vec ? (const void *) inst->vec : inst->obj;
+	if (!key.item)
+		return;
+	key.prio = inst->prio;
+	ref = hash_lookup(pkg->index, &key);
+	if (!ref) {
+		ref = alloc_type(struct inst_ref);
+		*ref = key;
+		ref->first = inst;
+		ref->active = NULL;
+		hash_add(pkg->index, ref);
 	}
-	deselect_outside();
-	status_set_type_x(NULL, "");
-	status_set_type_y(NULL, "");
-	status_set_type_entry(NULL, "");
-	status_set_name(NULL, "");
-	status_set_x(NULL, "");
-	status_set_y(NULL, "");
-	status_set_r(NULL, "");
-	status_set_angle(NULL, "");
-	selected_inst = NULL;
-	edit_nothing();
-	refresh_pos();
-	status_set_icon(NULL);
+	if (inst->active && !ref->active)
+		ref->active = inst;
 }
 
 
-/* ----- select instance by vector/object ---------------------------------- */
-
-
-static void vec_edit(struct vec *vec);
-static void obj_edit(struct obj *obj);
-
-
-void inst_select_vec(struct vec *vec)
+struct inst *inst_lookup(struct pkg *pkg, const void *item,
+    enum inst_prio prio, int active)
 {
+	struct inst_ref key;
+	const struct inst_ref *ref;
+	enum inst_prio p;
 	struct inst *inst;
-	int i;
 
-	if (vec->frame != active_frame)
-		select_frame(vec->frame);
-	FOR_ALL_INSTS(i, ip_vec, inst)
-		if (inst->vec == vec && inst->active) {
-			inst_deselect();
-			inst_select_inst(inst);
-			return;
+	if (!pkg)
+		return NULL;
+	if (!pkg->index)
+		pkg->index = hash_new(hash_inst_ref, eq_inst_ref);
+	FOR_INST_PRIOS_UP(p) {
+		for (inst = *pkg->indexed[p]; inst; inst = inst->next) {
+			index_inst(pkg, inst);
+			pkg->indexed[p] = &inst->next;
 		}
-	vec_edit(vec);
-}
-
-
-void inst_select_obj(struct obj *obj)
-{
-	enum inst_prio prio;
-	struct inst *inst;
-	int i;
-
-	if (obj->frame != active_frame)
-		select_frame(obj->frame);
-	FOR_INST_PRIOS_DOWN(prio)
-		FOR_ALL_INSTS(i, prio, inst)
-			if (inst->obj && inst->obj == obj && inst->active)
-				goto found;
-	obj_edit(obj);
-	return;
-
-found:
-	inst_deselect();
-	inst_select_inst(inst);
-}
-
-
-/* ----- common status reporting ------------------------------------------- */
-
-
-static void rect_status(struct coord a, struct coord b, unit_type width,
-    int rounded)
-{
-	const char *tip;
-	struct coord d = sub_vec(b, a);
-	double r;
-	unit_type diag;
-
-	status_set_xy(d);
-	tip = "Angle of diagonal";
-	if (!d.x && !d.y) {
-		status_set_angle(tip, "a = 0 deg");
-	} else {
-		status_set_angle(tip, "a = %3.1f deg", theta(a, b));
-	}
-	if (d.x < 0)
-		d.x = -d.x;
-	if (d.y < 0)
-		d.y = -d.y;
-	diag = hypot(d.x, d.y);
-	if (rounded) {
-		/*
-		 * Only consider the part of the diagonal that is on the pad
-		 * surface.
-		 *
-		 * The circle: (x-r)^2+(y-r)^2 = r^2
-		 * The diagonal: x = t*cos(theta), y = t*sin(theta)
-		 *
-		 * t is the distance from the corner of the surrounding
-		 * rectangle to the half-circle:
-		 *
-		 * t = 2*r*(s+c-sqrt(2*s*c))
-		 *
-		 * With s = sin(theta) and c = cos(theta).
-		 *
-		 * Since d.x = diag*cos(theta), we don't need to calculate the
-		 * sinus and cosinus but can use d.x and d.y directly.
-		 */
-		r = (d.x > d.y ? d.y : d.x)/2;
-		diag -= 2*r*(d.x+d.y-sqrt(2*d.x*d.y))/diag;
 	}
-	set_with_units(status_set_r, "d = ", diag, "Length of diagonal");
-	if (width != -1) {
-		status_set_type_entry(NULL, "width =");
-		set_with_units(status_set_name, "", width, "Line width");
-	}
-}
-
-
-static void rect_status_sort(struct coord a, struct coord b, unit_type width,
-    int rounded)
-{
-	sort_coord(&a, &b);
-	rect_status(a, b, width, rounded);
+	key.item = item;
+	key.prio = prio;
+	ref = hash_lookup(pkg->index, &key);
+	if (!ref)
+		return NULL;
+	return active ? ref->active : ref->first;
 }
 
 
@@ -620,18 +190,20 @@ static int zero_sized(struct coord a, struct coord b, const char *fmt,
 }
 
 
-static struct inst *add_inst(const struct inst_ops *ops, enum inst_prio prio,
+static struct inst *add_inst(enum inst_type type, enum inst_prio prio,
     struct coord base)
 {
 	struct inst *inst;
 
 	inst = alloc_type(struct inst);
-	inst->ops = ops;
+	inst->type = type;
 	inst->prio = prio;
 	inst->vec = NULL;
 	inst->obj = NULL;
 	inst->base = inst->bbox.min = inst->bbox.max = base;
 	inst->outer = frame_instantiating;
+	inst->path = frame_instantiating ?
+	    frame_path(frame_instantiating->u.frame.ref) : NULL;
 	inst->active = IS_ACTIVE;
 	inst->next = NULL;
 	*curr_pkg->next_inst[prio] = inst;
@@ -643,139 +215,13 @@ static struct inst *add_inst(const struct inst_ops *ops, enum inst_prio prio,
 /* ----- vec --------------------------------------------------------------- */
 
 
-static int validate_vec_name(const char *s, void *ctx)
-{
-	struct vec *vec = ctx;
-	const struct vec *walk;
-
-	if (!is_id(s))
-		return 0;
-	for (walk = vec->frame->vecs; walk; walk = walk->next)
-		if (walk->name && !strcmp(walk->name, s))
-			return 0;
-	return 1;
-}
-
-
-static void vec_edit(struct vec *vec)
-{
-	edit_x(&vec->x, "X distance");
-	edit_y(&vec->y, "Y distance");
-	edit_unique_null(&vec->name, validate_vec_name, vec, "Vector name");
-}
-
-
-static void vec_op_select(struct inst *self)
-{
-	status_set_type_entry(NULL, "ref =");
-	status_set_name("Vector reference (name)",
-	    "%s", self->vec->name ? self->vec->name : "");
-	rect_status(self->base, self->u.vec.end, -1, 0);
-	vec_edit(self->vec);
-}
-
-
-/*
- * @@@ The logic of gui_find_point_vec isn't great. Instead of selecting a
- * point and then filtering, we should filter the candidates, so that a point
- * that's close end eligible can win against one that's closer but not
- * eligible.
- */
-
-static struct inst *find_point_vec(struct inst *self, struct coord pos)
-{
-	struct inst *inst;
-	const struct vec *vec;
-
-	inst = inst_find_point(pos);
-	if (!inst)
-		return NULL;
-	if (inst->ops == &frame_ops)
-		return inst;
-	for (vec = inst->vec; vec; vec = vec->base)
-		if (vec == self->vec)
-		return NULL;
-	return inst;
-}
-
-
-/*
- * When instantiating and when dumping, we assume that bases appear in the
- * frame->vecs list before vectors using them. A move may change this order.
- * We therefore have to sort the list after the move.
- *
- * Since the list is already ordered, cleaning it up is just O(n).
- */
-
-
-static void do_move_to_vec(struct inst *inst, struct inst *to, int i)
-{
-	struct vec *to_vec = inst_get_vec(to);
-	struct vec *vec = inst->vec;
-	struct frame *frame = vec->frame;
-	struct vec *v, **anchor, **walk;
-
-	assert(!i);
-	vec->base = to_vec;
-
-	/*
-	 * Mark the vector that's being rebased and all vectors that
-	 * (recursively) depend on it.
-	 *
-	 * We're mainly interested in the range between the vector being moved
-	 * and the new base. If the vector follows the base, the list is
-	 * already in the correct order and nothing needs moving.
-	 */
-	for (v = frame->vecs; v != vec; v = v->next)
-		v->mark = 0;
-	vec->mark = 1;
-	for (v = vec->next; v && v != to_vec; v = v->next)
-		v->mark = v->base ? v->base->mark : 0;
-	if (!v)
-		return;
-
-	/*
-	 * All the marked vectors appearing on the list before the new base
-	 * are moved after the new base, preserving their order.
-	 *
-	 * Start at frame->vecs, not "vec", so that we move the the vector
-	 * being rebased as well.
-	 */
-	anchor = &to_vec->next;
-	walk = &frame->vecs;
-	while (*walk != to_vec) {
-		v = *walk;
-		if (!v->mark) {
-			walk = &v->next;
-		} else {
-			*walk = v->next;
-			v->next = *anchor;
-			*anchor = v;
-			anchor = &v->next;
-		}
-	}
-}
-
-
-static struct inst_ops vec_ops = {
-	.draw		= gui_draw_vec,
-	.hover		= gui_hover_vec,
-	.distance	= gui_dist_vec,
-	.select		= vec_op_select,
-	.find_point	= find_point_vec,
-	.draw_move	= draw_move_vec,
-	.do_move_to	= do_move_to_vec,
-};
-
-
 int inst_vec(struct vec *vec, struct coord base)
 {
 	struct inst *inst;
 
-	inst = add_inst(&vec_ops, ip_vec, base);
+	inst = add_inst(it_vec, ip_vec, base);
 	inst->vec = vec;
 	inst->u.vec.end = vec->pos;
-	find_inst(inst);
 	update_bbox(&inst->bbox, vec->pos);
 	propagate_bbox(inst);
 	return 1;
@@ -785,36 +231,14 @@ int inst_vec(struct vec *vec, struct coord base)
 /* ----- line -------------------------------------------------------------- */
 
 
-static void obj_line_edit(struct obj *obj)
-{
-	edit_dist_expr(&obj->u.line.width, "Line width");
-}
-
-
-static void line_op_select(struct inst *self)
-{
-	rect_status_sort(self->base, self->u.rect.end, self->u.rect.width, 0);
-	obj_line_edit(self->obj);
-}
-
-
-static struct inst_ops line_ops = {
-	.draw		= gui_draw_line,
-	.distance	= gui_dist_line,
-	.select		= line_op_select,
-	.draw_move	= draw_move_line,
-};
-
-
 int inst_line(struct obj *obj, struct coord a, struct coord b, unit_type width)
 {
 	struct inst *inst;
 
-	inst = add_inst(&line_ops, ip_line, a);
+	inst = add_inst(it_line, ip_line, a);
 	inst->obj = obj;
 	inst->u.rect.end = b;
 	inst->u.rect.width = width;
-	find_inst(inst);
 	update_bbox(&inst->bbox, b);
 	grow_bbox_by_width(&inst->bbox, width);
 	propagate_bbox(inst);
@@ -825,36 +249,14 @@ int inst_line(struct obj *obj, struct coord a, struct coord b, unit_type width)
 /* ----- rect -------------------------------------------------------------- */
 
 
-static void obj_rect_edit(struct obj *obj)
-{
-	edit_dist_expr(&obj->u.rect.width, "Line width");
-}
-
-
-static void rect_op_select(struct inst *self)
-{
-	rect_status_sort(self->base, self->u.rect.end, self->u.rect.width, 0);
-	obj_rect_edit(self->obj);
-}
-
-
-static struct inst_ops rect_ops = {
-	.draw		= gui_draw_rect,
-	.distance	= gui_dist_rect,
-	.select		= rect_op_select,
-	.draw_move	= draw_move_rect,
-};
-
-
 int inst_rect(struct obj *obj, struct coord a, struct coord b, unit_type width)
 {
 	struct inst *inst;
 
-	inst = add_inst(&rect_ops, ip_rect, a);
+	inst = add_inst(it_rect, ip_rect, a);
 	inst->obj = obj;
 	inst->u.rect.end = b;
 	inst->u.rect.width = width;
-	find_inst(inst);
 	update_bbox(&inst->bbox, b);
 	grow_bbox_by_width(&inst->bbox, width);
 	propagate_bbox(inst);
@@ -865,76 +267,20 @@ int inst_rect(struct obj *obj, struct coord a, struct coord b, unit_type width)
 /* ----- pad / rpad -------------------------------------------------------- */
 
 
-static int validate_pad_name(const char *s, void *ctx)
-{
-	char *tmp;
-
-	status_begin_reporting();
-	tmp = expand(s, NULL);
-	if (!tmp)
-		return 0;
-	free(tmp);
-	return 1;
-}
-
-
-static void obj_pad_edit(struct obj *obj)
-{
-	edit_pad_type(&obj->u.pad.type);
-	edit_name(&obj->u.pad.name, validate_pad_name, NULL,
-	    "Pad name (template)");
-}
-
-
-static void pad_op_select(struct inst *self)
-{
-	status_set_type_entry(NULL, "label =");
-	status_set_name("Pad name (actual)", "%s", self->u.pad.name);
-	rect_status_sort(self->base, self->u.pad.other, -1, 0);
-	obj_pad_edit(self->obj);
-}
-
-
-static struct inst_ops pad_ops = {
-	.draw		= gui_draw_pad,
-	.distance	= gui_dist_pad,
-	.select		= pad_op_select,
-	.draw_move	= draw_move_pad,
-};
-
-
-static void rpad_op_select(struct inst *self)
-{
-	status_set_type_entry(NULL, "label =");
-	status_set_name("Pad name (actual)", "%s", self->u.pad.name);
-	rect_status_sort(self->base, self->u.pad.other, -1, 1);
-	obj_pad_edit(self->obj);
-}
-
-
-static struct inst_ops rpad_ops = {
-	.draw		= gui_draw_rpad,
-	.distance	= gui_dist_pad, /* @@@ */
-	.select		= rpad_op_select,
-	.draw_move	= draw_move_rpad,
-};
-
-
 int inst_pad(struct obj *obj, const char *name, struct coord a, struct coord b)
 {
 	struct inst *inst;
 
 	if (zero_sized(a, b, "%s pad \"%s\"", name))
 		return 0;
-	inst = add_inst(obj->u.pad.rounded ? &rpad_ops : &pad_ops,
+	inst = add_inst(obj->u.pad.rounded ? it_rpad : it_pad,
 	    obj->u.pad.type == pt_normal || obj->u.pad.type == pt_bare ||
 	    obj->u.pad.type == pt_trace ?
 	    ip_pad_copper : ip_pad_special, a);
 	inst->obj = obj;
-	inst->u.pad.name = stralloc(name);
+	inst->u.pad.name = strpool_add(pad_names, name);
 	inst->u.pad.other = b;
 	inst->u.pad.layers = pad_type_to_layers(obj->u.pad.type);
-	find_inst(inst);
 	update_bbox(&inst->bbox, b);
 	propagate_bbox(inst);
 	return 1;
@@ -944,31 +290,16 @@ int inst_pad(struct obj *obj, const char *name, struct coord a, struct coord b)
 /* ----- hole -------------------------------------------------------------- */
 
 
-static void hole_op_select(struct inst *self)
-{
-	rect_status_sort(self->base, self->u.hole.other, -1, 1);
-}
-
-
-static struct inst_ops hole_ops = {
-	.draw		= gui_draw_hole,
-	.distance	= gui_dist_hole,
-	.select		= hole_op_select,
-	.draw_move	= draw_move_hole,
-};
-
-
 int inst_hole(struct obj *obj, struct coord a, struct coord b)
 {
 	struct inst *inst;
 
 	if (zero_sized(a, b, "%s hole", NULL))
 		return 0;
-	inst = add_inst(&hole_ops, ip_hole, a);
+	inst = add_inst(it_hole, ip_hole, a);
 	inst->obj = obj;
 	inst->u.hole.other = b;
 	inst->u.hole.layers = mech_hole_layers();
-	find_inst(inst);
 	update_bbox(&inst->bbox, b);
 	propagate_bbox(inst);
 	return 1;
@@ -978,34 +309,6 @@ int inst_hole(struct obj *obj, struct coord a, struct coord b)
 /* ----- arc --------------------------------------------------------------- */
 
 
-static void obj_arc_edit(struct obj *obj)
-{
-	edit_dist_expr(&obj->u.arc.width, "Line width");
-}
-
-
-static void arc_op_select(struct inst *self)
-{
-	status_set_xy(self->base);
-	status_set_angle("Angle", "a = %3.1f deg",
-	    self->u.arc.a1 == self->u.arc.a2 ? 360 :
-	    self->u.arc.a2-self->u.arc.a1);
-	set_with_units(status_set_r, "r = ", self->u.arc.r, "Radius");
-	status_set_type_entry(NULL, "width =");
-	set_with_units(status_set_name, "", self->u.arc.width, "Line width");
-	obj_arc_edit(self->obj);
-}
-
-
-static struct inst_ops arc_ops = {
-	.draw		= gui_draw_arc,
-	.distance	= gui_dist_arc,
-	.select		= arc_op_select,
-	.draw_move	= draw_move_arc,
-	.do_move_to	= do_move_to_arc,
-};
-
-
 int inst_arc(struct obj *obj, struct coord center, struct coord start,
     struct coord end, unit_type width)
 {
@@ -1014,7 +317,7 @@ int inst_arc(struct obj *obj, struct coord center, struct coord start,
 
 	a1 = theta(center, start);
 	a2 = theta(center, end);
-	inst = add_inst(&arc_ops,
+	inst = add_inst(it_arc,
 	    fmod(a1, 360) == fmod(a2, 360) ? ip_circ : ip_arc, center);
 	inst->obj = obj;
 	r = hypot(start.x-center.x, start.y-center.y);
@@ -1026,7 +329,6 @@ int inst_arc(struct obj *obj, struct coord center, struct coord start,
 	inst->bbox.max.x = center.x+r;
 	inst->bbox.min.y = center.y-r;
 	inst->bbox.max.y = center.y+r;
-	find_inst(inst);
 	grow_bbox_by_width(&inst->bbox, width);
 	propagate_bbox(inst);
 	return 1;
@@ -1036,42 +338,9 @@ int inst_arc(struct obj *obj, struct coord center, struct coord start,
 /* ----- measurement ------------------------------------------------------- */
 
 
-static void obj_meas_edit(struct obj *obj)
-{
-	edit_dist_expr(&obj->u.meas.offset, "Measurement line offset");
-}
-
-
-static void meas_op_select(struct inst *self)
-{
-	rect_status_sort(self->base, self->u.meas.end, -1, 0);
-	status_set_type_entry(NULL, "offset =");
-	set_with_units(status_set_name, "", self->u.meas.offset,
-	    "Measurement line offset");
-	obj_meas_edit(self->obj);
-}
-
-
-static struct inst_ops meas_ops = {
-	.draw		= gui_draw_meas,
-	.distance	= gui_dist_meas,
-	.select		= meas_op_select,
-	.begin_drag_move= begin_drag_move_meas,
-	.find_point	= find_point_meas_move,
-	.draw_move	= draw_move_meas,
-	.end_drag_move	= end_drag_move_meas,
-	.do_move_to	= do_move_to_meas,
-};
-
-
 struct inst *find_meas_hint(const struct obj *obj)
 {
-	struct inst *inst;
-
-	for (inst = curr_pkg->insts[ip_meas]; inst; inst = inst->next)
-		if (inst->obj == obj)
-			break;
-	return inst;
+	return inst_lookup(curr_pkg, obj, ip_meas, 0);
 }
 
 
@@ -1104,7 +373,7 @@ void inst_meas_hint(struct obj *obj, unit_type offset)
 	inst = find_meas_hint(obj);
 	if (inst)
 		return;
-	inst = add_inst(&meas_ops, ip_meas, zero);
+	inst = add_inst(it_meas, ip_meas, zero);
 	inst->obj = obj;
 	inst->u.meas.offset = offset;
 	inst->u.meas.valid = 0;
@@ -1112,35 +381,6 @@ void inst_meas_hint(struct obj *obj, unit_type offset)
 }
 
 
-/* ----- direct editing of objects ----------------------------------------- */
-
-
-static void obj_edit(struct obj *obj)
-{
-	switch (obj->type) {
-	case ot_frame:
-		break;
-	case ot_line:
-		obj_line_edit(obj);
-		break;
-	case ot_rect:
-		obj_rect_edit(obj);
-		break;
-	case ot_arc:
-		obj_arc_edit(obj);
-		break;
-	case ot_pad:
-		obj_pad_edit(obj);
-		break;
-	case ot_meas:
-		obj_meas_edit(obj);
-		break;
-	default:
-		abort();
-	}
-}
-
-
 /* ----- active instance --------------------------------------------------- */
 
 
@@ -1159,34 +399,16 @@ void inst_end_active(void)
 /* ----- frame ------------------------------------------------------------- */
 
 
-static void frame_op_select(struct inst *self)
-{
-	rect_status(self->bbox.min, self->bbox.max, -1, 0);
-	status_set_type_entry(NULL, "name =");
-	status_set_name("Frame name", "%s", self->u.frame.ref->name);
-}
-
-
-static struct inst_ops frame_ops = {
-	.draw		= gui_draw_frame,
-	.hover		= gui_hover_frame,
-	.distance	= gui_dist_frame,
-	.select		= frame_op_select,
-	.draw_move	= draw_move_frame,
-};
-
-
 void inst_begin_frame(struct obj *obj, struct frame *frame,
     struct coord base, int active, int is_active_frame)
 {
 	struct inst *inst;
 
-	inst = add_inst(&frame_ops, ip_frame, base);
+	inst = add_inst(it_frame, ip_frame, base);
 	inst->obj = obj;
 	inst->u.frame.ref = frame;
 	inst->u.frame.active = is_active_frame;
 	inst->active = active;
-	find_inst(inst);
 	frame_instantiating = inst;
 }
 
@@ -1218,8 +440,10 @@ void inst_select_pkg(const char *name, int active)
 	if (!*pkg) {
 		*pkg = zalloc_type(struct pkg);
 		(*pkg)->name = name;
-		FOR_INST_PRIOS_UP(prio)
+		FOR_INST_PRIOS_UP(prio) {
 			(*pkg)->next_inst[prio] = &(*pkg)->insts[prio];
+			(*pkg)->indexed[prio] = &(*pkg)->insts[prio];
+		}
 		(*pkg)->samples =
 		    zalloc_size(sizeof(struct sample *)*n_samples);
 		(*pkg)->n_samples = n_samples;
@@ -1230,24 +454,44 @@ void inst_select_pkg(const char *name, int active)
 }
 
 
-/* ----- misc. ------------------------------------------------------------- */
+/* ----- capture and replay ----------------------------------------------- */
 
 
-struct bbox inst_get_bbox(const struct pkg *pkg)
-{
-	if (pkg)
-		return pkg->bbox;
-	else
-		return pkgs->insts[ip_frame]->bbox;
-}
+struct inst_capture {
+	int n[ip_n];
+	struct inst *insts[ip_n];	/* relative to the base */
+	int *outer[ip_n];		/* index into ip_frame, -1 if outside */
+};
+
+struct frame_index {
+	const struct inst *inst;
+	int n;
+};
 
 
-static void cleanup_inst(enum inst_prio prio, const struct inst *inst)
+static void shift_inst(struct inst *inst, enum inst_prio prio,
+    struct coord d)
 {
+	inst->base = add_vec(inst->base, d);
+	inst->bbox.min = add_vec(inst->bbox.min, d);
+	inst->bbox.max = add_vec(inst->bbox.max, d);
 	switch (prio) {
 	case ip_pad_copper:
 	case ip_pad_special:
-		free(inst->u.pad.name);
+		inst->u.pad.other = add_vec(inst->u.pad.other, d);
+		break;
+	case ip_hole:
+		inst->u.hole.other = add_vec(inst->u.hole.other, d);
+		break;
+	case ip_rect:
+	case ip_line:
+		inst->u.rect.end = add_vec(inst->u.rect.end, d);
+		break;
+	case ip_meas:
+		inst->u.meas.end = add_vec(inst->u.meas.end, d);
+		break;
+	case ip_vec:
+		inst->u.vec.end = add_vec(inst->u.vec.end, d);
 		break;
 	default:
 		break;
@@ -1255,6 +499,265 @@ static void cleanup_inst(enum inst_prio prio, const struct inst *inst)
 }
 
 
+static int comp_frame_index(const void *a, const void *b)
+{
+	const struct frame_index *fa = a, *fb = b;
+
+	return fa->inst < fb->inst ? -1 : fa->inst > fb->inst;
+}
+
+
+void inst_mark(struct inst_mark *mark)
+{
+	enum inst_prio prio;
+
+	FOR_INST_PRIOS_UP(prio)
+		mark->next_inst[prio] = curr_pkg->next_inst[prio];
+}
+
+
+struct inst_capture *inst_capture(const struct inst_mark *mark,
+    struct coord base)
+{
+	struct inst_capture *cap;
+	struct frame_index *index, key;
+	const struct frame_index *found;
+	const struct inst *inst;
+	struct inst *copy;
+	enum inst_prio prio;
+	int i;
+
+	cap = alloc_type(struct inst_capture);
+	FOR_INST_PRIOS_UP(prio) {
+		cap->n[prio] = 0;
+		for (inst = *mark->next_inst[prio]; inst; inst = inst->next)
+			cap->n[prio]++;
+	}
+
+	index = alloc_size(sizeof(struct frame_index)*cap->n[ip_frame]);
+	i = 0;
+	for (inst = *mark->next_inst[ip_frame]; inst; inst = inst->next) {
+		index[i].inst = inst;
+		index[i].n = i;
+		i++;
+	}
+	qsort(index, cap->n[ip_frame], sizeof(struct frame_index),
+	    comp_frame_index);
+
+	FOR_INST_PRIOS_UP(prio) {
+		cap->insts[prio] =
+		    alloc_size(sizeof(struct inst)*cap->n[prio]);
+		cap->outer[prio] = alloc_size(sizeof(int)*cap->n[prio]);
+		i = 0;
+		for (inst = *mark->next_inst[prio]; inst; inst = inst->next) {
+			copy = cap->insts[prio]+i;
+			*copy = *inst;
+			copy->next = NULL;
+			shift_inst(copy, prio, neg_vec(base));
+			key.inst = inst->outer;
+			found = bsearch(&key, index, cap->n[ip_frame],
+			    sizeof(struct frame_index), comp_frame_index);
+			cap->outer[prio][i] = found ? found->n : -1;
+			i++;
+		}
+	}
+	free(index);
+	return cap;
+}
+
+
+/*
+ * Replaying doesn't reproduce the special case propagate_bbox makes for the
+ * first instance of a package. We therefore refuse to replay into a package
+ * whose bounding box is still empty.
+ */
+
+int inst_replay(const struct inst_capture *cap, struct coord base,
+    struct obj *obj)
+{
+	struct inst **frame_insts;
+	struct inst *inst;
+	enum inst_prio prio;
+	int i;
+
+	if (!curr_pkg->bbox.min.x && !curr_pkg->bbox.min.y &&
+	    !curr_pkg->bbox.max.x && !curr_pkg->bbox.max.y)
+		return 0;
+
+	frame_insts = alloc_size(sizeof(struct inst *)*cap->n[ip_frame]);
+	FOR_INST_PRIOS_UP(prio)
+		for (i = 0; i != cap->n[prio]; i++) {
+			inst = alloc_type(struct inst);
+			*inst = cap->insts[prio][i];
+			shift_inst(inst, prio, base);
+			*curr_pkg->next_inst[prio] = inst;
+			curr_pkg->next_inst[prio] = &inst->next;
+			if (prio == ip_frame)
+				frame_insts[i] = inst;
+			/*
+			 * Frames are added before the frames they contain,
+			 * and ip_frame comes first.
+			 */
+			if (cap->outer[prio][i] < 0) {
+				inst->obj = obj;
+				inst->outer = frame_instantiating;
+				inst->path = frame_path(
+				    frame_instantiating->u.frame.ref);
+				update_bbox(&frame_instantiating->bbox,
+				    inst->bbox.min);
+				update_bbox(&frame_instantiating->bbox,
+				    inst->bbox.max);
+			} else {
+				inst->outer = frame_insts[cap->outer[prio][i]];
+			}
+			update_bbox(&curr_pkg->bbox, inst->bbox.min);
+			update_bbox(&curr_pkg->bbox, inst->bbox.max);
+		}
+	free(frame_insts);
+	return 1;
+}
+
+
+void inst_capture_free(struct inst_capture *cap)
+{
+	enum inst_prio prio;
+
+	FOR_INST_PRIOS_UP(prio) {
+		free(cap->insts[prio]);
+		free(cap->outer[prio]);
+	}
+	free(cap);
+}
+
+
+/* ----- columns ----------------------------------------------------------- */
+
+
+/*
+ * The columns of a priority are allocated in one piece, with the pointers and
+ * doubles ahead of the coordinates, so that all are aligned.
+ */
+
+static void *column(char **p, int n, size_t size, int used)
+{
+	void *col;
+
+	if (!used)
+		return NULL;
+	col = *p;
+	*p += n*size;
+	return col;
+}
+
+
+static void fill_cols(struct inst_cols *c, enum inst_prio prio,
+    struct inst *insts)
+{
+	int pad = prio == ip_pad_copper || prio == ip_pad_special;
+	int arc = prio == ip_circ || prio == ip_arc;
+	int width = arc || prio == ip_line || prio == ip_rect;
+	struct inst *inst;
+	struct coord min, max;
+	size_t size;
+	char *p;
+	int n = 0;
+
+	for (inst = insts; inst; inst = inst->next)
+		n++;
+	c->n = n;
+	if (!n)
+		return;
+
+	size = sizeof(struct inst *)+4*sizeof(unit_type);
+	if (pad)
+		size += sizeof(const char *);
+	if (arc)
+		size += 2*sizeof(double)+sizeof(unit_type);
+	if (width)
+		size += sizeof(unit_type);
+	p = alloc_size(n*size);
+	c->inst = column(&p, n, sizeof(struct inst *), 1);
+	c->name = column(&p, n, sizeof(const char *), pad);
+	c->a1 = column(&p, n, sizeof(double), arc);
+	c->a2 = column(&p, n, sizeof(double), arc);
+	c->ax = column(&p, n, sizeof(unit_type), 1);
+	c->ay = column(&p, n, sizeof(unit_type), 1);
+	c->bx = column(&p, n, sizeof(unit_type), 1);
+	c->by = column(&p, n, sizeof(unit_type), 1);
+	c->width = column(&p, n, sizeof(unit_type), width);
+	c->r = column(&p, n, sizeof(unit_type), arc);
+
+	n = 0;
+	for (inst = insts; inst; inst = inst->next) {
+		c->inst[n] = inst;
+		min = inst->base;
+		switch (prio) {
+		case ip_pad_copper:
+		case ip_pad_special:
+			max = inst->u.pad.other;
+			sort_coord(&min, &max);
+			c->name[n] = inst->u.pad.name;
+			break;
+		case ip_hole:
+			max = inst->u.hole.other;
+			sort_coord(&min, &max);
+			break;
+		case ip_vec:
+			max = inst->u.vec.end;
+			break;
+		case ip_line:
+		case ip_rect:
+			max = inst->u.rect.end;
+			c->width[n] = inst->u.rect.width;
+			break;
+		case ip_circ:
+		case ip_arc:
+			max = min;
+			c->a1[n] = inst->u.arc.a1;
+			c->a2[n] = inst->u.arc.a2;
+			c->width[n] = inst->u.arc.width;
+			c->r[n] = inst->u.arc.r;
+			break;
+		default:
+			abort();
+		}
+		c->ax[n] = min.x;
+		c->ay[n] = min.y;
+		c->bx[n] = max.x;
+		c->by[n] = max.y;
+		n++;
+	}
+}
+
+
+void inst_columns(void)
+{
+	static const enum inst_prio prios[] = {
+		ip_pad_copper, ip_pad_special, ip_hole,
+		ip_circ, ip_arc, ip_rect, ip_line, ip_vec
+	};
+	struct pkg *pkg;
+	int i;
+
+	for (pkg = pkgs; pkg; pkg = pkg->next)
+		for (i = 0; i != sizeof(prios)/sizeof(*prios); i++)
+			fill_cols(pkg->cols+prios[i], prios[i],
+			    pkg->insts[prios[i]]);
+}
+
+
+/* ----- misc. ------------------------------------------------------------- */
+
+
+struct bbox inst_get_bbox(const struct pkg *pkg)
+{
+	if (pkg)
+		return pkg->bbox;
+	else
+		return pkgs->insts[ip_frame]->bbox;
+}
+
+
 static void free_pkgs(struct pkg *pkg)
 {
 	enum inst_prio prio;
@@ -1263,20 +766,56 @@ static void free_pkgs(struct pkg *pkg)
 
 	while (pkg) {
 		next_pkg = pkg->next;
-		FOR_INST_PRIOS_UP(prio)
+		FOR_INST_PRIOS_UP(prio) {
 			for (inst = pkg->insts[prio]; inst; inst = next) {
 				next = inst->next;
-				cleanup_inst(prio, inst);
 				free(inst);
 			}
+			free(pkg->cols[prio].inst);
+		}
 		reset_samples(pkg->samples, pkg->n_samples);
 		free(pkg->samples);
+		if (pkg->index)
+			hash_free(pkg->index, free);
+		free(pkg->drc);
 		free(pkg);
 		pkg = next_pkg;
 	}
 }
 
 
+/*
+ * Paths are allocated in one piece, with the arrays following the header.
+ */
+
+struct inst_path *inst_new_path(int n_rows, int n_loops)
+{
+	struct inst_path *path;
+
+	path = alloc_size(sizeof(struct inst_path)+
+	    sizeof(struct row *)*n_rows+sizeof(int)*n_loops);
+	path->rows = (struct row **) (path+1);
+	path->n_rows = n_rows;
+	path->iterations = (int *) (path->rows+n_rows);
+	path->n_loops = n_loops;
+	path->next = paths;
+	paths = path;
+	return path;
+}
+
+
+static void free_paths(struct inst_path *path)
+{
+	struct inst_path *next;
+
+	while (path) {
+		next = path->next;
+		free(path);
+		path = next;
+	}
+}
+
+
 void inst_start(void)
 {
 	static struct bbox bbox_zero = { { 0, 0 }, { 0, 0 }};
@@ -1285,6 +824,10 @@ void inst_start(void)
 	prev_pkgs = pkgs;
 	prev_reachable_pkg = reachable_pkg;
 	pkgs = NULL;
+	prev_pad_names = pad_names;
+	pad_names = strpool_new();
+	prev_paths = paths;
+	paths = NULL;
 	reachable_pkg = NULL;
 	inst_select_pkg(NULL, 0);
 	curr_pkg = pkgs;
@@ -1304,120 +847,25 @@ void inst_commit(void)
 	if (!active_pkg)
 		active_pkg = pkgs->next;
 	free_pkgs(prev_pkgs);
+	strpool_free(prev_pad_names);
+	free_paths(prev_paths);
 }
 
 
 void inst_revert(void)
 {
 	free_pkgs(pkgs);
+	strpool_free(pad_names);
+	free_paths(paths);
 	pkgs = prev_pkgs;
+	pad_names = prev_pad_names;
+	paths = prev_paths;
 	reachable_pkg = prev_reachable_pkg;
 }
 
 
-void inst_draw(void)
-{
-	enum inst_prio prio;
-	struct inst *inst;
-	int i;
-
-	FOR_INST_PRIOS_UP(prio)
-		FOR_ALL_INSTS(i, prio, inst)
-			if (show_this(inst))
-				if (show(prio) && !inst->active &&
-				    inst->ops->draw)
-					inst->ops->draw(inst);
-	FOR_INST_PRIOS_UP(prio)
-		FOR_ALL_INSTS(i, prio, inst)
-			if (show(prio) && prio != ip_frame && inst->active &&
-			    inst != selected_inst && inst->ops->draw)
-				inst->ops->draw(inst);
-	if (show_stuff)
-		FOR_ALL_INSTS(i, ip_frame, inst)
-			if (inst->active && inst != selected_inst &&
-			    inst->ops->draw)
-				inst->ops->draw(inst);
-	if (selected_inst && selected_inst->ops->draw)
-		selected_inst->ops->draw(selected_inst);
-}
-
-
-void inst_highlight_vecs(int (*pick)(struct inst *inst, void *user), void *user)
-{
-	struct inst *inst;
-	int i;
-
-	FOR_ALL_INSTS(i, ip_vec, inst) {
-		inst->u.vec.highlighted = pick(inst, user);
-		if (inst->u.vec.highlighted)
-			gui_highlight_vec(inst);
-	}
-}
-
-
-struct inst *inst_find_vec(struct coord pos,
-    int (*pick)(struct inst *inst, void *user), void *user)
-{
-	struct inst *inst, *found;
-	int best_dist = 0; /* keep gcc happy */
-	int dist, i;
-
-	found = NULL;
-	FOR_ALL_INSTS(i, ip_vec, inst) {
-		if (!inst->ops->distance)
-			continue;
-		dist = inst->ops->distance(inst, pos, draw_ctx.scale);
-		if (dist < 0 || (found && best_dist <= dist))
-			continue;
-		if (!pick(inst, user))
-			continue;
-		found = inst;
-		best_dist = dist;
-	}
-	return found;
-}
-
-
 struct inst *insts_ip_vec(void)
 {
 	return active_pkg->insts[ip_vec];
 }
 
-
-struct pix_buf *inst_draw_move(struct inst *inst, struct coord pos, int i)
-{
-	return inst->ops->draw_move(inst, pos, i);
-}
-
-
-int inst_do_move_to(struct inst *inst, struct inst *to, int i)
-{
-	if (!inst->ops->do_move_to)
-		return 0;
-	inst->ops->do_move_to(inst, to, i);
-	return 1;
-}
-
-
-struct pix_buf *inst_hover(struct inst *inst)
-{
-	if (!inst->ops->hover)
-		return NULL;
-	return inst->ops->hover(inst);
-}
-
-
-void inst_begin_drag_move(struct inst *inst, int i)
-{
-	if (inst->ops->begin_drag_move)
-		inst->ops->begin_drag_move(inst, i);
-}
-
-
-void inst_delete(struct inst *inst)
-{
-	if (inst->ops == &vec_ops)
-		delete_vec(inst->vec);
-	else
-		delete_obj(inst->obj);
-}
@@ -22,6 +22,22 @@
 #include "meas.h"
 
 
+struct hash;
+struct drc_violation;
+
+/*
+ * The table rows and loop iterations of a frame that were current when
+ * generating an instance. See frame_path in obj.c.
+ */
+
+struct inst_path {
+	struct row **rows;	/* one per table */
+	int n_rows;
+	int *iterations;	/* one per loop */
+	int n_loops;
+	struct inst_path *next;	/* for deallocation */
+};
+
 enum mode {
 	mode_inactive,		/* on inactive frame */
 	mode_active,		/* on active frame */
@@ -51,34 +67,28 @@ enum inst_prio {
 };
 
 
-struct inst;
-
-
-struct inst_ops {
-	void (*debug)(struct inst *self);
-	void (*save)(FILE *file, struct inst *self);
-	void (*draw)(struct inst *self);
-	struct pix_buf *(*hover)(struct inst *self);
-	unit_type (*distance)(struct inst *self, struct coord pos,
-	    unit_type scale);
-	void (*select)(struct inst *self);
-	void (*begin_drag_move)(struct inst *from, int i);
-	struct inst *(*find_point)(struct inst *self, struct coord pos);
-	struct pix_buf *(*draw_move)(struct inst *inst,
-	    struct coord pos, int i);
-	void (*end_drag_move)(void);
-	/* arcs and measurements need this special override */
-	void (*do_move_to)(struct inst *inst, struct inst *to, int i);
+enum inst_type {
+	it_vec,
+	it_line,
+	it_rect,
+	it_pad,
+	it_rpad,
+	it_hole,
+	it_arc,		/* arcs and circles */
+	it_meas,
+	it_frame,
+	it_n		/* number of types */
 };
 
 struct inst {
-	const struct inst_ops *ops;
+	enum inst_type type;
 	enum inst_prio prio; /* currently only used for icon selection */
 	struct coord base;
 	struct bbox bbox;
 	struct vec *vec; /* NULL if not vector */
 	struct obj *obj; /* NULL if not object */
 	struct inst *outer; /* frame containing this item */
+	const struct inst_path *path; /* choices in "outer", NULL if none */
 	int active;
 	union {
 		struct {
@@ -95,7 +105,7 @@ struct inst {
 			struct coord end;
 		} rect;
 		struct {
-			char *name;
+			const char *name; /* equal names share the pointer */
 			struct coord other;
 			layer_type layers; /* bit-set of layers */
 			struct inst *hole; /* through-hole or NULL */
@@ -120,6 +130,40 @@ struct inst {
 };
 
 
+/*
+ * The vectors, pads, holes, and silk screen items of a package, with one array
+ * per field, in the order of the instance list. For vectors, "a" is the base
+ * and "b" the end. For pads and holes, they are the lower left and the upper
+ * right corner, for lines and rectangles the end points, and for circles and
+ * arcs both are the center.
+ *
+ * Link and layer changes after instantiation go to the instances.
+ */
+
+struct inst_cols {
+	int n;
+	struct inst **inst;
+	const char **name;	/* pads */
+	double *a1, *a2;	/* circles and arcs */
+	unit_type *ax, *ay, *bx, *by;
+	unit_type *width;	/* lines, rectangles, circles, and arcs */
+	unit_type *r;		/* circles and arcs */
+};
+
+
+/*
+ * inst_cols_apart returns 1 if the boxes of the items "i" in "a" and "j" in
+ * "b" don't touch. Pads and holes in such boxes can't overlap.
+ */
+
+static inline int inst_cols_apart(const struct inst_cols *a, int i,
+    const struct inst_cols *b, int j)
+{
+	return a->bx[i] < b->ax[j] || b->bx[j] < a->ax[i] ||
+	    a->by[i] < b->ay[j] || b->by[j] < a->ay[i];
+}
+
+
 struct pkg {
 	const char *name;	/* NULL if global package */
 	struct inst *insts[ip_n];
@@ -127,11 +171,15 @@ struct pkg {
 	struct bbox bbox;	/* bbox only of items in this package */
 	struct sample **samples;
 	int n_samples;
+	struct hash *index;	/* instances by vector or object, see inst.c */
+	struct inst **indexed[ip_n]; /* instances before this are indexed */
+	struct inst_cols cols[ip_n]; /* see inst_columns */
+	struct drc_violation *drc; /* see drc_check */
+	int n_drc;
 	struct pkg *next;
 };
 
 
-extern struct inst *selected_inst;
 extern struct pkg *pkgs;	/* list of packages */
 extern struct pkg *active_pkg;	/* package selected in GUI */
 extern struct pkg *curr_pkg;	/* package currently being instantiated */
@@ -164,21 +212,6 @@ extern struct inst *frame_instantiating;
 		FOR_PKG_INSTS(i ? active_pkg : pkgs, prio, inst)
 
 
-int bright(const struct inst *inst);
-
-void inst_select_outside(void *item, void (*deselect)(void *item));
-int inst_select(struct coord pos);
-void inst_deselect(void);
-
-void inst_select_vec(struct vec *vec);
-void inst_select_obj(struct obj *obj);
-
-struct inst *inst_find_point(struct coord pos);
-int inst_find_point_selected(struct coord pos, struct inst **res);
-struct coord inst_get_point(const struct inst *inst);
-int inst_anchors(struct inst *inst, struct vec ***anchors);
-struct vec *inst_get_vec(const struct inst *inst);
-
 int inst_vec(struct vec *vec, struct coord base);
 int inst_line(struct obj *obj, struct coord a, struct coord b, unit_type width);
 int inst_rect(struct obj *obj, struct coord a, struct coord b, unit_type width);
@@ -199,23 +232,51 @@ void inst_end_frame(const struct frame *frame);
 
 void inst_select_pkg(const char *name, int active);
 
+/*
+ * inst_lookup returns the first instance of a vector or object in the package,
+ * or the first active one if "active" is set. It returns NULL if there is
+ * none.
+ */
+
+struct inst *inst_lookup(struct pkg *pkg, const void *item,
+    enum inst_prio prio, int active);
+
+/*
+ * inst_mark remembers where the next instances of the current package will
+ * go. inst_capture copies all instances added since then, relative to "base",
+ * and inst_replay adds these copies again at a new base, as if the frame at
+ * the top of the capture had been instantiated there, through the frame
+ * reference "obj". inst_replay returns 0 if it can't do this.
+ */
+
+struct inst_mark {
+	struct inst **next_inst[ip_n];
+};
+
+struct inst_capture;
+
+void inst_mark(struct inst_mark *mark);
+struct inst_capture *inst_capture(const struct inst_mark *mark,
+    struct coord base);
+int inst_replay(const struct inst_capture *cap, struct coord base,
+    struct obj *obj);
+void inst_capture_free(struct inst_capture *cap);
+
 struct bbox inst_get_bbox(const struct pkg *pkg);
 
+/*
+ * inst_columns fills the "cols" of all packages once the vectors, pads, holes,
+ * and silk screen items are all in place.
+ */
+
+void inst_columns(void);
+
+struct inst_path *inst_new_path(int n_rows, int n_loops);
+
 void inst_start(void);
 void inst_commit(void);
 void inst_revert(void);
 
-void inst_draw(void);
-void inst_highlight_vecs(int (*pick)(struct inst *inst, void *user),
-     void *user);
-struct inst *inst_find_vec(struct coord pos,
-    int (*pick)(struct inst *inst, void *user), void *user);
 struct inst *insts_ip_vec(void);
 
-struct pix_buf *inst_draw_move(struct inst *inst, struct coord pos, int i);
-int inst_do_move_to(struct inst *inst, struct inst *to, int i);
-struct pix_buf *inst_hover(struct inst *inst);
-void inst_begin_drag_move(struct inst *inst, int i);
-void inst_delete(struct inst *inst);
-
 #endif /* !INST_H */
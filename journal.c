@@ -0,0 +1,307 @@
+/*
+ * journal.c - Journal of changes, for undo and redo
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Each step is the list of changes made between two calls to journal_commit.
+ * Undoing a step reverts its changes from last to first, redoing it applies
+ * them again from first to last. Both only touch what the step has recorded.
+ *
+ * For stored bytes, we pick up the new value when undoing. Thus redoing also
+ * restores values that a function-based change may have set differently.
+ *
+ * Once the user has made a new change, the steps that have been undone can't
+ * be redone anymore and we forget them.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+#include "journal.h"
+
+
+struct change {
+	enum change_type {
+		ct_store,
+		ct_replace,
+		ct_call,
+	} type;
+	void *p;		/* ct_store and ct_replace */
+	union {
+		struct {
+			size_t size;
+			char *saved;	/* old bytes, then new bytes */
+		} store;
+		struct {
+			void *old, *new;
+			void (*free_old)(void *item);
+			void (*free_new)(void *item);
+		} replace;
+		struct {
+			void (*undo)(void *user);
+			void (*redo)(void *user);
+			void *user;
+		} call;
+	} u;
+};
+
+struct step {
+	struct change *changes;
+	int n;
+	struct step *next;
+};
+
+
+static struct step *done = NULL;	/* most recent first */
+static struct step *undone = NULL;	/* most recently undone first */
+static struct step *curr = NULL;	/* not committed yet */
+static int recording = 0;
+static int busy = 0;		/* undoing, redoing, or forgetting */
+
+
+/* ----- forgetting -------------------------------------------------------- */
+
+
+static void forget_change(struct change *c, int is_done)
+{
+	switch (c->type) {
+	case ct_store:
+		free(c->u.store.saved);
+		break;
+	case ct_replace:
+		if (is_done) {
+			if (c->u.replace.free_old && c->u.replace.old)
+				c->u.replace.free_old(c->u.replace.old);
+		} else {
+			if (c->u.replace.free_new && c->u.replace.new)
+				c->u.replace.free_new(c->u.replace.new);
+		}
+		break;
+	case ct_call:
+		free(c->u.call.user);
+		break;
+	default:
+		abort();
+	}
+}
+
+
+static void forget_step(struct step *step, int is_done)
+{
+	int i;
+
+	for (i = 0; i != step->n; i++)
+		forget_change(step->changes+i, is_done);
+	free(step->changes);
+	free(step);
+}
+
+
+static void forget_steps(struct step **steps, int is_done)
+{
+	struct step *next;
+
+	busy++;
+	while (*steps) {
+		next = (*steps)->next;
+		forget_step(*steps, is_done);
+		*steps = next;
+	}
+	busy--;
+}
+
+
+/* ----- recording --------------------------------------------------------- */
+
+
+static struct change *new_change(enum change_type type)
+{
+	struct change *c;
+
+	if (!recording || busy)
+		return NULL;
+	forget_steps(&undone, 0);
+	if (!curr)
+		curr = zalloc_type(struct step);
+	curr->changes = realloc(curr->changes,
+	    sizeof(struct change)*(curr->n+1));
+	if (!curr->changes)
+		abort();
+	c = curr->changes+curr->n++;
+	c->type = type;
+	return c;
+}
+
+
+void journal_store(void *p, size_t size)
+{
+	struct change *c;
+
+	c = new_change(ct_store);
+	if (!c)
+		return;
+	c->p = p;
+	c->u.store.size = size;
+	c->u.store.saved = alloc_size(2*size);
+	memcpy(c->u.store.saved, p, size);
+}
+
+
+void journal_replace(void *anchor, void *item,
+    void (*free_old)(void *item), void (*free_new)(void *item))
+{
+	struct change *c;
+	void *old;
+
+	memcpy(&old, anchor, sizeof(void *));
+	memcpy(anchor, &item, sizeof(void *));
+	c = new_change(ct_replace);
+	if (!c) {
+		if (free_old && old)
+			free_old(old);
+		return;
+	}
+	c->p = anchor;
+	c->u.replace.old = old;
+	c->u.replace.new = item;
+	c->u.replace.free_old = free_old;
+	c->u.replace.free_new = free_new;
+}
+
+
+void journal_call(void (*undo)(void *user), void (*redo)(void *user),
+    void *user)
+{
+	struct change *c;
+
+	c = new_change(ct_call);
+	if (!c) {
+		free(user);
+		return;
+	}
+	c->u.call.undo = undo;
+	c->u.call.redo = redo;
+	c->u.call.user = user;
+}
+
+
+/* ----- undo and redo ----------------------------------------------------- */
+
+
+static void undo_change(struct change *c)
+{
+	size_t size;
+
+	switch (c->type) {
+	case ct_store:
+		size = c->u.store.size;
+		memcpy(c->u.store.saved+size, c->p, size);
+		memcpy(c->p, c->u.store.saved, size);
+		break;
+	case ct_replace:
+		memcpy(c->p, &c->u.replace.old, sizeof(void *));
+		break;
+	case ct_call:
+		c->u.call.undo(c->u.call.user);
+		break;
+	default:
+		abort();
+	}
+}
+
+
+static void redo_change(struct change *c)
+{
+	switch (c->type) {
+	case ct_store:
+		memcpy(c->p, c->u.store.saved+c->u.store.size,
+		    c->u.store.size);
+		break;
+	case ct_replace:
+		memcpy(c->p, &c->u.replace.new, sizeof(void *));
+		break;
+	case ct_call:
+		c->u.call.redo(c->u.call.user);
+		break;
+	default:
+		abort();
+	}
+}
+
+
+void journal_commit(void)
+{
+	if (!curr)
+		return;
+	curr->next = done;
+	done = curr;
+	curr = NULL;
+}
+
+
+int journal_undo(void)
+{
+	struct step *step;
+	int i;
+
+	journal_commit();
+	if (!done)
+		return 0;
+	step = done;
+	done = step->next;
+	busy++;
+	for (i = step->n-1; i >= 0; i--)
+		undo_change(step->changes+i);
+	busy--;
+	step->next = undone;
+	undone = step;
+	return 1;
+}
+
+
+int journal_redo(void)
+{
+	struct step *step;
+	int i;
+
+	journal_commit();
+	if (!undone)
+		return 0;
+	step = undone;
+	undone = step->next;
+	busy++;
+	for (i = 0; i != step->n; i++)
+		redo_change(step->changes+i);
+	busy--;
+	step->next = done;
+	done = step;
+	return 1;
+}
+
+
+/* ----- setup and cleanup ------------------------------------------------- */
+
+
+void journal_start(void)
+{
+	recording = 1;
+}
+
+
+void journal_stop(void)
+{
+	journal_commit();
+	forget_steps(&done, 1);
+	forget_steps(&undone, 0);
+	recording = 0;
+}
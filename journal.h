@@ -0,0 +1,51 @@
+/*
+ * journal.h - Journal of changes, for undo and redo
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stddef.h>
+
+
+/*
+ * journal_store saves the "size" bytes at "p", which the caller is about to
+ * change.
+ *
+ * journal_replace stores "item" in the pointer at "anchor". free_old is used
+ * to free the previous pointer and free_new to free "item" once the journal
+ * no longer needs them. Either function can be NULL if the journal doesn't own
+ * the respective item, e.g., when linking a new item into a list.
+ *
+ * journal_call records a change that is undone and redone by calling a
+ * function. "user" is freed with free() when the journal forgets the change.
+ */
+
+void journal_store(void *p, size_t size);
+void journal_replace(void *anchor, void *item,
+    void (*free_old)(void *item), void (*free_new)(void *item));
+void journal_call(void (*undo)(void *user), void (*redo)(void *user),
+    void *user);
+
+/*
+ * journal_commit ends the current step. journal_undo and journal_redo return
+ * 0 if there is nothing to undo or redo.
+ */
+
+void journal_commit(void);
+int journal_undo(void);
+int journal_redo(void);
+
+void journal_start(void);
+void journal_stop(void);
+
+#endif /* !JOURNAL_H */
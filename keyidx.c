@@ -0,0 +1,365 @@
+/*
+ * keyidx.c - Index of table rows by key
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * match_keys compares the keys only after all the tables and loops of a frame
+ * have been iterated over. For a table whose key variable is set outside the
+ * frame, the value we compare with is the same for all rows, and the rows
+ * that can match are easy to find if their key is a constant.
+ *
+ * The index only has to select a superset of the rows var_eq would accept.
+ * We therefore index numbers by their value in mm and strings by the string
+ * var_eq compares. Rows whose key is an expression are always returned.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+#include "error.h"
+#include "coord.h"
+#include "expr.h"
+#include "hash.h"
+#include "obj.h"
+#include "keyidx.h"
+
+
+#define	MIN_ROWS	8	/* don't bother indexing smaller tables */
+
+
+enum key_kind {
+	kk_str,		/* string key, by string */
+	kk_num_str,	/* numeric key, by string */
+	kk_num,		/* numeric key, by value */
+};
+
+struct key_entry {
+	enum key_kind kind;
+	const char *s;		/* kk_str and kk_num_str */
+	int exponent;		/* kk_num */
+	double n;		/* kk_num, in mm */
+	int *rows;		/* row numbers */
+	int n_rows;
+};
+
+struct key_index {
+	const char *name;	/* NULL if we can't use the index */
+	struct row **rows;
+	int n_rows;
+	int *dynamic;		/* rows whose key isn't a constant */
+	int n_dynamic;
+	struct hash *hash;
+};
+
+
+/* ----- hashing ----------------------------------------------------------- */
+
+
+static unsigned hash_key(const void *item)
+{
+	const struct key_entry *e = item;
+	unsigned h;
+
+	h = hash_bytes(HASH_INIT, &e->kind, sizeof(e->kind));
+	if (e->kind == kk_num) {
+		h = hash_bytes(h, &e->exponent, sizeof(e->exponent));
+		return hash_bytes(h, &e->n, sizeof(e->n));
+	}
+	return hash_str(h, e->s);
+}
+
+
+static int eq_key(const void *a, const void *b)
+{
+	const struct key_entry *ea = a, *eb = b;
+
+	if (ea->kind != eb->kind)
+		return 0;
+	if (ea->kind == kk_num)
+		return ea->exponent == eb->exponent && ea->n == eb->n;
+	return !strcmp(ea->s, eb->s);
+}
+
+
+static void free_key(void *item)
+{
+	struct key_entry *e = item;
+
+	if (e->kind != kk_num)
+		free((void *) e->s);
+	free(e->rows);
+	free(e);
+}
+
+
+/*
+ * See num_eq. Adding zero turns -0 into 0, so that both hash alike.
+ */
+
+static void num_key(struct key_entry *key, struct num num)
+{
+	key->kind = kk_num;
+	key->exponent = num.exponent;
+	key->n = num.n;
+	if (num.exponent && num.type == nt_mil)
+		key->n = mil_to_mm(num.n, num.exponent);
+	key->n += 0.0;
+}
+
+
+static void add_row(struct hash *hash, const struct key_entry *key, int row)
+{
+	struct key_entry *e;
+
+	e = hash_lookup(hash, key);
+	if (!e) {
+		e = alloc_type(struct key_entry);
+		*e = *key;
+		if (e->kind != kk_num)
+			e->s = stralloc(e->s);
+		e->rows = NULL;
+		e->n_rows = 0;
+		hash_add(hash, e);
+	}
+	e->rows = realloc(e->rows, sizeof(int)*(e->n_rows+1));
+	if (!e->rows)
+		abort();
+	e->rows[e->n_rows++] = row;
+}
+
+
+/* ----- building the index ------------------------------------------------ */
+
+
+int bound_in_frame(const struct frame *frame, const char *name)
+{
+	const struct table *table;
+	const struct loop *loop;
+	const struct var *var;
+
+	for (table = frame->tables; table; table = table->next)
+		for (var = table->vars; var; var = var->next)
+			if (!var->key && var->name == name)
+				return 1;
+	for (loop = frame->loops; loop; loop = loop->next)
+		if (loop->var.name == name)
+			return 1;
+	return 0;
+}
+
+
+static int frame_var(const char *name, void *user)
+{
+	return bound_in_frame(user, name);
+}
+
+
+/*
+ * var_eq is only reached after running the loops, which may fail. If the loop
+ * bounds don't depend on the current row, it is enough to run them for the
+ * rows we return.
+ */
+
+static int loops_depend_on_rows(const struct frame *frame)
+{
+	const struct loop *loop;
+
+	for (loop = frame->loops; loop; loop = loop->next)
+		if (expr_vars(loop->from.expr, frame_var, (void *) frame) ||
+		    expr_vars(loop->to.expr, frame_var, (void *) frame))
+			return 1;
+	return 0;
+}
+
+
+static void index_rows(struct key_index *idx, int col)
+{
+	struct key_entry key;
+	const struct value *value;
+	int i, j;
+
+	idx->hash = hash_new(hash_key, eq_key);
+	for (i = 0; i != idx->n_rows; i++) {
+		value = idx->rows[i]->values;
+		for (j = 0; j != col; j++)
+			value = value->next;
+		if (value->expr->op == op_string) {
+			key.kind = kk_str;
+			key.s = value->expr->u.str;
+			add_row(idx->hash, &key, i);
+		} else if (value->expr->op == op_num) {
+			num_key(&key, value->expr->u.num);
+			add_row(idx->hash, &key, i);
+			key.kind = kk_num_str;
+			key.s = num_to_string(value->expr->u.num);
+			add_row(idx->hash, &key, i);
+		} else {
+			idx->dynamic = realloc(idx->dynamic,
+			    sizeof(int)*(idx->n_dynamic+1));
+			if (!idx->dynamic)
+				abort();
+			idx->dynamic[idx->n_dynamic++] = i;
+		}
+	}
+}
+
+
+static struct key_index *build_index(const struct frame *frame,
+    const struct table *table)
+{
+	struct key_index *idx;
+	const struct var *var;
+	const struct row *row;
+	int col = 0;
+
+	idx = zalloc_type(struct key_index);
+	for (var = table->vars; var; var = var->next) {
+		if (var->key)
+			break;
+		col++;
+	}
+	if (!var || bound_in_frame(frame, var->name) ||
+	    loops_depend_on_rows(frame))
+		return idx;
+	for (row = table->rows; row; row = row->next)
+		idx->n_rows++;
+	if (idx->n_rows < MIN_ROWS)
+		return idx;
+	idx->name = var->name;
+	idx->rows = alloc_size(sizeof(struct row *)*idx->n_rows);
+	idx->n_rows = 0;
+	for (row = table->rows; row; row = row->next)
+		idx->rows[idx->n_rows++] = (struct row *) row;
+	index_rows(idx, col);
+	return idx;
+}
+
+
+/* ----- lookup ------------------------------------------------------------ */
+
+
+struct candidates {
+	int *rows;
+	int n;
+};
+
+
+static void add_candidates(struct candidates *c, const int *rows, int n)
+{
+	c->rows = realloc(c->rows, sizeof(int)*(c->n+n));
+	if (!c->rows)
+		abort();
+	memcpy(c->rows+c->n, rows, sizeof(int)*n);
+	c->n += n;
+}
+
+
+static void lookup(const struct key_index *idx, struct candidates *c,
+    const struct key_entry *key)
+{
+	const struct key_entry *e;
+
+	e = hash_lookup(idx->hash, key);
+	if (e)
+		add_candidates(c, e->rows, e->n_rows);
+}
+
+
+static int comp_int(const void *a, const void *b)
+{
+	return *(const int *) a - *(const int *) b;
+}
+
+
+/*
+ * We also return the active row, so that its loops are still run if it
+ * doesn't match.
+ */
+
+static struct row **select_rows(const struct key_index *idx,
+    const struct table *table, struct candidates *c)
+{
+	struct row **res;
+	int i, n = 0;
+
+	add_candidates(c, idx->dynamic, idx->n_dynamic);
+	for (i = 0; i != idx->n_rows; i++)
+		if (idx->rows[i] == table->active_row) {
+			add_candidates(c, &i, 1);
+			break;
+		}
+	qsort(c->rows, c->n, sizeof(int), comp_int);
+	res = alloc_size(sizeof(struct row *)*(c->n+1));
+	for (i = 0; i != c->n; i++)
+		if (!i || c->rows[i] != c->rows[i-1])
+			res[n++] = idx->rows[c->rows[i]];
+	res[n] = NULL;
+	free(c->rows);
+	return res;
+}
+
+
+struct row **key_rows(const struct frame *frame, struct table *table)
+{
+	void (*saved_reporter)(const char *s) = reporter;
+	struct candidates c = { NULL, 0 };
+	struct key_entry key;
+	const char *s;
+	struct num num;
+
+	if (!table->index)
+		table->index = build_index(frame, table);
+	if (!table->index->name)
+		return NULL;
+
+	/*
+	 * If the variable is undefined, we let var_eq report it.
+	 */
+	reporter = report_nothing;
+	s = eval_string_var(frame, table->index->name);
+	if (!s)
+		num = eval_var(frame, table->index->name);
+	reporter = saved_reporter;
+	if (!s && is_undef(num))
+		return NULL;
+
+	if (s) {
+		key.kind = kk_str;
+		key.s = s;
+		lookup(table->index, &c, &key);
+		key.kind = kk_num_str;
+		lookup(table->index, &c, &key);
+	} else {
+		num_key(&key, num);
+		lookup(table->index, &c, &key);
+		key.kind = kk_str;
+		key.s = num_to_string(num);
+		lookup(table->index, &c, &key);
+	}
+	return select_rows(table->index, table, &c);
+}
+
+
+void key_index_free(struct table *table)
+{
+	struct key_index *idx = table->index;
+
+	if (!idx)
+		return;
+	if (idx->hash)
+		hash_free(idx->hash, free_key);
+	free(idx->rows);
+	free(idx->dynamic);
+	free(idx);
+	table->index = NULL;
+}
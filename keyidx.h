@@ -0,0 +1,37 @@
+/*
+ * keyidx.h - Index of table rows by key
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef KEYIDX_H
+#define KEYIDX_H
+
+#include "obj.h"
+
+
+/*
+ * key_rows returns a NULL-terminated list of the rows of "table" that may
+ * match the key, in table order, or NULL if all rows have to be tried. The
+ * caller still has to compare the keys of the rows returned, and has to free
+ * the list.
+ */
+
+struct row **key_rows(const struct frame *frame, struct table *table);
+void key_index_free(struct table *table);
+
+/*
+ * bound_in_frame returns whether a table or a loop of "frame" sets "name". Key
+ * columns don't count.
+ */
+
+int bound_in_frame(const struct frame *frame, const char *name);
+
+#endif /* !KEYIDX_H */
@@ -27,15 +27,15 @@ static unit_type zeroize(unit_type n)
 }
 
 
-static void kicad_centric(struct coord a, struct coord b,
-    struct coord *center, struct coord *size)
+static void kicad_centric(unit_type ax, unit_type ay, unit_type bx,
+    unit_type by, struct coord *center, struct coord *size)
 {
 	struct coord min, max;
 
-	min.x = units_to_kicad(a.x);
-	min.y = units_to_kicad(a.y);
-	max.x = units_to_kicad(b.x);
-	max.y = units_to_kicad(b.y);
+	min.x = units_to_kicad(ax);
+	min.y = units_to_kicad(ay);
+	max.x = units_to_kicad(bx);
+	max.y = units_to_kicad(by);
 
 	sort_coord(&min, &max);
 
@@ -54,7 +54,8 @@ static void do_drill(FILE *file, const struct inst *pad, struct coord *ref)
 	if (!hole)
 		return;
 
-	kicad_centric(hole->base, hole->u.hole.other, &center, &size);
+	kicad_centric(hole->base.x, hole->base.y,
+	    hole->u.hole.other.x, hole->u.hole.other.y, &center, &size);
 
 	/* Allow for rounding errors  */
 
@@ -67,11 +68,12 @@ static void do_drill(FILE *file, const struct inst *pad, struct coord *ref)
 }
 
 
-static void kicad_pad(FILE *file, const struct inst *inst)
+static void kicad_pad(FILE *file, const struct inst_cols *c, int i)
 {
+	const struct inst *inst = c->inst[i];
 	struct coord center, size;
 
-	kicad_centric(inst->base, inst->u.pad.other, &center, &size);
+	kicad_centric(c->ax[i], c->ay[i], c->bx[i], c->by[i], &center, &size);
 
 	fprintf(file, "$PAD\n");
 
@@ -79,7 +81,7 @@ static void kicad_pad(FILE *file, const struct inst *inst)
 	 * name, shape (rectangle), Xsize, Ysize, Xdelta, Ydelta, Orientation
 	 */
 	fprintf(file, "Sh \"%s\" %c %d %d 0 0 0\n",
-	    inst->u.pad.name, inst->obj->u.pad.rounded ? 'O' : 'R',
+	    c->name[i], inst->obj->u.pad.rounded ? 'O' : 'R',
 	    size.x, size.y);
 
 	/*
@@ -102,13 +104,14 @@ static void kicad_pad(FILE *file, const struct inst *inst)
 }
 
 
-static void kicad_hole(FILE *file, const struct inst *inst)
+static void kicad_hole(FILE *file, const struct inst_cols *c, int i)
 {
+	const struct inst *inst = c->inst[i];
 	struct coord center, size;
 
 	if (inst->u.hole.pad)
 		return;
-	kicad_centric(inst->base, inst->u.hole.other, &center, &size);
+	kicad_centric(c->ax[i], c->ay[i], c->bx[i], c->by[i], &center, &size);
 	fprintf(file, "$PAD\n");
 	if (size.x < size.y-1 || size.x > size.y+1) {
 		fprintf(file, "Sh \"HOLE\" O %d %d 0 0 0\n", size.x, size.y);
@@ -123,31 +126,31 @@ static void kicad_hole(FILE *file, const struct inst *inst)
 }
 
 
-static void kicad_line(FILE *file, const struct inst *inst)
+static void kicad_line(FILE *file, const struct inst_cols *c, int i)
 {
 	/*
 	 * Xstart, Ystart, Xend, Yend, Width, Layer
 	 */
 	fprintf(file, "DS %d %d %d %d %d %d\n",
-	    units_to_kicad(inst->base.x),
-	    -units_to_kicad(inst->base.y),
-	    units_to_kicad(inst->u.rect.end.x),
-	    -units_to_kicad(inst->u.rect.end.y),
-	    units_to_kicad(inst->u.rect.width),
+	    units_to_kicad(c->ax[i]),
+	    -units_to_kicad(c->ay[i]),
+	    units_to_kicad(c->bx[i]),
+	    -units_to_kicad(c->by[i]),
+	    units_to_kicad(c->width[i]),
 	    layer_silk_top);
 }
 
 
-static void kicad_rect(FILE *file, const struct inst *inst)
+static void kicad_rect(FILE *file, const struct inst_cols *c, int i)
 {
 	unit_type xa, ya, xb, yb;
 	unit_type width;
 
-	xa = units_to_kicad(inst->base.x);
-	ya = units_to_kicad(inst->base.y);
-	xb = units_to_kicad(inst->u.rect.end.x);
-	yb = units_to_kicad(inst->u.rect.end.y);
-	width = units_to_kicad(inst->u.rect.width);
+	xa = units_to_kicad(c->ax[i]);
+	ya = units_to_kicad(c->ay[i]);
+	xb = units_to_kicad(c->bx[i]);
+	yb = units_to_kicad(c->by[i]);
+	width = units_to_kicad(c->width[i]);
 
 	fprintf(file, "DS %d %d %d %d %d %d\n",
 	    xa, -ya, xa, -yb, width, layer_silk_top);
@@ -160,23 +163,24 @@ static void kicad_rect(FILE *file, const struct inst *inst)
 }
 
 
-static void kicad_circ(FILE *file, const struct inst *inst)
+static void kicad_circ(FILE *file, const struct inst_cols *c, int i)
 {
 	/*
 	 * Xcenter, Ycenter, Xpoint, Ypoint, Width, Layer
 	 */
 	fprintf(file, "DC %d %d %d %d %d %d\n",
-	    units_to_kicad(inst->base.x),
-	    -units_to_kicad(inst->base.y),
-	    units_to_kicad(inst->base.x),
-	    -units_to_kicad(inst->base.y+inst->u.arc.r),
-	    units_to_kicad(inst->u.arc.width),
+	    units_to_kicad(c->ax[i]),
+	    -units_to_kicad(c->ay[i]),
+	    units_to_kicad(c->ax[i]),
+	    -units_to_kicad(c->ay[i]+c->r[i]),
+	    units_to_kicad(c->width[i]),
 	    layer_silk_top);
 }
 
 
-static void kicad_arc(FILE *file, const struct inst *inst)
+static void kicad_arc(FILE *file, const struct inst_cols *c, int i)
 {
+	struct coord center = { c->ax[i], c->ay[i] };
 	struct coord p;
 	double a;
 
@@ -187,44 +191,53 @@ static void kicad_arc(FILE *file, const struct inst *inst)
 	 * But it's really:
 	 * Xcenter, Ycenter, Xend, Yend, ...
 	 */
-	p = rotate_r(inst->base, inst->u.arc.r, inst->u.arc.a2);
-	a = inst->u.arc.a2-inst->u.arc.a1;
+	p = rotate_r(center, c->r[i], c->a2[i]);
+	a = c->a2[i]-c->a1[i];
 	while (a <= 0)
 		a += 360;
 	while (a > 360)
 		a -= 360;
 	fprintf(file, "DA %d %d %d %d %d %d %d\n",
-	    units_to_kicad(inst->base.x),
-	    -units_to_kicad(inst->base.y),
+	    units_to_kicad(center.x),
+	    -units_to_kicad(center.y),
 	    units_to_kicad(p.x),
 	    -units_to_kicad(p.y),
 	    (int) (a*10.0),
-	    units_to_kicad(inst->u.arc.width),
+	    units_to_kicad(c->width[i]),
 	    layer_silk_top);
 }
 
 
-static void kicad_inst(FILE *file, enum inst_prio prio, const struct inst *inst)
+static void kicad_cols(FILE *file, enum inst_prio prio,
+    const struct inst_cols *c)
 {
+	int i;
+
 	switch (prio) {
 	case ip_pad_copper:
 	case ip_pad_special:
-		kicad_pad(file, inst);
+		for (i = 0; i != c->n; i++)
+			kicad_pad(file, c, i);
 		break;
 	case ip_hole:
-		kicad_hole(file, inst);
+		for (i = 0; i != c->n; i++)
+			kicad_hole(file, c, i);
 		break;
 	case ip_line:
-		kicad_line(file, inst);
+		for (i = 0; i != c->n; i++)
+			kicad_line(file, c, i);
 		break;
 	case ip_rect:
-		kicad_rect(file, inst);
+		for (i = 0; i != c->n; i++)
+			kicad_rect(file, c, i);
 		break;
 	case ip_circ:
-		kicad_circ(file, inst);
+		for (i = 0; i != c->n; i++)
+			kicad_circ(file, c, i);
 		break;
 	case ip_arc:
-		kicad_arc(file, inst);
+		for (i = 0; i != c->n; i++)
+			kicad_arc(file, c, i);
 		break;
 	default:
 		/*
@@ -239,7 +252,6 @@ static void kicad_inst(FILE *file, enum inst_prio prio, const struct inst *inst)
 static void kicad_module(FILE *file, const struct pkg *pkg, time_t now)
 {
 	enum inst_prio prio;
-	const struct inst *inst;
 
 	/*
 	 * Module library name
@@ -291,10 +303,8 @@ static void kicad_module(FILE *file, const struct pkg *pkg, time_t now)
 	    layer_comment);
 
 	FOR_INST_PRIOS_UP(prio) {
-		for (inst = pkgs->insts[prio]; inst; inst = inst->next)
-			kicad_inst(file, prio, inst);
-		for (inst = pkg->insts[prio]; inst; inst = inst->next)
-			kicad_inst(file, prio, inst);
+		kicad_cols(file, prio, pkgs->cols+prio);
+		kicad_cols(file, prio, pkg->cols+prio);
 	}
 
 	fprintf(file, "$EndMODULE %s\n", pkg->name);
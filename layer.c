@@ -136,11 +136,19 @@ static int refine_overlapping(struct inst *copper, struct inst *other)
 }
 
 
-static int refine_copper(const struct pkg *pkg_copper, struct inst *copper,
+/*
+ * Only pads whose boxes touch can overlap, so we check the boxes first.
+ */
+
+static int refine_copper(const struct pkg *pkg_copper, int n,
     enum allow_overlap allow)
 {
+	const struct inst_cols *mine = pkg_copper->cols+ip_pad_copper;
+	struct inst *copper = mine->inst[n];
+	const struct inst_cols *c;
 	const struct pkg *pkg;
 	struct inst *other;
+	int i;
 
 	for (pkg = pkgs; pkg; pkg = pkg->next) {
 		/*
@@ -148,8 +156,11 @@ static int refine_copper(const struct pkg *pkg_copper, struct inst *copper,
 		 */
 		if (pkg != pkgs && pkg_copper != pkgs && pkg_copper != pkg)
 			continue;
-		for (other = pkg->insts[ip_pad_copper]; other;
-		    other = other->next)
+		c = pkg->cols+ip_pad_copper;
+		for (i = 0; i != c->n; i++) {
+			if (inst_cols_apart(mine, n, c, i))
+				continue;
+			other = c->inst[i];
 			if (copper != other && overlap(copper, other, allow)) {
 				fail("overlapping copper pads "
 				    "(\"%s\" line %d, \"%s\" line %d)",
@@ -158,11 +169,16 @@ static int refine_copper(const struct pkg *pkg_copper, struct inst *copper,
 				instantiation_error = copper->obj;
 				return 0;
 			}
-		for (other = pkg->insts[ip_pad_special]; other;
-		    other = other->next)
+		}
+		c = pkg->cols+ip_pad_special;
+		for (i = 0; i != c->n; i++) {
+			if (inst_cols_apart(mine, n, c, i))
+				continue;
+			other = c->inst[i];
 			if (overlap(copper, other, ao_none))
 				if (!refine_overlapping(copper, other))
 					return 0;
+		}
 	}
 	return 1;
 }
@@ -183,12 +199,13 @@ int refine_layers(enum allow_overlap allow)
 {
 	const struct pkg *pkg;
 	struct inst *copper;
+	int i;
 
 	for (pkg = pkgs; pkg; pkg = pkg->next)
-		for (copper = pkg->insts[ip_pad_copper]; copper;
-		    copper = copper->next) {
-			if (!refine_copper(pkg, copper, allow))
+		for (i = 0; i != pkg->cols[ip_pad_copper].n; i++) {
+			if (!refine_copper(pkg, i, allow))
 				return 0;
+			copper = pkg->cols[ip_pad_copper].inst[i];
 			if (copper->u.pad.hole)
 				mirror_layers(&copper->u.pad.layers);
 		}
@@ -12,6 +12,7 @@
 
 
 #include <stdlib.h>
+#include <math.h>
 
 #include "util.h"
 #include "coord.h"
@@ -22,6 +23,7 @@
 
 
 int n_samples;
+enum curr_unit curr_unit = curr_unit_mm;
 
 
 struct num eval_unit(const struct expr *expr, const struct frame *frame);
@@ -35,7 +37,7 @@ void reset_samples(struct sample **samples, int n)
 	for (i = 0; i != n; i++)
 		while (samples[i]) {
 			next = samples[i]->next;
-			bitset_free(samples[i]->frame_set);
+			bitset_release(&samples[i]->frame_set);
 			free(samples[i]);
 			samples[i] = next;
 		}
@@ -68,16 +70,16 @@ void meas_post(const struct vec *vec, struct coord pos,
 			break;
 		if (pos.x != (*walk)->pos.x)
 			continue;
-		if (bitset_ge((*walk)->frame_set, frame_set))
+		if (bitset_ge(&(*walk)->frame_set, frame_set))
 			return;
-		if (bitset_ge(frame_set, (*walk)->frame_set)) {
-			bitset_or((*walk)->frame_set, frame_set);
+		if (bitset_ge(frame_set, &(*walk)->frame_set)) {
+			bitset_or(&(*walk)->frame_set, frame_set);
 			return;
 		}
 	}
 	new = alloc_type(struct sample);
 	new->pos = pos;
-	new->frame_set = bitset_clone(frame_set);
+	bitset_init_clone(&new->frame_set, frame_set);
 	new->next = *walk;
 	*walk = new;
 }
@@ -192,7 +194,7 @@ const struct sample *meas_find_min(lt_op_type lt, const struct sample *s,
 	const struct sample *min = NULL;
 
 	while (s) {
-		if (!qual || bitset_ge(s->frame_set, qual))
+		if (!qual || bitset_ge(&s->frame_set, qual))
 			if (!min || lt(s->pos, min->pos) ||
 			    (!lt(min->pos, s->pos) && lt_xy(s->pos, min->pos)))
 				min = s;
@@ -208,7 +210,7 @@ const struct sample *meas_find_next(lt_op_type lt, const struct sample *s,
 	const struct sample *next = NULL;
 
 	while (s) {
-		if (!qual || bitset_ge(s->frame_set, qual))
+		if (!qual || bitset_ge(&s->frame_set, qual))
 			if (!next || better_next(lt, ref, next->pos, s->pos))
 				next = s;
 		s = s->next;
@@ -223,7 +225,7 @@ const struct sample *meas_find_max(lt_op_type lt, const struct sample *s,
 	const struct sample *max = NULL;
 
 	while (s) {
-		if (!qual || bitset_ge(s->frame_set, qual))
+		if (!qual || bitset_ge(&s->frame_set, qual))
 			if (!max || lt(max->pos, s->pos) ||
 			    (!lt(s->pos, max->pos) && lt_xy(max->pos, s->pos)))
 				max = s;
@@ -236,16 +238,14 @@ const struct sample *meas_find_max(lt_op_type lt, const struct sample *s,
 /* ----- instantiation ----------------------------------------------------- */
 
 
-static struct bitset *make_frame_set(struct frame_qual *qual, int n_frames)
+static void make_frame_set(struct bitset *set, struct frame_qual *qual,
+    int n_frames)
 {
-	struct bitset *set;
-
-	set = bitset_new(n_frames);
+	bitset_init(set, n_frames);
 	while (qual) {
 		bitset_set(set, qual->frame->n);
 		qual = qual->next;
 	}
-	return set;
 }
 
 
@@ -253,7 +253,7 @@ static int instantiate_meas_pkg(int n_frames)
 {
 	struct obj *obj;
 	const struct meas *meas;
-	struct bitset *set;
+	struct bitset set;
 	const struct sample *a0, *b0;
 	lt_op_type lt;
 
@@ -269,20 +269,20 @@ static int instantiate_meas_pkg(int n_frames)
 
 		lt = lt_op[meas->type];
 
-		set = make_frame_set(meas->low_qual, n_frames);
-		a0 = meas_find_min(lt, curr_pkg->samples[obj->base->n], set);
-		bitset_free(set);
+		make_frame_set(&set, meas->low_qual, n_frames);
+		a0 = meas_find_min(lt, curr_pkg->samples[obj->base->n], &set);
+		bitset_release(&set);
 		if (!a0)
 			continue;
 
-		set = make_frame_set(meas->high_qual, n_frames);
+		make_frame_set(&set, meas->high_qual, n_frames);
 		if (is_next[meas->type])
 			b0 = meas_find_next(lt,
-			    curr_pkg->samples[meas->high->n], a0->pos, set);
+			    curr_pkg->samples[meas->high->n], a0->pos, &set);
 		else
 			b0 = meas_find_max(lt,
-			    curr_pkg->samples[meas->high->n], set);
-		bitset_free(set);
+			    curr_pkg->samples[meas->high->n], &set);
+		bitset_release(&set);
 		if (!b0)
 			continue;
 
@@ -324,3 +324,80 @@ int instantiate_meas(int n_frames)
 		}
 	return 1;
 }
+
+
+/* ----- projection and labels --------------------------------------------- */
+
+
+static struct coord offset_vec(struct coord a, struct coord b,
+    const struct inst *self)
+{
+	struct coord res;
+	double f;
+
+	res.x = a.y-b.y;
+	res.y = b.x-a.x;
+	if (res.x == 0 && res.y == 0)
+		return res;
+	f = self->u.meas.offset/hypot(res.x, res.y);
+	res.x *= f;
+	res.y *= f;
+	return res;
+}
+
+
+void project_meas(const struct inst *inst, struct coord *a1, struct coord *b1)
+{
+	const struct meas *meas = &inst->obj->u.meas;
+	struct coord off;
+
+	*a1 = inst->base;
+	*b1 = inst->u.meas.end;
+	switch (meas->type) {
+	case mt_xy_next:
+	case mt_xy_max:
+		break;
+	case mt_x_next:
+	case mt_x_max:
+		b1->y = a1->y;
+		break;
+	case mt_y_next:
+	case mt_y_max:
+		b1->x = a1->x;
+		break;
+	default:
+		abort();
+	}
+	off = offset_vec(*a1, *b1, inst);
+	*a1 = add_vec(*a1, off);
+	*b1 = add_vec(*b1, off);
+}
+
+
+char *format_len(const char *label, unit_type len, enum curr_unit unit)
+{
+	const char *u = "";
+	double n;
+	int mm;
+
+	switch (unit) {
+	case curr_unit_mm:
+		n = units_to_mm(len);
+		mm = 1;
+		break;
+	case curr_unit_mil:
+		n = units_to_mil(len);
+		mm = 0;
+		break;
+	case curr_unit_auto:
+		n = units_to_best(len, &mm);
+		u = mm ? "mm" : "mil";
+		break;
+	default:
+		abort();
+	}
+	return stralloc_printf(mm ?
+	    "%s" MM_FORMAT_SHORT "%s" :
+	    "%s" MIL_FORMAT_SHORT "%s",
+	    label, n, u);
+}
@@ -20,10 +20,22 @@
 #include "bitset.h"
 
 
+#define	MM_FORMAT_SHORT		"%.4g"
+#define	MIL_FORMAT_SHORT	"%.4g"
+
+
 typedef int (*lt_op_type)(struct coord a, struct coord b);
 
 struct vec;
 struct obj;
+struct inst;
+
+enum curr_unit {
+	curr_unit_mm,
+	curr_unit_mil,
+	curr_unit_auto,
+	curr_unit_n
+};
 
 struct frame_qual {
 	const struct frame *frame;
@@ -53,12 +65,13 @@ struct meas {
 
 struct sample {
 	struct coord pos;
-	struct bitset *frame_set;
+	struct bitset frame_set;
 	struct sample *next;
 };
 
 
 extern int n_samples;
+extern enum curr_unit curr_unit;
 
 
 int lt_x(struct coord a, struct coord b);
@@ -79,4 +92,7 @@ void meas_post(const struct vec *vec, struct coord pos,
     const struct bitset *frame_set);
 int instantiate_meas(int n_frames);
 
+void project_meas(const struct inst *inst, struct coord *a1, struct coord *b1);
+char *format_len(const char *label, unit_type len, enum curr_unit unit);
+
 #endif /* !MEAS_H */
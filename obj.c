@@ -13,6 +13,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <assert.h>
 
 #include "util.h"
@@ -24,7 +25,12 @@
 #include "hole.h"
 #include "overlap.h"
 #include "layer.h"
+#include "drc.h"
 #include "delete.h"
+#include "fcache.h"
+#include "keyidx.h"
+#include "hoist.h"
+#include "journal.h"
 #include "fpd.h"
 #include "obj.h"
 
@@ -44,63 +50,67 @@ int holes_linked = 1;
 
 
 static struct bitset *frame_set; /* frames visited in "call chain" */
+static struct template *pkg_tmpl;
 
 
-/* ----- Searching --------------------------------------------------------- */
+/* ----- Choices leading to an instance ---------------------------------- */
 
 
 /*
- * @@@ Known bug: we should compare all parameters of an instance, not just the
- * object's base or the vectors end.
+ * Each instance records the table rows and loop iterations that were current
+ * in its frame. All the instances of the same iteration share the record,
+ * which we make when adding the first of them. To activate an instance, the
+ * GUI applies the records of the instance and of the frames containing it.
  */
 
-static int found = 0;
-static int search_suspended = 0;
-static const struct vec *find_vec = NULL;
-static const struct obj *find_obj = NULL;
-static struct coord find_pos;
-
-
-static void suspend_search(void)
-{
-	search_suspended++;
-}
-
-static void resume_search(void)
+const struct inst_path *frame_path(struct frame *frame)
 {
-	assert(search_suspended > 0);
-	search_suspended--;
-}
-
-
-static struct coord get_pos(const struct inst *inst)
-{
-	return inst->obj ? inst->base : inst->u.vec.end;
+	struct inst_path *path;
+	const struct table *table;
+	const struct loop *loop;
+	int n_rows = 0, n_loops = 0;
+
+	if (frame->curr_path)
+		return frame->curr_path;
+	for (table = frame->tables; table; table = table->next)
+		n_rows++;
+	for (loop = frame->loops; loop; loop = loop->next)
+		n_loops++;
+	path = inst_new_path(n_rows, n_loops);
+	n_rows = 0;
+	for (table = frame->tables; table; table = table->next)
+		path->rows[n_rows++] = table->curr_row;
+	n_loops = 0;
+	for (loop = frame->loops; loop; loop = loop->next)
+		path->iterations[n_loops++] = loop->curr_iter;
+	frame->curr_path = path;
+	return path;
 }
 
 
-void find_inst(const struct inst *inst)
-{
-	struct coord pos;
-
-	if (search_suspended)
-		return;
-	if (find_vec != inst->vec)
-		return;
-	if (find_obj != inst->obj)
-		return;
-	pos = get_pos(inst);
-	if (pos.x != find_pos.x || pos.y != find_pos.y)
-		return;
-	found++;
-}
-
+/*
+ * The frame may have been edited since, so we only use rows that still exist.
+ */
 
-void search_inst(const struct inst *inst)
+void activate_path(struct frame *frame, const struct inst_path *path)
 {
-	find_vec = inst->vec;
-	find_obj = inst->obj;
-	find_pos = get_pos(inst);
+	struct table *table;
+	struct row *row;
+	struct loop *loop;
+	int i;
+
+	i = 0;
+	for (table = frame->tables; table && i != path->n_rows;
+	    table = table->next) {
+		for (row = table->rows; row; row = row->next)
+			if (row == path->rows[i])
+				table->active_row = row;
+		i++;
+	}
+	i = 0;
+	for (loop = frame->loops; loop && i != path->n_loops;
+	    loop = loop->next)
+		loop->active = path->iterations[i++];
 }
 
 
@@ -140,11 +150,335 @@ int obj_anchors(struct obj *obj, struct vec ***anchors)
 }
 
 
+/* ----- Frame references -------------------------------------------------- */
+
+
+/*
+ * reach[frame->ref_n] is the set of frames a frame references, directly or
+ * through other frames, including the frame itself. We build it on demand
+ * and drop it whenever frames or frame references are added or removed.
+ */
+
+static struct bitset **reach = NULL;
+static int n_reach;
+
+
+static void refs_replayed(void *user)
+{
+	frame_refs_changed();
+}
+
+
+/*
+ * Undoing or redoing the change has to invalidate the sets as well.
+ */
+
+void frame_refs_changed(void)
+{
+	int i;
+
+	journal_call(refs_replayed, refs_replayed, NULL);
+	if (!reach)
+		return;
+	for (i = 0; i != n_reach; i++)
+		bitset_free(reach[i]);
+	free(reach);
+	reach = NULL;
+}
+
+
+/*
+ * There should be no cycles. If there are, we just stop at the frame we're
+ * still working on.
+ */
+
+static const struct bitset *reach_frame(const struct frame *frame)
+{
+	struct bitset *set = reach[frame->ref_n];
+	const struct obj *obj;
+
+	if (set)
+		return set;
+	set = bitset_new(n_reach);
+	bitset_set(set, frame->ref_n);
+	reach[frame->ref_n] = set;
+	for (obj = frame->objs; obj; obj = obj->next)
+		if (obj->type == ot_frame)
+			bitset_or(set, reach_frame(obj->u.frame.ref));
+	return set;
+}
+
+
+int is_parent_of(const struct frame *p, const struct frame *c)
+{
+	struct frame *frame;
+
+	if (p == c)
+		return 1;
+	if (!reach) {
+		n_reach = 0;
+		for (frame = frames; frame; frame = frame->next)
+			frame->ref_n = n_reach++;
+		reach = zalloc_size(sizeof(struct bitset *)*n_reach);
+		for (frame = frames; frame; frame = frame->next)
+			reach_frame(frame);
+	}
+	return bitset_pick(reach[p->ref_n], c->ref_n);
+}
+
+
+/* ----- Adding objects ---------------------------------------------------- */
+
+
+void connect_obj(struct frame *frame, struct obj *obj)
+{
+	struct obj **walk;
+
+	obj->frame = frame;
+	for (walk = &frame->objs; *walk; walk = &(*walk)->next);
+	journal_replace(walk, obj, NULL, discard_obj);
+	if (obj->type == ot_frame)
+		frame_refs_changed();
+}
+
+
+/* ----- Loop batches ------------------------------------------------------ */
+
+
+/*
+ * Vector coordinates in arrays are usually affine in the loop variable. For
+ * the innermost loop of a frame, we therefore try to calculate the vectors
+ * of that frame and of the frames it references directly for all iterations
+ * before running the loop. generate_vecs then only looks up the results.
+ *
+ * Instances are still generated one iteration at a time, so that their order
+ * and the paths recorded for them don't change. Any frame that doesn't
+ * qualify is left to the interpreter.
+ */
+
+struct batch_frame {
+	const struct frame *frame;
+	const struct frame *parent;
+	double *x, *y;		/* [vec*n+iteration], in units */
+	struct batch_frame *next;
+};
+
+struct batch {
+	int n;			/* iterations */
+	int curr;		/* current iteration */
+	struct batch_frame *frames;
+};
+
+static struct batch *batch = NULL;
+
+
+static int batch_qualifies(const struct frame *frame, int nested)
+{
+	const struct table *table;
+	const struct var *var;
+
+	if (nested && frame->loops)
+		return 0;
+	for (table = frame->tables; table; table = table->next) {
+		if (nested && (!table->rows || table->rows->next))
+			return 0;
+		for (var = table->vars; var; var = var->next)
+			if (var->key)
+				return 0;
+	}
+	return 1;
+}
+
+
+static int lanes_to_unit(struct num num, double *v, int n)
+{
+	int i;
+
+	if (!is_distance(num))
+		return 0;
+	if (num.type == nt_mil)
+		for (i = 0; i != n; i++)
+			v[i] = mil_to_units(v[i]);
+	else
+		for (i = 0; i != n; i++)
+			v[i] = mm_to_units(v[i]);
+	return 1;
+}
+
+
+static int batch_vecs(struct batch_frame *bf, const struct lanes *lanes)
+{
+	const struct vec *vec;
+	struct num num;
+	int n = 0;
+	int i;
+
+	for (vec = bf->frame->vecs; vec; vec = vec->next)
+		n++;
+	bf->x = alloc_size(n*lanes->n*sizeof(double));
+	bf->y = alloc_size(n*lanes->n*sizeof(double));
+	i = 0;
+	for (vec = bf->frame->vecs; vec; vec = vec->next) {
+		if (!eval_lanes(vec->x, bf->frame, lanes, &num, bf->x+i) ||
+		    !lanes_to_unit(num, bf->x+i, lanes->n))
+			return 0;
+		if (!eval_lanes(vec->y, bf->frame, lanes, &num, bf->y+i) ||
+		    !lanes_to_unit(num, bf->y+i, lanes->n))
+			return 0;
+		i += lanes->n;
+	}
+	return 1;
+}
+
+
+static void add_batch_frame(struct batch *b, struct frame *frame,
+    const struct frame *parent, const struct lanes *lanes)
+{
+	struct batch_frame *bf;
+	const struct frame *saved_parent = frame->curr_parent;
+	struct table *table;
+	struct row **saved_rows = NULL;
+	int n = 0;
+	int ok;
+
+	if (!frame->vecs)
+		return;
+	for (bf = b->frames; bf; bf = bf->next)
+		if (bf->frame == frame)
+			return;
+	if (!batch_qualifies(frame, frame != lanes->frame))
+		return;
+
+	/*
+	 * Referenced frames only have single-row tables, so we can set them up
+	 * as they'll be during generation.
+	 */
+	if (frame != lanes->frame) {
+		for (table = frame->tables; table; table = table->next)
+			n++;
+		saved_rows = n ? alloc_size(n*sizeof(struct row *)) : NULL;
+		n = 0;
+		for (table = frame->tables; table; table = table->next) {
+			saved_rows[n++] = table->curr_row;
+			table->curr_row = table->rows;
+		}
+		frame->curr_parent = parent;
+	}
+
+	bf = alloc_type(struct batch_frame);
+	bf->frame = frame;
+	bf->parent = parent;
+	ok = batch_vecs(bf, lanes);
+
+	if (frame != lanes->frame) {
+		n = 0;
+		for (table = frame->tables; table; table = table->next)
+			table->curr_row = saved_rows[n++];
+		free(saved_rows);
+		frame->curr_parent = saved_parent;
+	}
+
+	if (ok) {
+		bf->next = b->frames;
+		b->frames = bf;
+	} else {
+		free(bf->x);
+		free(bf->y);
+		free(bf);
+	}
+}
+
+
+static void free_batch(struct batch *b)
+{
+	struct batch_frame *next;
+
+	if (!b)
+		return;
+	while (b->frames) {
+		next = b->frames->next;
+		free(b->frames->x);
+		free(b->frames->y);
+		free(b->frames);
+		b->frames = next;
+	}
+	free(b);
+}
+
+
+static struct batch *begin_batch(struct frame *frame, const struct loop *loop,
+    double from, double to)
+{
+	void (*saved_reporter)(const char *s) = reporter;
+	struct batch *b;
+	struct lanes lanes;
+	const struct obj *obj;
+	double *values;
+	double v;
+	int n = 0;
+
+	if (!batch_qualifies(frame, 0))
+		return NULL;
+
+	/* same iteration as in run_loops */
+	for (v = from; v <= to; v += 1) {
+		if (n == MAX_ITERATIONS)
+			return NULL;
+		n++;
+	}
+	if (!n)
+		return NULL;
+	values = alloc_size(n*sizeof(double));
+	n = 0;
+	for (v = from; v <= to; v += 1)
+		values[n++] = v;
+
+	lanes.frame = frame;
+	lanes.loop = loop;
+	lanes.values = values;
+	lanes.n = n;
+
+	b = alloc_type(struct batch);
+	b->n = n;
+	b->curr = 0;
+	b->frames = NULL;
+
+	/* errors just mean we leave things to the interpreter */
+	reporter = report_nothing;
+	add_batch_frame(b, frame, frame->curr_parent, &lanes);
+	for (obj = frame->objs; obj; obj = obj->next)
+		if (obj->type == ot_frame)
+			add_batch_frame(b, obj->u.frame.ref, frame, &lanes);
+	reporter = saved_reporter;
+	free(values);
+
+	if (b->frames)
+		return b;
+	free(b);
+	return NULL;
+}
+
+
+static const struct batch_frame *batched(const struct frame *frame)
+{
+	const struct batch_frame *bf;
+
+	if (!batch)
+		return NULL;
+	for (bf = batch->frames; bf; bf = bf->next)
+		if (bf->frame == frame && bf->parent == frame->curr_parent)
+			return bf;
+	return NULL;
+}
+
+
 /* ----- Instantiation ----------------------------------------------------- */
 
 
 static int generate_frame(struct frame *frame, struct coord base,
     const struct frame *parent, struct obj *frame_ref, int active);
+static int run_loops(struct frame *frame, struct loop *loop,
+    struct coord base, int active);
 
 
 struct num eval_unit(const struct expr *expr, const struct frame *frame);
@@ -152,7 +486,7 @@ struct num eval_unit(const struct expr *expr, const struct frame *frame);
 {
 	struct num d;
 
-	d = eval_num(expr, frame);
+	d = eval_hoisted(expr, frame);
 	if (!is_undef(d) && to_unit(&d))
 		return d;
 	fail_expr(expr);
@@ -208,17 +542,25 @@ static int resolve_vec(const struct vec *vec, struct coord base_pos,
 
 static int generate_vecs(struct frame *frame, struct coord base_pos)
 {
+	const struct batch_frame *bf = batched(frame);
 	struct coord vec_base;
 	struct vec *vec;
 	struct num x, y;
+	int i = 0;
 
 	for (vec = frame->vecs; vec; vec = vec->next) {
-		x = eval_unit(vec->x, frame);
-		if (is_undef(x))
-			goto error;
-		y = eval_unit(vec->y, frame);
-		if (is_undef(y))
-			goto error;
+		if (bf) {
+			x.n = bf->x[i+batch->curr];
+			y.n = bf->y[i+batch->curr];
+			i += batch->n;
+		} else {
+			x = eval_unit(vec->x, frame);
+			if (is_undef(x))
+				goto error;
+			y = eval_unit(vec->y, frame);
+			if (is_undef(y))
+				goto error;
+		}
 		if (!resolve_vec(vec->base, base_pos, frame, &vec_base))
 			goto error;
 		vec->pos = vec_base;
@@ -227,6 +569,7 @@ static int generate_vecs(struct frame *frame, struct coord base_pos)
 		if (!inst_vec(vec, vec_base))
 			goto error;
 		meas_post(vec, vec->pos, frame_set);
+		fcache_post(frame, vec, vec->pos);
 	}
 	return 1;
 
@@ -240,8 +583,7 @@ static int generate_objs(struct frame *frame, struct coord base_pos,
     int active)
 {
 	struct obj *obj;
-	char *name;
-	int ok;
+	const char *name;
 	struct num width, offset;
 	struct coord base, other, start, end;
 
@@ -281,12 +623,10 @@ static int generate_objs(struct frame *frame, struct coord base_pos,
 			if (!resolve_vec(obj->u.pad.other, base_pos, frame,
 			    &other))
 				goto error;
-			name = expand(obj->u.pad.name, frame);
+			name = expand_template(obj->u.pad.tmpl, frame);
 			if (!name)
 				goto error;
-			ok = inst_pad(obj, name, base, other);
-			free(name);
-			if (!ok)
+			if (!inst_pad(obj, name, base, other))
 				goto error;
 			break;
 		case ot_hole:
@@ -335,14 +675,13 @@ error:
 
 static int generate_items(struct frame *frame, struct coord base, int active)
 {
-	char *s;
+	const char *s;
 	int ok;
 
 	if (frame == frames) {
-		s = expand(pkg_name, frame);
+		s = expand_template(pkg_tmpl, frame);
 		/* s is NULL if expansion failed */
 		inst_select_pkg(s ? s : "_", active);
-		free(s);
 	}
 	inst_begin_active(active && frame == active_frame);
 	ok = generate_vecs(frame, base) && generate_objs(frame, base, active);
@@ -375,16 +714,121 @@ static int match_keys(struct frame *frame, struct coord base, int active)
 }
 
 
+/*
+ * If the variable of the innermost loop is compared with a constant key,
+ * only the iteration with that value can generate anything. The other
+ * iterations just reject the keys, which can't fail if all the other
+ * variables compared are defined outside this frame. Variables set in the
+ * frame can change from one iteration to the next, or fail to evaluate in the
+ * iterations we would skip.
+ *
+ * key_iteration returns the iteration the key selects, -1 if no iteration
+ * can match, and -2 if we have to try all of them.
+ */
+
+static int key_iteration(const struct frame *frame, const struct loop *loop,
+    double from, int iterations)
+{
+	void (*saved_reporter)(const char *s) = reporter;
+	const struct table *table;
+	const struct var *var;
+	const struct value *value;
+	const struct expr *key = NULL;
+	struct num num;
+	double k;
+	int defined;
+
+	if (from != floor(from) || fabs(from) > 1e9)
+		return -2;
+	for (table = frame->tables; table; table = table->next) {
+		value = table->curr_row->values;
+		for (var = table->vars; var; var = var->next) {
+			if (!var->key) {
+				if (var->name == loop->var.name)
+					return -2;
+				value = value->next;
+				continue;
+			}
+			if (value->expr->op != op_num &&
+			    value->expr->op != op_string)
+				return -2;
+			if (var->name == loop->var.name) {
+				if (!key)
+					key = value->expr;
+			} else {
+				if (bound_in_frame(frame, var->name))
+					return -2;
+				reporter = report_nothing;
+				num = eval_var(frame, var->name);
+				defined = !is_undef(num) ||
+				    eval_string_var(frame, var->name);
+				reporter = saved_reporter;
+				if (!defined)
+					return -2;
+			}
+			value = value->next;
+		}
+	}
+	if (!key || key->op != op_num)
+		return -2;
+	num = key->u.num;
+	if (num.exponent)
+		return -1;
+	k = num.n-from;
+	if (k != floor(k) || k < 0 || k >= iterations)
+		return -1;
+	return k;
+}
+
+
+static int run_iteration(struct frame *frame, struct loop *loop,
+    struct coord base, int active, int n)
+{
+	hoist_changed(&loop->stamp);
+	loop->curr_iter = n;
+	frame->curr_path = NULL;
+	return run_loops(frame, loop->next, base, active && loop->active == n);
+}
+
+
+/*
+ * The active iteration is always run, so that the loops it contains are
+ * updated for the GUI.
+ */
+
+static int run_key_iterations(struct frame *frame, struct loop *loop,
+    struct coord base, int active, double from, int iterations, int k)
+{
+	int n[2], i;
+
+	n[0] = k;
+	n[1] = active && loop->active < iterations ? loop->active : -1;
+	if (n[1] < n[0]) {
+		n[0] = n[1];
+		n[1] = k;
+	}
+	for (i = 0; i != 2; i++) {
+		if (n[i] < 0 || (i && n[i] == n[0]))
+			continue;
+		loop->curr_value = from+n[i];
+		if (!run_iteration(frame, loop, base, active, n[i]))
+			return 0;
+	}
+	return 1;
+}
+
+
 static int run_loops(struct frame *frame, struct loop *loop,
     struct coord base, int active)
 {
+	struct batch *saved_batch = batch;
+	struct batch *b = NULL;
 	struct num from, to;
-	int n;
-	int found_before, ok;
+	int n, k = -2;
 
 	if (!loop)
 		return match_keys(frame, base, active);
-	from = eval_num(loop->from.expr, frame);
+	from = eval_hoisted(loop->from.expr, frame);
 	if (is_undef(from)) {
 		fail_expr(loop->from.expr);
 		instantiation_error = loop;
@@ -397,7 +841,7 @@ static int run_loops(struct frame *frame, struct loop *loop,
 		return 0;
 	}
 
-	to = eval_num(loop->to.expr, frame);
+	to = eval_hoisted(loop->to.expr, frame);
 	if (is_undef(to)) {
 		fail_expr(loop->to.expr);
 		instantiation_error = loop;
@@ -414,6 +858,23 @@ static int run_loops(struct frame *frame, struct loop *loop,
 	loop->curr_value = from.n;
 	loop->initialized = 1;
 
+	if (!loop->next) {
+		if (to.n-from.n < MAX_ITERATIONS) {
+			n = to.n < from.n ? 0 : to.n-from.n+1;
+			k = key_iteration(frame, loop, from.n, n);
+		}
+		if (k == -2)
+			b = begin_batch(frame, loop, from.n, to.n);
+	}
+	batch = b;
+
+	if (k != -2) {
+		if (!run_key_iterations(frame, loop, base, active, from.n,
+		    n, k))
+			goto fail;
+		goto done;
+	}
+
 	n = 0;
 	for (; loop->curr_value <= to.n; loop->curr_value += 1) {
 		if (n >= MAX_ITERATIONS) {
@@ -422,29 +883,28 @@ static int run_loops(struct frame *frame, struct loop *loop,
 			instantiation_error = loop;
 			goto fail;
 		}
-		found_before = found;
-		if (loop->found == loop->active)
-			suspend_search();
-		ok = run_loops(frame, loop->next, base,
-		    active && loop->active == n);
-		if (loop->found == loop->active)
-			resume_search();
-		if (!ok)
+		if (b)
+			b->curr = n;
+		if (!run_iteration(frame, loop, base, active, n))
 			goto fail;
-		if (found_before != found)
-			loop->found = n;
 		n++;
 	}
+
+done:
 	loop->initialized = 0;
 	loop->curr_value = UNDEF;
 	if (active) {
 		loop->n = from.n;
 		loop->iterations = n;
 	}
+	batch = saved_batch;
+	free_batch(b);
 	return 1;
 
 fail:
 	loop->initialized = 0;
+	batch = saved_batch;
+	free_batch(b);
 	return 0;
 }
 
@@ -452,24 +912,25 @@ fail:
 static int iterate_tables(struct frame *frame, struct table *table,
     struct coord base, int active)
 {
-	int found_before, ok;
+	struct row **rows, **next;
+	int ok;
 
 	if (!table)
 		return run_loops(frame, frame->loops, base, active);
-	for (table->curr_row = table->rows; table->curr_row;
-	    table->curr_row = table->curr_row->next) {
-		found_before = found;
-		if (table->found_row == table->active_row)
-			suspend_search();
+	rows = key_rows(frame, table);
+	next = rows;
+	for (table->curr_row = rows ? *next : table->rows; table->curr_row;
+	    table->curr_row = rows ? *++next : table->curr_row->next) {
+		hoist_changed(&table->stamp);
+		frame->curr_path = NULL;
 		ok = iterate_tables(frame, table->next, base,
 		    active && table->active_row == table->curr_row);
-		if (table->found_row == table->active_row)
-			resume_search();
-		if (!ok)
+		if (!ok) {
+			free(rows);
 			return 0;
-		if (found_before != found)
-			table->found_row = table->curr_row;
+		}
 	}
+	free(rows);
 	return 1;
 }
 
@@ -479,6 +940,10 @@ static int generate_frame(struct frame *frame, struct coord base,
 {
 	int ok;
 
+	if (!active &&
+	    fcache_lookup(frame, parent, frame_ref, base, frame_set))
+		return 1;
+
 	/*
 	 * We ensure during construction that frames can never recurse.
 	 */
@@ -487,10 +952,13 @@ static int generate_frame(struct frame *frame, struct coord base,
 	    active && frame == active_frame);
 	bitset_set(frame_set, frame->n);
 	frame->curr_parent = parent;
+	hoist_changed(&frame->stamp);
+	frame->curr_path = NULL;
 	ok = iterate_tables(frame, frame->tables, base, active);
 	inst_end_frame(frame);
 	bitset_clear(frame_set, frame->n);
 	frame->curr_parent = NULL;
+	fcache_done(frame, ok);
 	return ok;
 }
 
@@ -506,43 +974,49 @@ static void reset_all_loops(void)
 }
 
 
-static void reset_found(void)
+static void free_key_indices(void)
 {
-	struct frame *frame;
+	const struct frame *frame;
 	struct table *table;
-	struct loop *loop;
 
-	for (frame = frames; frame; frame = frame->next) {
+	for (frame = frames; frame; frame = frame->next)
 		for (table = frame->tables; table; table = table->next)
-			table->found_row = NULL;
-		for (loop = frame->loops; loop; loop = loop->next)
-			loop->found = -1;
-		frame->found_ref = NULL;
-	}
+			key_index_free(table);
 }
 
 
 /*
- * Note: we don't use frame->found_ref yet. Instead, we adjust the frame
- * references with activate_item in inst.c
+ * Pad names are compiled once per instantiation, which is cheap compared to
+ * expanding them for every instance.
  */
 
-static void activate_found(void)
+static void compile_templates(void)
 {
-	struct frame *frame;
-	struct table *table;
-	struct loop *loop;
+	const struct frame *frame;
+	struct obj *obj;
 
-	for (frame = frames; frame; frame = frame->next) {
-		for (table = frame->tables; table; table = table->next)
-			if (table->found_row)
-				table->active_row = table->found_row;
-		for (loop = frame->loops; loop; loop = loop->next)
-			if (loop->found != -1)
-				loop->active = loop->found;
-		if (frame->found_ref)
-			frame->active_ref = frame->found_ref;
-	}
+	pkg_tmpl = compile_template(pkg_name);
+	for (frame = frames; frame; frame = frame->next)
+		for (obj = frame->objs; obj; obj = obj->next)
+			if (obj->type == ot_pad)
+				obj->u.pad.tmpl =
+				    compile_template(obj->u.pad.name);
+}
+
+
+static void free_templates(void)
+{
+	const struct frame *frame;
+	struct obj *obj;
+
+	free_template(pkg_tmpl);
+	pkg_tmpl = NULL;
+	for (frame = frames; frame; frame = frame->next)
+		for (obj = frame->objs; obj; obj = obj->next)
+			if (obj->type == ot_pad) {
+				free_template(obj->u.pad.tmpl);
+				obj->u.pad.tmpl = NULL;
+			}
 }
 
 
@@ -567,20 +1041,24 @@ int instantiate(void)
 	inst_start();
 	n_frames = enumerate_frames();
 	frame_set = bitset_new(n_frames);
+	compile_templates();
+	fcache_start(n_frames);
+	hoist_start();
 	instantiation_error = NULL;
 	reset_all_loops();
-	reset_found();
-	found = 0;
-	search_suspended = 0;
 	ok = generate_frame(frames, zero, NULL, NULL, 1);
-	if (ok && (find_vec || find_obj) && found)
-		activate_found();
-	find_vec = NULL;
-	find_obj = NULL;
-	if (ok)
+	fcache_stop();
+	hoist_stop();
+	free_key_indices();
+	free_templates();
+	if (ok) {
+		inst_columns();
 		ok = link_holes(holes_linked);
+	}
 	if (ok)
 		ok = refine_layers(allow_overlap);
+	if (ok)
+		drc_check();
 	if (ok)
 		ok = instantiate_meas(n_frames);
 	if (ok)
@@ -602,4 +1080,5 @@ void obj_cleanup(void)
 		delete_frame(frames);
 		destroy();
 	}
+	frame_refs_changed();
 }
@@ -15,7 +15,6 @@
 #define OBJ_H
 
 #include <assert.h>
-#include <gtk/gtk.h>
 
 #include "expr.h"
 #include "coord.h"
@@ -24,9 +23,16 @@
 #include "layer.h"
 
 
+/*
+ * The items only contain what instantiation and editing need. The GUI keeps
+ * its widgets and dumping keeps its flags in tables of their own, see
+ * item_widget in gui_frame.c and order_frame in dump.c.
+ */
+
+
 /*
  * Objects contain various fields that help to select instances under various
- * conditions. They are "current", "active", and "found":
+ * conditions. They are "current" and "active":
  *
  * - current: the path taken while instantiating. E.g., we may make one frame
  *   reference the "current" reference of this frame and then recurse into it.
@@ -40,15 +46,12 @@
  *   across instantiation while "current" iterates through all possible values
  *   during instantiation.
  *
- * - found: then clicking on an unselected instance, fped will try to activate
- *   this instance. In order to do so, it needs to determine which choices need
- *   to be activated to reach the instance. "Found" records this information.
- *   At the end of the search, all "found" choices become "active".
- *
- *   If, during the search, an instance can be reached with the "found" choice
- *   being equal to the choice active at that time, "found" will not be set to
- *   any other value. This prevents searches from affecting choices that play
- *   no role in the selection of the instance.
+ * Each instance records in an inst_path the table rows and loop iterations
+ * that were "current" in its frame when it was generated, see frame_path.
+ * When clicking on an unselected instance, fped makes the frame references
+ * leading to it "active" and applies the paths of the instance and of the
+ * frames containing it with activate_path. This sets all the tables and loops
+ * of these frames, also those the instance doesn't depend on.
  */
 
 
@@ -64,9 +67,6 @@ struct var {
 	/* key: 0 if the variable is set, 1 if the variable is compared */
 	int key;
 
-	/* for the GUI */
-	GtkWidget *widget;
-
 	/* for evaluation */
 	int visited;
 };
@@ -77,11 +77,11 @@ struct value {
 
 	/* back reference, NULL if loop */
 	struct row *row;
-
-	/* for the GUI */
-	GtkWidget *widget;
 };
 
+struct key_index;
+struct inst_path;
+
 struct row {
 	struct value *values;
 	struct row *next;
@@ -98,11 +98,12 @@ struct table {
 	/* used during generation and when editing */
 	struct row *curr_row;
 
+	/* used during generation */
+	struct key_index *index; /* NULL if not built yet */
+	unsigned long stamp;	/* see hoist.h */
+
 	/* GUI use */
 	struct row *active_row;
-
-	/* For searching */
-	struct row *found_row;	/* NULL if not found yet */
 };
 
 struct loop {
@@ -113,15 +114,14 @@ struct loop {
 
 	/* used during generation */
 	double curr_value;
+	int curr_iter;		/* 0 based */
+	unsigned long stamp;	/* see hoist.h */
 
 	/* GUI use */
 	int active;	/* n-th iteration is active, 0 based */
 	double n;	/* start value when it was active */
 	int iterations;	/* iterations when it was active */
 
-	/* For searching */
-	int found;	/* -1 if not found yet */
-
 	/* for evaluation */
 	int initialized;
 };
@@ -144,15 +144,6 @@ struct vec {
 
 	/* index into table of samples */
 	int n;
-
-	/* for re-ordering after a move */
-	int mark;
-
-	/* for dumping */
-	int dumped;
-
-	/* for the GUI */
-	GtkWidget *list_widget; /* NULL if items aren't shown */
 };
 
 struct frame {
@@ -165,21 +156,17 @@ struct frame {
 
 	/* used during generation */
 	const struct frame *curr_parent;
+	unsigned long stamp;	/* see hoist.h */
+	const struct inst_path *curr_path; /* NULL if not recorded yet */
 
 	/* generating and editing */
 	struct obj *active_ref;
 
-	/* for searching */
-	struct obj *found_ref;	/* NULL if not found yet */
-
 	/* index into bit vector in samples */
 	int n;
 
-	/* for dumping */
-	int dumped;
-
-	/* for the GUI */
-	GtkWidget *label;
+	/* index into the sets of frames reachable, see is_parent_of */
+	int ref_n;
 };
 
 enum obj_type {
@@ -208,6 +195,9 @@ struct pad {
 	struct vec *other; /* NULL if frame origin */
 	int rounded;
 	enum pad_type type;
+
+	/* used during generation */
+	struct template *tmpl;
 };
 
 struct hole {
@@ -241,12 +231,6 @@ struct obj {
 	struct vec *base;
 	struct obj *next;
 	int lineno;
-
-	/* for dumping */
-	int dumped;
-
-	/* for the GUI */
-	GtkWidget *list_widget; /* NULL if items are not shown */
 };
 
 
@@ -258,25 +242,30 @@ extern enum allow_overlap allow_overlap;
 extern int holes_linked;
 
 
-struct inst;
-
 /*
- * Search callback from inst, invoked after the instance has been populated.
+ * frame_path returns the table rows and loop iterations of the frame that
+ * are current while generating it. activate_path makes them the active ones.
  */
 
-void find_inst(const struct inst *inst);
+const struct inst_path *frame_path(struct frame *frame);
+void activate_path(struct frame *frame, const struct inst_path *path);
+
+int obj_anchors(struct obj *obj, struct vec ***anchors);
 
 /*
- * If invoking search_inst before calling "instantiate", loop and tables are
- * adjusted such that an instance matching the one passed to search_inst will
- * become active. Note that this doesn't necessarily succeed, in which case no
- * change is made. Also, if multiple matches are encountered, the result is
- * arbitrary.
+ * is_parent_of returns 1 if "p" is "c" or references it, directly or through
+ * other frames. frame_refs_changed must be called after adding or removing
+ * frames or frame references.
  */
 
-void search_inst(const struct inst *inst);
+int is_parent_of(const struct frame *p, const struct frame *c);
+void frame_refs_changed(void);
 
-int obj_anchors(struct obj *obj, struct vec ***anchors);
+/*
+ * connect_obj appends "obj" to the objects of "frame".
+ */
+
+void connect_obj(struct frame *frame, struct obj *obj);
 
 int instantiate(void);
 void obj_cleanup(void);
@@ -155,13 +155,17 @@ static void
 pcb_pad
 (
         FILE *file,
-        const struct inst *inst
+        const struct inst_cols *c,
+        int i
 )
 {
+        const struct inst *inst = c->inst[i];
+        struct coord min = { c->ax[i], c->ay[i] };
+        struct coord max = { c->bx[i], c->by[i] };
         struct coord center;
         struct coord size;
-        char *pad_number;
-        char *pad_name;
+        const char *pad_number;
+        const char *pad_name;
         double rx1;
         double ry1;
         double rx2;
@@ -172,7 +176,7 @@ pcb_pad
         char *pad_flags;
 
         /* Convert fpd dimensions to PCB dimensions. */
-        pcb_centric (inst->base, inst->u.pad.other, &center, &size);
+        pcb_centric (min, max, &center, &size);
         rx1 = (int) (center.x); /* rX1 coordinate */
         ry1 = (int) (center.y); /* rY1 coordinate */
         rx2 = (int) (center.x); /* rX2 coordinate */
@@ -180,8 +184,8 @@ pcb_pad
         pad_thickness = (int) size.x; /*! \todo Thickness */
         pad_clearance = (int) size.x; /*! \todo Clearance */
         pad_solder_mask_clearance = (int) size.x; /* Mask */
-        pad_name = strdup (inst->u.pad.name); /* Name */
-        pad_number = strdup (inst->u.pad.name); /*! \todo Number */
+        pad_name = c->name[i]; /* Name */
+        pad_number = c->name[i]; /*! \todo Number */
         pad_flags = inst->obj->u.pad.rounded ? strdup ("") : strdup ("square"); /* SFlags */
         /* Write to PCB footprint file. */
         fprintf
@@ -242,12 +246,16 @@ static void
 pcb_hole
 (
         FILE *file,
-        const struct inst *inst
+        const struct inst_cols *c,
+        int i
 )
 {
+        const struct inst *inst = c->inst[i];
+        struct coord min = { c->ax[i], c->ay[i] };
+        struct coord max = { c->bx[i], c->by[i] };
         struct coord center, size;
-        char *pin_number;
-        char *pin_name;
+        const char *pin_number;
+        const char *pin_name;
         double rx;
         double ry;
         double pin_pad_thickness;
@@ -261,14 +269,14 @@ pcb_hole
                 return;
         }
         /* Convert fpd dimensions to PCB dimensions. */
-        pcb_centric (inst->base, inst->u.hole.other, &center, &size);
+        pcb_centric (min, max, &center, &size);
         rx = (int) (center.x); /* rX coordinate */
         ry = (int) (center.y); /* rY coordinate */
         pin_pad_thickness = (int) 0; /*! \todo Thickness */
         pin_pad_clearance = (int) 0; /*! \todo Clearance */
         pin_pad_solder_mask_clearance = (int) 0; /* Mask */
-        pin_name = strdup (inst->u.pad.name); /* Name */
-        pin_number = strdup (inst->u.pad.name); /*! \todo Number */
+        pin_name = inst->u.pad.name; /* Name */
+        pin_number = inst->u.pad.name; /*! \todo Number */
         pin_hole_drill = (int) (size.x); /* Drill */
         pin_flags = inst->obj->u.pad.rounded ? strdup ("hole") : strdup ("hole,square"); /* SFlags */
         /* Write to PCB footprint file. */
@@ -310,7 +318,8 @@ static void
 pcb_line
 (
         FILE *file,
-        const struct inst *inst
+        const struct inst_cols *c,
+        int i
 )
 {
         double rx1;
@@ -319,11 +328,11 @@ pcb_line
         double ry2;
         double line_thickness;
         /* Convert fpd dimensions to PCB dimensions. */
-        rx1 = units_to_pcb (inst->base.x);
-        ry1 = -units_to_pcb (inst->base.y);
-        rx2 = units_to_pcb (inst->u.rect.end.x);
-        ry2 = -units_to_pcb (inst->u.rect.end.y);
-        line_thickness = units_to_pcb (inst->u.rect.width);
+        rx1 = units_to_pcb (c->ax[i]);
+        ry1 = -units_to_pcb (c->ay[i]);
+        rx2 = units_to_pcb (c->bx[i]);
+        ry2 = -units_to_pcb (c->by[i]);
+        line_thickness = units_to_pcb (c->width[i]);
         /* Write to PCB footprint file. */
         fprintf
         (
@@ -346,7 +355,8 @@ static void
 pcb_rect
 (
         FILE *file,
-        const struct inst *inst
+        const struct inst_cols *c,
+        int i
 )
 {
         double xmin;
@@ -356,11 +366,11 @@ pcb_rect
         double line_width;
 
         /* Convert fpd dimensions to PCB dimensions. */
-        xmin = units_to_pcb (inst->base.x);
-        ymin = units_to_pcb (inst->base.y);
-        xmax= units_to_pcb (inst->u.rect.end.x);
-        ymax= units_to_pcb (inst->u.rect.end.y);
-        line_width = units_to_pcb (inst->u.rect.width);
+        xmin = units_to_pcb (c->ax[i]);
+        ymin = units_to_pcb (c->ay[i]);
+        xmax= units_to_pcb (c->bx[i]);
+        ymax= units_to_pcb (c->by[i]);
+        line_width = units_to_pcb (c->width[i]);
         /* Print rectangle ends (perpendicular to x-axis) */
         fprintf
         (
@@ -436,7 +446,8 @@ static void
 pcb_circ
 (
         FILE *file,
-        const struct inst *inst
+        const struct inst_cols *c,
+        int i
 )
 {
         double x;
@@ -448,13 +459,13 @@ pcb_circ
         double line_width;
 
         /* Convert fpd dimensions to PCB dimensions. */
-        x = units_to_pcb (inst->base.x);
-        y = -units_to_pcb (inst->base.y);
-        width = units_to_pcb (inst->u.arc.r);
-        height = units_to_pcb (inst->u.arc.r);
+        x = units_to_pcb (c->ax[i]);
+        y = -units_to_pcb (c->ay[i]);
+        width = units_to_pcb (c->r[i]);
+        height = units_to_pcb (c->r[i]);
         start_angle = 0;
         delta_angle = 360;
-        line_width = units_to_pcb (inst->u.arc.width);
+        line_width = units_to_pcb (c->width[i]);
         /* Write to PCB footprint file. */
         fprintf
         (
@@ -501,9 +512,11 @@ static void
 pcb_arc
 (
         FILE *file,
-        const struct inst *inst
+        const struct inst_cols *c,
+        int i
 )
 {
+        struct coord center = { c->ax[i], c->ay[i] };
         struct coord p;
         double a;
         double x;
@@ -514,8 +527,8 @@ pcb_arc
         double delta_angle;
         double line_width;
 
-        p = rotate_r (inst->base, inst->u.arc.r, inst->u.arc.a2);
-        a = inst->u.arc.a2 - inst->u.arc.a1;
+        p = rotate_r (center, c->r[i], c->a2[i]);
+        a = c->a2[i] - c->a1[i];
         while (a <= 0)
         {
                 a += 360;
@@ -525,13 +538,13 @@ pcb_arc
                 a -= 360;
         }
         /* Convert fpd dimensions to PCB dimensions. */
-        x = units_to_pcb (inst->base.x);
-        y = -units_to_pcb (inst->base.y);
-        width = units_to_pcb (inst->u.arc.r);
-        height = units_to_pcb (inst->u.arc.r);
+        x = units_to_pcb (center.x);
+        y = -units_to_pcb (center.y);
+        width = units_to_pcb (c->r[i]);
+        height = units_to_pcb (c->r[i]);
         start_angle = 0; /*! \todo Start angle */
         delta_angle = a * 10.0; /* Delta angle */
-        line_width = units_to_pcb (inst->u.arc.width);
+        line_width = units_to_pcb (c->width[i]);
         /* Write to PCB footprint file. */
         fprintf
         (
@@ -549,43 +562,48 @@ pcb_arc
 
 
 /*!
- * \brief .
- * 
+ * \brief Print all items of one priority in the PCB footprint
+ * \c file . \n
  */
 static void
-pcb_inst
+pcb_cols
 (
         FILE *file,
         enum inst_prio prio,
-        const struct inst *inst
+        const struct inst_cols *c
 )
 {
-        switch (prio)
+        int i;
+
+        for (i = 0; i != c->n; i++)
         {
-                case ip_pad_copper:
-                        pcb_pad(file, inst);
-                        break;
-                case ip_pad_special:
-                        pcb_pad(file, inst);
-                        break;
-                case ip_hole:
-                        pcb_hole(file, inst);
-                        break;
-                case ip_line:
-                        pcb_line(file, inst);
-                        break;
-                case ip_rect:
-                        pcb_rect(file, inst);
-                        break;
-                case ip_circ:
-                        pcb_circ(file, inst);
-                        break;
-                case ip_arc:
-                        pcb_arc(file, inst);
-                        break;
-                default:
-                        /* Don't try to export vectors, frame references, or measurements. */
-                        break;
+                switch (prio)
+                {
+                        case ip_pad_copper:
+                                pcb_pad(file, c, i);
+                                break;
+                        case ip_pad_special:
+                                pcb_pad(file, c, i);
+                                break;
+                        case ip_hole:
+                                pcb_hole(file, c, i);
+                                break;
+                        case ip_line:
+                                pcb_line(file, c, i);
+                                break;
+                        case ip_rect:
+                                pcb_rect(file, c, i);
+                                break;
+                        case ip_circ:
+                                pcb_circ(file, c, i);
+                                break;
+                        case ip_arc:
+                                pcb_arc(file, c, i);
+                                break;
+                        default:
+                                /* Don't try to export vectors, frame references, or measurements. */
+                                break;
+                }
         }
 }
 
@@ -655,7 +673,6 @@ pcb_footprint
 )
 {
         enum inst_prio prio;
-        const struct inst *inst;
         double x_text;
         double y_text;
         char *footprint_name;
@@ -681,14 +698,8 @@ pcb_footprint
         );
         FOR_INST_PRIOS_UP (prio)
         {
-                for (inst = pkgs->insts[prio]; inst; inst = inst->next)
-                {
-                        pcb_inst (file, prio, inst);
-                }
-                for (inst = pkg->insts[prio]; inst; inst = inst->next)
-                {
-                        pcb_inst (file, prio, inst);
-                }
+                pcb_cols (file, prio, pkgs->cols + prio);
+                pcb_cols (file, prio, pkg->cols + prio);
         }
         fprintf (file, ")\n\n");
 
@@ -22,9 +22,8 @@
 #include "layer.h"
 #include "obj.h"
 #include "inst.h"
+#include "meas.h"
 #include "unparse.h"
-#include "gui_status.h"
-#include "gui_inst.h"
 #include "postscript.h"
 
 
@@ -0,0 +1,116 @@
+/*
+ * strpool.c - Pools of shared strings
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+#include "hash.h"
+#include "strpool.h"
+
+
+#define	BLOCK_SIZE	4096
+
+
+struct block {
+	struct block *next;
+	size_t used;
+	char buf[];
+};
+
+struct strpool {
+	struct block *blocks;
+	struct hash *hash;
+};
+
+
+static unsigned hash_string(const void *item)
+{
+	return hash_str(HASH_INIT, item);
+}
+
+
+static int eq_string(const void *a, const void *b)
+{
+	return !strcmp(a, b);
+}
+
+
+struct strpool *strpool_new(void)
+{
+	struct strpool *pool;
+
+	pool = alloc_type(struct strpool);
+	pool->blocks = NULL;
+	pool->hash = hash_new(hash_string, eq_string);
+	return pool;
+}
+
+
+/*
+ * Strings longer than a block get a block of their own, which we put behind
+ * the current one, so that its free space isn't lost.
+ */
+
+static char *alloc_string(struct strpool *pool, size_t size)
+{
+	struct block *b = pool->blocks;
+
+	if (b && b->used+size <= BLOCK_SIZE) {
+		b->used += size;
+		return b->buf+b->used-size;
+	}
+	b = alloc_size(sizeof(struct block)+
+	    (size > BLOCK_SIZE ? size : BLOCK_SIZE));
+	b->used = size;
+	if (size > BLOCK_SIZE && pool->blocks) {
+		b->next = pool->blocks->next;
+		pool->blocks->next = b;
+	} else {
+		b->next = pool->blocks;
+		pool->blocks = b;
+	}
+	return b->buf;
+}
+
+
+const char *strpool_add(struct strpool *pool, const char *s)
+{
+	char *copy;
+	size_t size;
+
+	copy = hash_lookup(pool->hash, s);
+	if (copy)
+		return copy;
+	size = strlen(s)+1;
+	copy = alloc_string(pool, size);
+	memcpy(copy, s, size);
+	hash_add(pool->hash, copy);
+	return copy;
+}
+
+
+void strpool_free(struct strpool *pool)
+{
+	struct block *next;
+
+	if (!pool)
+		return;
+	while (pool->blocks) {
+		next = pool->blocks->next;
+		free(pool->blocks);
+		pool->blocks = next;
+	}
+	hash_free(pool->hash, NULL);
+	free(pool);
+}
@@ -0,0 +1,31 @@
+/*
+ * strpool.h - Pools of shared strings
+ *
+ * Written 2026 by the fped developers
+ * Copyright 2026 by the fped developers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+
+#ifndef STRPOOL_H
+#define STRPOOL_H
+
+
+struct strpool;
+
+
+/*
+ * strpool_add returns the pool's copy of the string. Equal strings added to
+ * the same pool yield the same pointer. All copies are freed together with
+ * the pool.
+ */
+
+struct strpool *strpool_new(void);
+const char *strpool_add(struct strpool *pool, const char *s);
+void strpool_free(struct strpool *pool);
+
+#endif /* !STRPOOL_H */
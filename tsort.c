@@ -36,6 +36,13 @@
  * - the destination if an edge never precedes its origin
  * - higher priority comes before lower priority
  * - earlier add_node comes before later
+ *
+ * Nodes without incoming edges wait in one of two heaps. Nodes that got their
+ * priority after the last decay are ordered by priority and then by age.
+ * Nodes whose priority has decayed are only ordered by age. A decay therefore
+ * just moves the nodes from the first heap to the second, and each node gets
+ * moved at most once. Nodes that still have incoming edges notice a decay when
+ * their priority next changes, by comparing generations.
  */
 
 
@@ -44,10 +51,12 @@
 #include <limits.h>
 
 #include "util.h"
+#include "hash.h"
 #include "tsort.h"
 
 
 struct edge {
+	struct node *from;
 	struct node *to;
 	int priority;		/* edge priority */
 	struct edge *next;
@@ -55,54 +64,192 @@ struct edge {
 
 struct node {
 	void *user;
+	struct tsort *tsort;
 	struct edge *edges;	/* outbound edges */
 	int incoming;		/* number of incoming edges */
 	int priority;		/* cumulative node priority */
+	unsigned gen;		/* generation "priority" belongs to */
 	int decay;		/* all node prio. decay after issuing this */
-	struct node *next;
+	int n;			/* order of add_node */
+};
+
+struct heap {
+	struct node **nodes;
+	int n;
+	int size;
+	int (*before)(const struct node *a, const struct node *b);
 };
 
 struct tsort {
-	struct node *nodes;
-	struct node **next_node;
+	struct node **nodes;	/* in order of add_node */
 	int n_nodes;
+	int size;
+	struct hash *node_hash;	/* by user pointer */
+	struct hash *edge_hash;	/* by origin and destination */
+	unsigned gen;		/* incremented on each decay */
 };
 
 
+/* ----- hashing ----------------------------------------------------------- */
+
+
+static unsigned hash_node(const void *item)
+{
+	const struct node *node = item;
+
+	return hash_bytes(HASH_INIT, &node->user, sizeof(node->user));
+}
+
+
+static int eq_node(const void *a, const void *b)
+{
+	const struct node *na = a, *nb = b;
+
+	return na->user == nb->user;
+}
+
+
+static unsigned hash_edge(const void *item)
+{
+	const struct edge *edge = item;
+	unsigned h;
+
+	h = hash_bytes(HASH_INIT, &edge->from, sizeof(edge->from));
+	return hash_bytes(h, &edge->to, sizeof(edge->to));
+}
+
+
+static int eq_edge(const void *a, const void *b)
+{
+	const struct edge *ea = a, *eb = b;
+
+	return ea->from == eb->from && ea->to == eb->to;
+}
+
+
+/* ----- heaps ------------------------------------------------------------- */
+
+
+static int before_prio(const struct node *a, const struct node *b)
+{
+	if (a->priority != b->priority)
+		return a->priority > b->priority;
+	return a->n < b->n;
+}
+
+
+static int before_age(const struct node *a, const struct node *b)
+{
+	return a->n < b->n;
+}
+
+
+static void heap_push(struct heap *heap, struct node *node)
+{
+	int i, parent;
+
+	if (heap->n == heap->size) {
+		heap->size = heap->size ? heap->size*2 : 16;
+		heap->nodes = realloc(heap->nodes,
+		    sizeof(struct node *)*heap->size);
+		if (!heap->nodes)
+			abort();
+	}
+	for (i = heap->n++; i; i = parent) {
+		parent = (i-1)/2;
+		if (!heap->before(node, heap->nodes[parent]))
+			break;
+		heap->nodes[i] = heap->nodes[parent];
+	}
+	heap->nodes[i] = node;
+}
+
+
+static struct node *heap_pop(struct heap *heap)
+{
+	struct node *top = heap->nodes[0];
+	struct node *last = heap->nodes[--heap->n];
+	int i = 0, child;
+
+	while (1) {
+		child = 2*i+1;
+		if (child >= heap->n)
+			break;
+		if (child+1 < heap->n &&
+		    heap->before(heap->nodes[child+1], heap->nodes[child]))
+			child++;
+		if (!heap->before(heap->nodes[child], last))
+			break;
+		heap->nodes[i] = heap->nodes[child];
+		i = child;
+	}
+	heap->nodes[i] = last;
+	return top;
+}
+
+
+/* ----- building the graph ------------------------------------------------ */
+
+
+static void add_priority(struct node *node, int priority)
+{
+	if (node->gen != node->tsort->gen) {
+		node->gen = node->tsort->gen;
+		node->priority = 0;
+	}
+	node->priority += priority;
+}
+
+
 void add_edge(struct node *from, struct node *to, int priority)
 {
-	struct edge **edge;
+	struct tsort *tsort = from->tsort;
+	struct edge key, *edge;
 
-	for (edge = &from->edges; *edge; edge = &(*edge)->next)
-		if ((*edge)->to == to) {
-			(*edge)->priority += priority;
-			return;
-		}
-	*edge = alloc_type(struct edge);
-	(*edge)->to = to;
-	(*edge)->priority = priority;
-	(*edge)->next = NULL;
+	key.from = from;
+	key.to = to;
+	edge = hash_lookup(tsort->edge_hash, &key);
+	if (edge) {
+		edge->priority += priority;
+		return;
+	}
+	edge = alloc_type(struct edge);
+	edge->from = from;
+	edge->to = to;
+	edge->priority = priority;
+	edge->next = from->edges;
+	from->edges = edge;
+	hash_add(tsort->edge_hash, edge);
 	to->incoming++;
 }
 
 
 struct node *add_node(struct tsort *tsort, void *user, int decay)
 {
-	struct node *node;
+	struct node key, *node;
 
-	for (node = tsort->nodes; node; node = node->next)
-		if (node->user == user)
-			return node;
+	key.user = user;
+	node = hash_lookup(tsort->node_hash, &key);
+	if (node)
+		return node;
 	node = alloc_type(struct node);
 	node->user = user;
+	node->tsort = tsort;
 	node->edges = NULL;
 	node->incoming = 0;
 	node->priority = 0;
+	node->gen = 0;
 	node->decay = decay;
-	node->next = NULL;
-	*tsort->next_node = node;
-	tsort->next_node = &node->next;
-	tsort->n_nodes++;
+	node->n = tsort->n_nodes;
+	if (tsort->n_nodes == tsort->size) {
+		tsort->size = tsort->size ? tsort->size*2 : 16;
+		tsort->nodes = realloc(tsort->nodes,
+		    sizeof(struct node *)*tsort->size);
+		if (!tsort->nodes)
+			abort();
+	}
+	tsort->nodes[tsort->n_nodes++] = node;
+	hash_add(tsort->node_hash, node);
 	return node;
 }
 
@@ -113,49 +260,85 @@ struct tsort *begin_tsort(void)
 
 	tsort = alloc_type(struct tsort);
 	tsort->nodes = NULL;
-	tsort->next_node = &tsort->nodes;
 	tsort->n_nodes = 0;
+	tsort->size = 0;
+	tsort->node_hash = hash_new(hash_node, eq_node);
+	tsort->edge_hash = hash_new(hash_edge, eq_edge);
+	tsort->gen = 0;
 	return tsort;
 }
 
 
+/* ----- sorting ----------------------------------------------------------- */
+
+
+static void ready(struct heap *prio, struct heap *decayed, struct node *node)
+{
+	if (node->gen == node->tsort->gen)
+		heap_push(prio, node);
+	else
+		heap_push(decayed, node);
+}
+
+
+static void decay(struct tsort *tsort, struct heap *prio, struct heap *decayed)
+{
+	tsort->gen++;
+	while (prio->n)
+		heap_push(decayed, heap_pop(prio));
+}
+
+
 void **end_tsort(struct tsort *tsort)
 {
-	struct node **walk, **first, *node;
-	struct edge *edge;
+	struct heap prio = { NULL, 0, 0, before_prio };
+	struct heap decayed = { NULL, 0, 0, before_age };
+	struct node *node;
+	struct edge *edge, *next;
 	void **res;
 	int n = 0;
+	int i;
 
 	res = alloc_size(sizeof(void *)*(tsort->n_nodes+1));
-	while (1) {
-		first = NULL;
-		for (walk = &tsort->nodes; *walk; walk = &(*walk)->next) {
-			if ((*walk)->incoming)
-				continue;
-			if (!first || (*first)->priority < (*walk)->priority)
-				first = walk;
-		}
-		if (!first)
-			break;
-		if ((*first)->decay)
-			for (node = tsort->nodes; node; node = node->next)
-				node->priority = 0;
-		node = *first;
-		*first = node->next;
+	for (i = 0; i != tsort->n_nodes; i++)
+		if (!tsort->nodes[i]->incoming)
+			heap_push(&prio, tsort->nodes[i]);
+	while (prio.n || decayed.n) {
+		if (!decayed.n)
+			node = heap_pop(&prio);
+		else if (!prio.n)
+			node = heap_pop(&decayed);
+		else if (prio.nodes[0]->priority > 0 ||
+		    (!prio.nodes[0]->priority &&
+		    prio.nodes[0]->n < decayed.nodes[0]->n))
+			node = heap_pop(&prio);
+		else
+			node = heap_pop(&decayed);
+		if (node->decay)
+			decay(tsort, &prio, &decayed);
 		res[n++] = node->user;
-		while (node->edges) {
-			edge = node->edges;
-			edge->to->incoming--;
-			edge->to->priority += edge->priority;
-			node->edges = edge->next;
-			free(edge);
+		for (edge = node->edges; edge; edge = edge->next) {
+			add_priority(edge->to, edge->priority);
+			if (!--edge->to->incoming)
+				ready(&prio, &decayed, edge->to);
 		}
-		free(node);
 	}
-	if (tsort->nodes) {
+	if (n != tsort->n_nodes) {
 		fprintf(stderr, "cycle detected in partial order\n");
 		abort();
 	}
+	for (i = 0; i != tsort->n_nodes; i++) {
+		for (edge = tsort->nodes[i]->edges; edge; edge = next) {
+			next = edge->next;
+			free(edge);
+		}
+		free(tsort->nodes[i]);
+	}
+	hash_free(tsort->node_hash, NULL);
+	hash_free(tsort->edge_hash, NULL);
+	free(tsort->nodes);
+	free(prio.nodes);
+	free(decayed.nodes);
 	free(tsort);
 	res[n] = NULL;
 	return res;
@@ -1,5 +1,5 @@
 /*
- * unparse.c - Dump an expression tree into a string
+ * unparse.c - Dump an expression tree into a string or a file
  *
  * Written 2009, 2012 by Werner Almesberger
  * Copyright 2009, 2012 by Werner Almesberger
@@ -11,17 +11,27 @@
  */
 
 /*
- * This is crazily inefficient but who cares :-)
+ * We append all the text to one buffer, or write it straight to a file,
+ * instead of building and merging a string for each node.
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "util.h"
 #include "expr.h"
 #include "unparse.h"
 
 
+struct out {
+	FILE *file;		/* NULL if writing to the buffer */
+	char *buf;
+	size_t len;
+	size_t size;
+};
+
+
 enum prec {
 	prec_add,
 	prec_mult,
@@ -45,92 +55,131 @@ static int precedence(op_type op)
 }
 
 
-static char *merge3(char *a, const char *op, char *b)
-{
-	char *buf;
+/* ----- output ----------------------------------------------------------- */
+
 
-	buf = alloc_size(strlen(op)+strlen(a)+strlen(b)+1);
-	sprintf(buf, "%s%s%s", a, op, b);
-	free(a);
-	free(b);
-	return buf;
+static void put(struct out *out, const char *s, size_t len)
+{
+	if (out->file) {
+		fwrite(s, 1, len, out->file);
+		return;
+	}
+	if (out->len+len >= out->size) {
+		while (out->len+len >= out->size)
+			out->size = out->size ? out->size*2 : 64;
+		out->buf = realloc(out->buf, out->size);
+		if (!out->buf)
+			abort();
+	}
+	memcpy(out->buf+out->len, s, len);
+	out->len += len;
+	out->buf[out->len] = 0;
 }
 
 
-static char *merge2(const char *op, char *a)
+static void puts_out(struct out *out, const char *s)
 {
-	char *buf;
-
-	buf = alloc_size(strlen(op)+strlen(a)+1);
-	sprintf(buf, "%s%s", op, a);
-	free(a);
-	return buf;
+	put(out, s, strlen(s));
 }
 
 
-static char *unparse_op(const struct expr *expr, enum prec prec);
+/* ----- expressions ------------------------------------------------------- */
+
 
+static void unparse_op(struct out *out, const struct expr *expr,
+    enum prec prec);
 
-static char *unparse_fn(const char *name, const struct expr *expr)
+
+static void unparse_fn(struct out *out, const char *name,
+    const struct expr *expr)
 {
-	char *buf, *tmp;
+	puts_out(out, name);
+	put(out, "(", 1);
+	unparse_op(out, expr->u.op.a, prec_add);
+	put(out, ")", 1);
+}
+
 
-	tmp = unparse_op(expr->u.op.a, prec_add);
-	buf = alloc_size(strlen(name)+strlen(tmp)+3);
-	sprintf(buf, "%s(%s)", name, tmp);
-	free(tmp);
-	return buf;
+static void unparse_bin(struct out *out, const struct expr *expr,
+    enum prec prec_a, const char *op, enum prec prec_b)
+{
+	unparse_op(out, expr->u.op.a, prec_a);
+	puts_out(out, op);
+	unparse_op(out, expr->u.op.b, prec_b);
 }
 
 
-static char *unparse_op(const struct expr *expr, enum prec prec)
+static void unparse_op(struct out *out, const struct expr *expr,
+    enum prec prec)
 {
 	char tmp[100];
-	char *buf, *temp;
 
 	if (prec > precedence(expr->op)) {
-		temp = unparse_op(expr, prec_add);
-		buf = alloc_size(strlen(temp)+3);
-		sprintf(buf, "(%s)", temp);
-		free(temp);
-		return buf;
+		put(out, "(", 1);
+		unparse_op(out, expr, prec_add);
+		put(out, ")", 1);
+		return;
 	}
 	if (expr->op == op_num) {
 		snprintf(tmp, sizeof(tmp), "%lg%s",
 		    expr->u.num.n, str_unit(expr->u.num));
-		return stralloc(tmp);
+		puts_out(out, tmp);
+	} else if (expr->op == op_string) {
+		put(out, "\"", 1);
+		puts_out(out, expr->u.str);
+		put(out, "\"", 1);
+	} else if (expr->op == op_var) {
+		puts_out(out, expr->u.var);
+	} else if (expr->op == op_minus) {
+		put(out, "-", 1);
+		unparse_op(out, expr->u.op.a, prec_unary);
+	} else if (expr->op == op_add) {
+		unparse_bin(out, expr, prec_add, "+", prec_add);
+	} else if (expr->op == op_sub) {
+		unparse_bin(out, expr, prec_add, "-", prec_mult);
+	} else if (expr->op == op_mult) {
+		unparse_bin(out, expr, prec_mult, "*", prec_mult);
+	} else if (expr->op == op_div) {
+		unparse_bin(out, expr, prec_mult, "/", prec_primary);
+	} else if (expr->op == op_sin) {
+		unparse_fn(out, "sin", expr);
+	} else if (expr->op == op_cos) {
+		unparse_fn(out, "cos", expr);
+	} else if (expr->op == op_sqrt) {
+		unparse_fn(out, "sqrt", expr);
+	} else if (expr->op == op_floor) {
+		unparse_fn(out, "floor", expr);
+	} else {
+		abort();
 	}
-	if (expr->op == op_string)
-		return stralloc_printf("\"%s\"", expr->u.str);
-	if (expr->op == op_var)
-		return stralloc(expr->u.var);
-	if (expr->op == op_minus)
-		return merge2("-", unparse_op(expr->u.op.a, prec_unary));
-	if (expr->op == op_add)
-		return merge3(unparse_op(expr->u.op.a, prec_add), "+",
-		    unparse_op(expr->u.op.b, prec_add));
-	if (expr->op == op_sub)
-		return merge3(unparse_op(expr->u.op.a, prec_add), "-",
-		    unparse_op(expr->u.op.b, prec_mult));
-	if (expr->op == op_mult)
-		return merge3(unparse_op(expr->u.op.a, prec_mult), "*",
-		    unparse_op(expr->u.op.b, prec_mult));
-	if (expr->op == op_div)
-		return merge3(unparse_op(expr->u.op.a, prec_mult), "/",
-		    unparse_op(expr->u.op.b, prec_primary));
-	if (expr->op == op_sin)
-		return unparse_fn("sin", expr);
-	if (expr->op == op_cos)
-		return unparse_fn("cos", expr);
-	if (expr->op == op_sqrt)
-		return unparse_fn("sqrt", expr);
-	if (expr->op == op_floor)
-		return unparse_fn("floor", expr);
-	abort();
 }
 
 
+/* ----- API --------------------------------------------------------------- */
+
+
 char *unparse(const struct expr *expr)
 {
-	return expr ? unparse_op(expr, prec_add) : stralloc("");
+	struct out out = {
+		.file = NULL,
+		.buf = NULL,
+		.len = 0,
+		.size = 0,
+	};
+
+	if (!expr)
+		return stralloc("");
+	unparse_op(&out, expr, prec_add);
+	return out.buf;
+}
+
+
+void unparse_file(FILE *file, const struct expr *expr)
+{
+	struct out out = {
+		.file = file,
+	};
+
+	if (expr)
+		unparse_op(&out, expr, prec_add);
 }
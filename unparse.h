@@ -1,5 +1,5 @@
 /*
- * unparse.h - Dump an expression tree into a string
+ * unparse.h - Dump an expression tree into a string or a file
  *
  * Written 2009 by Werner Almesberger
  * Copyright 2009 by Werner Almesberger
@@ -14,9 +14,12 @@
 #ifndef UNPARSE_H
 #define UNPARSE_H
 
+#include <stdio.h>
+
 #include "expr.h"
 
 
 char *unparse(const struct expr *expr);
+void unparse_file(FILE *file, const struct expr *expr);
 
 #endif /* !UNPARSE_H */